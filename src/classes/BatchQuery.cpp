@@ -0,0 +1,101 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file BatchQuery.cpp
+ * @brief Contains the methods of the BatchQuery class.
+ */
+
+#ifndef BATCHQUERY_CPP_
+#define BATCHQUERY_CPP_
+
+#include <algorithm>
+#include "BatchQuery.h"
+#include "MazeSolver.h"
+#include "ParallelBands.h"
+
+/*
+ * Spread the low 32 bits of x out to the even bits of the result
+ */
+static uint64_t spreadBits(uint64_t x) {
+    x = (x | (x << 16)) & 0x0000ffff0000ffffULL;
+    x = (x | (x << 8))  & 0x00ff00ff00ff00ffULL;
+    x = (x | (x << 4))  & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | (x << 2))  & 0x3333333333333333ULL;
+    x = (x | (x << 1))  & 0x5555555555555555ULL;
+    return x;
+}
+
+uint64_t mortonCode(uint32_t r, uint32_t c) {
+    return (spreadBits(r) << 1) | spreadBits(c);
+}
+
+/*
+ * Whether (r,c) is a node of the maze
+ */
+bool BatchQuery::inMaze(int r, int c) const {
+    return r >= 0 && c >= 0 && r < walls.numRows() && c < walls.numCols();
+}
+
+BatchQuery::BatchQuery(const WallBits& walls) : walls(walls) {
+    indexed = index.build(walls);
+    if (!indexed) graph.build(walls);
+}
+
+void BatchQuery::run(const PathQuery *queries, long count, int *distances,
+        std::vector<unsigned char> *paths) {
+    // Sort by where the queries start, keeping track of where they came from
+    std::vector<std::pair<uint64_t, long> > order(count);
+    for (long q=0; q < count; q++) {
+        order[q].first = mortonCode(queries[q].start_r, queries[q].start_c);
+        order[q].second = q;
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<MazeSolver> solvers(indexed ? 0 : numWorkerThreads());
+    std::vector<std::vector<unsigned char> > scratch(numWorkerThreads());
+
+    // Index queries are tiny, so hand them out in bigger chunks
+    long chunk = indexed ? 4096 : 16;
+
+    forEachChunk(count, chunk, [&](int thread, long first, long last) {
+        for (long k=first; k < last; k++) {
+            long q = order[k].second;
+            const PathQuery& query = queries[q];
+            std::vector<unsigned char>& path = paths ? paths[q] : scratch[thread];
+            int len;
+
+            if (!inMaze(query.start_r, query.start_c) || !inMaze(query.end_r, query.end_c)) {
+                path.clear();
+                len = -1;
+            } else if (indexed && !paths) {
+                len = index.distance(query.start_r, query.start_c, query.end_r, query.end_c);
+            } else if (indexed) {
+                len = index.path(query.start_r, query.start_c, query.end_r, query.end_c, path);
+            } else {
+                len = solvers[thread].solveJunctions(graph, query.start_r, query.start_c,
+                        query.end_r, query.end_c, path);
+            }
+
+            if (distances) distances[q] = len;
+        }
+    });
+}
+
+#endif /* BATCHQUERY_CPP_ */
@@ -0,0 +1,133 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file BatchQuery.h
+ * @brief Contains the declaration of the BatchQuery class.
+ */
+
+#ifndef BATCHQUERY_H_
+#define BATCHQUERY_H_
+
+#include <vector>
+#include <stdint.h>
+#include "WallBits.h"
+#include "TreeDistanceIndex.h"
+#include "JunctionGraph.h"
+
+/**
+ * @brief One start/end pair for BatchQuery
+ */
+struct PathQuery {
+    int start_r;
+    int start_c;
+    int end_r;
+    int end_c;
+};
+
+/**
+ * @brief Answers large batches of distance and path queries on one maze,
+ * spread over a thread per core.
+ *
+ * The maze is only ever read, so every thread shares it. Perfect mazes are
+ * answered from a TreeDistanceIndex built once when the BatchQuery is made;
+ * mazes with loops get a JunctionGraph instead, and an A* search over it per
+ * query, with a MazeSolver workspace per thread.
+ *
+ * The queries are answered in order of the Morton code of their starting
+ * node, so queries that start near each other run close together in time and
+ * share whatever part of the maze is in cache. The results are still
+ * written in the order the queries were given.
+ */
+class BatchQuery {
+
+public:
+    /**
+     * @brief Get ready to answer queries on a maze
+     *
+     * The maze must not change while the BatchQuery is in use.
+     *
+     * @param walls the maze
+     */
+    BatchQuery(const WallBits& walls);
+
+    /**
+     * @brief Answer a batch of queries
+     *
+     * Either output can be NULL if it isn't wanted.
+     *
+     * @param queries the queries
+     * @param count number of queries
+     * @param distances count ints to write the lengths of the paths into
+     * (-1 if there is no path, or either end is outside the maze)
+     * @param paths count vectors to write the paths into, as directions to
+     * take from the start
+     */
+    void run(const PathQuery *queries, long count, int *distances,
+            std::vector<unsigned char> *paths);
+
+    /**
+     * @brief Tell whether queries are answered from a TreeDistanceIndex
+     *
+     * @return true if the maze is perfect
+     */
+    bool usesIndex() const { return indexed; }
+
+private:
+
+    /**
+     * @brief Tell whether a position is a node of the maze
+     *
+     * @param r row
+     * @param c column
+     * @return true if 0 <= r < rows and 0 <= c < cols
+     */
+    bool inMaze(int r, int c) const;
+
+    /**
+     * @brief The maze
+     */
+    const WallBits& walls;
+
+    /**
+     * @brief Whether index could be built (the maze is perfect)
+     */
+    bool indexed;
+
+    /**
+     * @brief Index for perfect mazes
+     */
+    TreeDistanceIndex index;
+
+    /**
+     * @brief Contracted graph for mazes with loops
+     */
+    JunctionGraph graph;
+};
+
+/**
+ * @brief Interleave the bits of a row and column (a Morton or Z-order code)
+ *
+ * @param r row
+ * @param c column
+ * @return the code
+ */
+uint64_t mortonCode(uint32_t r, uint32_t c);
+
+#endif /* BATCHQUERY_H_ */
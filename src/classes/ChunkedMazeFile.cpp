@@ -0,0 +1,339 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ChunkedMazeFile.cpp
+ * @brief Contains the methods of the ChunkedMazeFile class.
+ */
+
+#ifndef CHUNKEDMAZEFILE_CPP_
+#define CHUNKEDMAZEFILE_CPP_
+
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "ChunkedMazeFile.h"
+#include "WallCoder.h"
+#include "ParallelBands.h"
+
+/*
+ * The header, as it sits at the start of the file
+ */
+struct ChunkedMazeHeader {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t version;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t chunkSize;
+    uint32_t flags;
+    uint64_t seed;
+    char algorithm[32];
+    char reserved[56];
+};
+
+static_assert(sizeof(ChunkedMazeHeader) == 128, "the header is 128 bytes");
+
+static const char MAGIC[8] = {'M', 'A', 'Z', 'E', 'C', 'U', 'T', 'C'};
+static const uint32_t BYTEORDER = 0x01020304;
+static const uint32_t PERFECTFLAG = 1;
+
+/*
+ * Get count (at most 64) bits of a row of words, starting at bit from
+ */
+static inline uint64_t getBits(const uint64_t *row, long from, int count) {
+    int shift = from % 64;
+    uint64_t bits = row[from / 64] >> shift;
+    if (shift && shift + count > 64) bits |= row[from / 64 + 1] << (64 - shift);
+    return count == 64 ? bits : bits & (((uint64_t) 1 << count) - 1);
+}
+
+/*
+ * Put count (at most 64) bits into a row of words, starting at bit to
+ */
+static inline void putBits(uint64_t *row, long to, int count, uint64_t bits) {
+    uint64_t mask = count == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << count) - 1;
+    int shift = to % 64;
+    row[to / 64] = (row[to / 64] & ~(mask << shift)) | bits << shift;
+    if (shift && shift + count > 64) {
+        uint64_t *next = &row[to / 64 + 1];
+        *next = (*next & ~(mask >> (64 - shift))) | bits >> (64 - shift);
+    }
+}
+
+/*
+ * Copy count bits from one row of words to another
+ */
+static void copyBits(const uint64_t *from, long fromBit, uint64_t *to, long toBit, long count) {
+    for (long done=0; done < count; done += 64) {
+        int n = (int) std::min(64L, count - done);
+        putBits(to, toBit + done, n, getBits(from, fromBit + done, n));
+    }
+}
+
+bool ChunkedMazeFile::isChunked(const std::string& path) {
+    std::string::size_type dot = path.rfind('.');
+    if (dot == std::string::npos) return false;
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == "mzc";
+}
+
+ChunkedMazeFile::ChunkedMazeFile() {
+    seed = 0;
+    perfect = true;
+    chunkSize = CHUNKSIZE;
+    compress = true;
+    bytes = 0;
+    chunksRead = 0;
+    fd = -1;
+    rows = cols = chunkRows = chunkCols = 0;
+}
+
+ChunkedMazeFile::~ChunkedMazeFile() {
+    if (fd >= 0) close(fd);
+}
+
+uint64_t ChunkedMazeFile::rawBytes(int height, int width) {
+    return (uint64_t) height * ((width + 63) / 64) * 2 * sizeof(uint64_t);
+}
+
+bool ChunkedMazeFile::save(const std::string& path, const WallBits& walls) {
+    int mazeRows = walls.numRows(), mazeCols = walls.numCols();
+    if (mazeRows < 1 || mazeCols < 1) {
+        error = "the maze is empty";
+        return false;
+    }
+    if (chunkSize < 1 || chunkSize > (1 << 16)) {
+        error = "chunks have to be 1 to 65536 nodes along a side";
+        return false;
+    }
+    int size = chunkSize;
+    long across = (mazeCols + size - 1) / size;
+    long chunks = (mazeRows + size - 1) / size * across;
+
+    ChunkedMazeHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.byteOrder = BYTEORDER;
+    header.version = VERSION;
+    header.rows = mazeRows;
+    header.cols = mazeCols;
+    header.chunkSize = size;
+    header.flags = perfect ? PERFECTFLAG : 0;
+    header.seed = seed;
+    strncpy(header.algorithm, algorithm.c_str(), sizeof(header.algorithm) - 1);
+
+    int out = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (out < 0) {
+        error = "can't open the file for writing";
+        return false;
+    }
+
+    // The chunks follow the offsets, which are written once they're known
+    std::vector<uint64_t> chunkOffsets(chunks + 1);
+    uint64_t offset = sizeof(header) + chunkOffsets.size() * sizeof(uint64_t);
+    bool ok = pwrite(out, &header, sizeof(header), 0) == (ssize_t) sizeof(header);
+    long written = 0;
+    forEachChunkInOrder(chunks, 1,
+            [&](long k, long, std::vector<char>& chunk) {
+                int top = (int) (k / across) * size, left = (int) (k % across) * size;
+                int height = std::min(size, mazeRows - top), width = std::min(size, mazeCols - left);
+                uint64_t raw = rawBytes(height, width);
+                if (compress) {
+                    WallCoder::encode(walls, top, left, height, width, chunk);
+                    if (chunk.size() < raw) return;
+                }
+                int words = (width + 63) / 64;
+                chunk.assign(raw, 0);
+                uint64_t *p = (uint64_t *) &chunk[0];
+                for (int r=top; r < top + height; r++, p += 2 * words) {
+                    copyBits(walls.rightRow(r), left, p, 0, width);
+                    copyBits(walls.downRow(r), left, p + words, 0, width);
+                }
+            },
+            [&](const std::vector<char>& chunk) {
+                chunkOffsets[written++] = offset;
+                ok = ok && pwrite(out, &chunk[0], chunk.size(), (off_t) offset) ==
+                        (ssize_t) chunk.size();
+                offset += chunk.size();
+            });
+    chunkOffsets[chunks] = offset;
+    size_t indexBytes = chunkOffsets.size() * sizeof(uint64_t);
+    ok = ok && pwrite(out, &chunkOffsets[0], indexBytes, sizeof(header)) == (ssize_t) indexBytes;
+    ok = (close(out) == 0) && ok;
+    if (!ok) {
+        error = "can't write the file";
+        return false;
+    }
+    bytes = offset;
+    error.clear();
+    return true;
+}
+
+bool ChunkedMazeFile::open(const std::string& path) {
+    if (fd >= 0) close(fd);
+    rows = cols = chunkRows = chunkCols = 0;
+    offsets.clear();
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "can't open the file";
+        return false;
+    }
+    struct stat info;
+    ChunkedMazeHeader header;
+    if (fstat(fd, &info) != 0 ||
+            pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)) {
+        error = "the file is too short to be a chunked maze";
+    } else if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = "not a chunked maze file";
+    } else if (header.byteOrder != BYTEORDER) {
+        error = "the file was written on a machine with a different byte order";
+    } else if (header.version != VERSION) {
+        error = "unknown version of the chunked maze format";
+    } else if (header.rows == 0 || header.cols == 0 || header.rows > 0x7fffffff ||
+            header.cols > 0x7fffffff || header.chunkSize == 0 || header.chunkSize > (1 << 16)) {
+        error = "the header doesn't make sense";
+    }
+    if (!error.empty()) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    // The chunks have to follow the offsets and each other, end with the
+    // file, and be no longer than their raw walls
+    uint64_t length = (uint64_t) info.st_size;
+    int size = (int) header.chunkSize;
+    long across = (header.cols + size - 1) / size;
+    long down = (header.rows + size - 1) / size;
+    uint64_t start = sizeof(header) + (down * across + 1) * sizeof(uint64_t);
+    bool ok = start <= length;
+    if (ok) {
+        offsets.resize(down * across + 1);
+        size_t indexBytes = offsets.size() * sizeof(uint64_t);
+        ok = pread(fd, &offsets[0], indexBytes, sizeof(header)) == (ssize_t) indexBytes &&
+                offsets[0] == start && offsets.back() == length;
+    }
+    for (long k=0; ok && k < down * across; k++) {
+        int height = std::min(size, (int) header.rows - (int) (k / across) * size);
+        int width = std::min(size, (int) header.cols - (int) (k % across) * size);
+        ok = offsets[k+1] > offsets[k] &&
+                offsets[k+1] - offsets[k] <= rawBytes(height, width);
+    }
+    if (!ok) {
+        error = "the chunk offsets don't match the size of the file";
+        offsets.clear();
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    rows = (int) header.rows;
+    cols = (int) header.cols;
+    chunkSize = size;
+    chunkRows = (int) down;
+    chunkCols = (int) across;
+    algorithm.assign(header.algorithm, strnlen(header.algorithm, sizeof(header.algorithm)));
+    seed = header.seed;
+    perfect = (header.flags & PERFECTFLAG) != 0;
+    error.clear();
+    return true;
+}
+
+bool ChunkedMazeFile::loadRect(int top, int left, int height, int width, WallBits& walls) {
+    if (fd < 0) {
+        error = "no file is open";
+        return false;
+    }
+    if (top < 0 || left < 0 || height < 1 || width < 1 ||
+            top > rows - height || left > cols - width) {
+        error = "the rectangle isn't in the maze";
+        return false;
+    }
+
+    // Each row of chunks goes to one thread, so no two threads write to the
+    // same row of the rectangle
+    int size = chunkSize;
+    int firstRow = top / size, lastRow = (top + height - 1) / size;
+    int firstCol = left / size, lastCol = (left + width - 1) / size;
+    WallBits rect(height, width);
+    std::vector<char> failed(lastRow - firstRow + 1, 0);
+    forEachChunk(lastRow - firstRow + 1, 1, [&](int, long i, long) {
+        std::vector<char> chunk;
+        std::vector<uint64_t> words;
+        int chunkTop = (firstRow + (int) i) * size;
+        int chunkHeight = std::min(size, rows - chunkTop);
+        for (int j=firstCol; j <= lastCol && !failed[i]; j++) {
+            int chunkLeft = j * size;
+            int chunkWidth = std::min(size, cols - chunkLeft);
+            long k = (long) (firstRow + i) * chunkCols + j;
+            size_t length = offsets[k+1] - offsets[k];
+            chunk.resize(length);
+            if (pread(fd, &chunk[0], length, (off_t) offsets[k]) != (ssize_t) length) {
+                failed[i] = 1;
+                break;
+            }
+
+            // The columns of the chunk in the rectangle
+            int from = std::max(left, chunkLeft), to = std::min(left + width, chunkLeft + chunkWidth);
+            auto copyRow = [&](int r, const uint64_t *right, const uint64_t *down) {
+                if (r < top || r >= top + height) return;
+                copyBits(right, from - chunkLeft, rect.rightRow(r - top), from - left, to - from);
+                copyBits(down, from - chunkLeft, rect.downRow(r - top), from - left, to - from);
+            };
+            if (length == rawBytes(chunkHeight, chunkWidth)) {
+                int chunkWords = (chunkWidth + 63) / 64;
+                words.resize(length / sizeof(uint64_t));
+                memcpy(&words[0], &chunk[0], length);
+                for (int r=0; r < chunkHeight; r++) {
+                    copyRow(chunkTop + r, &words[2 * r * chunkWords], &words[(2 * r + 1) * chunkWords]);
+                }
+            } else if (!WallCoder::decode(&chunk[0], length, rows, cols,
+                    chunkTop, chunkLeft, chunkHeight, chunkWidth, copyRow)) {
+                failed[i] = 2;
+            }
+        }
+    });
+    for (size_t i=0; i < failed.size(); i++) {
+        if (failed[i]) {
+            error = failed[i] == 1 ? "can't read the file" : "a chunk of the file is cut short";
+            return false;
+        }
+    }
+
+    // The rectangle's own boundary
+    uint64_t lastBit = (uint64_t) 1 << ((width - 1) % 64);
+    for (int r=0; r < height; r++) rect.rightRow(r)[(width - 1) / 64] |= lastBit;
+    std::fill(rect.downRow(height - 1), rect.downRow(height - 1) + rect.wordsPerRow(), ~(uint64_t) 0);
+
+    chunksRead = (long) (lastRow - firstRow + 1) * (lastCol - firstCol + 1);
+    walls = std::move(rect);
+    error.clear();
+    return true;
+}
+
+bool ChunkedMazeFile::load(const std::string& path, WallBits& walls) {
+    return open(path) && loadRect(0, 0, rows, cols, walls);
+}
+
+#endif /* CHUNKEDMAZEFILE_CPP_ */
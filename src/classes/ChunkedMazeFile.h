@@ -0,0 +1,197 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ChunkedMazeFile.h
+ * @brief Contains the declaration of the ChunkedMazeFile class.
+ */
+
+#ifndef CHUNKEDMAZEFILE_H_
+#define CHUNKEDMAZEFILE_H_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "WallBits.h"
+
+/**
+ * @brief Reads and writes mazes in the chunked .mzc format, which can be
+ * read a rectangle at a time.
+ *
+ * The maze is cut into square chunks of chunkSize nodes along each side
+ * (smaller at the right and bottom edges), stored one after another a row
+ * of chunks at a time. A chunk is compressed with WallCoder, on its own,
+ * unless that wouldn't make it smaller than its raw walls (or compress is
+ * false), in which case it holds its rows as they are: for each row, the
+ * right walls and then the down walls of its nodes, (width+63)/64 64-bit
+ * words each. The two kinds are told apart by their length.
+ *
+ * The file is a 128-byte header, laid out like that of a .maze file (see
+ * MazeFile) but starting with the magic "MAZECUTC" and holding the chunk
+ * size in place of the words per row; then the 64-bit offsets in the file
+ * of each chunk, and of the end of the last one; then the chunks. Numbers
+ * are in the byte order of the machine that wrote the file.
+ *
+ * open() reads just the header and the offsets, and loadRect() then reads
+ * and decodes only the chunks that the rectangle asked for overlaps, so
+ * loading a window of a huge maze costs about as much as the window.
+ * Chunks are written and read on one thread per core.
+ */
+class ChunkedMazeFile {
+
+public:
+    /**
+     * @brief The version of the format written by save()
+     */
+    static const uint32_t VERSION = 1;
+
+    /**
+     * @brief Nodes along the side of a chunk, unless chunkSize is changed
+     */
+    static const int CHUNKSIZE = 256;
+
+    /**
+     * @brief Tell whether a file name is that of a chunked maze
+     *
+     * @param path name of the file
+     * @return true if it ends in .mzc, in any case
+     */
+    static bool isChunked(const std::string& path);
+
+    ChunkedMazeFile();
+    ~ChunkedMazeFile();
+
+    /**
+     * @brief Write a maze to a file
+     *
+     * The algorithm, seed and perfect fields are written as the maze's
+     * metadata, and chunks are chunkSize nodes along each side.
+     *
+     * @param path name of the file
+     * @param walls the maze
+     * @return true if success; otherwise error says why
+     */
+    bool save(const std::string& path, const WallBits& walls);
+
+    /**
+     * @brief Open a file for reading with loadRect()
+     *
+     * Fills in the algorithm, seed, perfect and chunkSize fields, and the
+     * size of the maze, from the file.
+     *
+     * @param path name of the file
+     * @return true if success; otherwise error says why
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Read a rectangle of the maze from the open file, decoding only
+     * the chunks it overlaps
+     *
+     * The rectangle comes back as a maze of its own, so the walls on its
+     * right and bottom edges are up whatever they are in the whole maze.
+     *
+     * @param top first row of the rectangle
+     * @param left first column of the rectangle
+     * @param height rows in the rectangle
+     * @param width columns in the rectangle
+     * @param walls set to the rectangle
+     * @return true if success; otherwise error says why
+     */
+    bool loadRect(int top, int left, int height, int width, WallBits& walls);
+
+    /**
+     * @brief Read a whole maze from a file
+     *
+     * @param path name of the file
+     * @param walls set to the maze
+     * @return true if success; otherwise error says why
+     */
+    bool load(const std::string& path, WallBits& walls);
+
+    /**
+     * @brief Rows and columns of the maze in the open file
+     */
+    int numRows() const { return rows; }
+    int numCols() const { return cols; }
+
+    /**
+     * @brief Name of the algorithm that generated the maze
+     */
+    std::string algorithm;
+
+    /**
+     * @brief Seed the maze was generated with
+     */
+    uint64_t seed;
+
+    /**
+     * @brief Whether the maze is perfect (has no loops)
+     */
+    bool perfect;
+
+    /**
+     * @brief Nodes along the side of a chunk
+     */
+    int chunkSize;
+
+    /**
+     * @brief Whether save() compresses the chunks
+     */
+    bool compress;
+
+    /**
+     * @brief Size of the file written by the last save(), in bytes
+     */
+    uint64_t bytes;
+
+    /**
+     * @brief Number of chunks decoded by the last loadRect()
+     */
+    long chunksRead;
+
+    /**
+     * @brief Why the last save(), open(), loadRect() or load() failed
+     */
+    std::string error;
+
+private:
+
+    /**
+     * @brief Bytes in a raw chunk of the given size
+     */
+    static uint64_t rawBytes(int height, int width);
+
+    /**
+     * @brief The open file, or -1
+     */
+    int fd;
+
+    /**
+     * @brief Size of the maze, and of its grid of chunks
+     */
+    int rows, cols, chunkRows, chunkCols;
+
+    /**
+     * @brief Where each chunk starts in the file (and where the last ends)
+     */
+    std::vector<uint64_t> offsets;
+};
+
+#endif /* CHUNKEDMAZEFILE_H_ */
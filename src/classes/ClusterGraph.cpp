@@ -0,0 +1,418 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ClusterGraph.cpp
+ * @brief Contains the methods of the ClusterGraph class.
+ */
+
+#ifndef CLUSTERGRAPH_CPP_
+#define CLUSTERGRAPH_CPP_
+
+#include <algorithm>
+#include <cstdlib>
+#include "ClusterGraph.h"
+#include "MazeSolver.h"
+#include "ParallelBands.h"
+
+ClusterGraph::ClusterGraph() {
+    walls = NULL;
+    size = 0;
+    clusterRows = 0;
+    clusterCols = 0;
+    lastEntrance = -1;
+    numExpanded = 0;
+}
+
+void ClusterGraph::build(const WallBits& w, int clusterSize) {
+    walls = &w;
+    size = clusterSize;
+    clusterRows = (walls->numRows() + size - 1) / size;
+    clusterCols = (walls->numCols() + size - 1) / size;
+
+    long n = numClusters();
+    entrances.assign(n, std::vector<long>());
+    edgeOffsets.assign(n, std::vector<int>());
+    edges.assign(n, std::vector<std::pair<int, int> >());
+    stale.assign(n, true);
+    staleClusters.resize(n);
+    for (long k=0; k < n; k++) staleClusters[k] = (int) k;
+
+    update();
+}
+
+void ClusterGraph::wallChanged(int r, int c, int dir) {
+    int k = clusterOf(r, c);
+    if (!stale[k]) {
+        stale[k] = true;
+        staleClusters.push_back(k);
+    }
+
+    int next_r = r, next_c = c;
+    switch (dir) {
+    case RIGHT: next_c++; break;
+    case UP:    next_r--; break;
+    case LEFT:  next_c--; break;
+    case DOWN:  next_r++; break;
+    }
+    if (next_r < 0 || next_r >= walls->numRows() || next_c < 0 || next_c >= walls->numCols()) return;
+
+    k = clusterOf(next_r, next_c);
+    if (!stale[k]) {
+        stale[k] = true;
+        staleClusters.push_back(k);
+    }
+}
+
+long ClusterGraph::update() {
+    long count = (long) staleClusters.size();
+    if (count == 0) return 0;
+
+    forEachChunk(count, 16, [&](int, long first, long last) {
+        for (long i=first; i < last; i++) buildCluster(staleClusters[i]);
+    });
+
+    for (long i=0; i < count; i++) stale[staleClusters[i]] = false;
+    staleClusters.clear();
+
+    // Number the entrances again, since the counts may have changed
+    long n = numClusters();
+    firstEntrance.resize(n + 1);
+    firstEntrance[0] = 0;
+    for (long k=0; k < n; k++) {
+        firstEntrance[k+1] = firstEntrance[k] + (long) entrances[k].size();
+    }
+    entranceClusters.resize(firstEntrance[n]);
+    for (long k=0; k < n; k++) {
+        for (long v = firstEntrance[k]; v < firstEntrance[k+1]; v++) entranceClusters[v] = (int) k;
+    }
+
+    return count;
+}
+
+int ClusterGraph::localIndex(int k, long node) const {
+    int cols = walls->numCols();
+    int r0 = (k / clusterCols) * size, c0 = (k % clusterCols) * size;
+    int width = std::min(size, cols - c0);
+    return ((int) (node / cols) - r0) * width + (int) (node % cols) - c0;
+}
+
+void ClusterGraph::clusterMoves(int k, std::vector<uint8_t>& moves) const {
+    int rows = walls->numRows(), cols = walls->numCols();
+    int r0 = (k / clusterCols) * size, c0 = (k % clusterCols) * size;
+    int height = std::min(size, rows - r0), width = std::min(size, cols - c0);
+
+    moves.resize(height * width);
+    for (int r=0; r < height; r++) {
+        for (int c=0; c < width; c++) {
+            uint8_t mask = 0;
+            if (c < width - 1 && !walls->wall(r0 + r, c0 + c, RIGHT)) mask |= 1 << RIGHT;
+            if (r > 0 && !walls->wall(r0 + r, c0 + c, UP)) mask |= 1 << UP;
+            if (c > 0 && !walls->wall(r0 + r, c0 + c, LEFT)) mask |= 1 << LEFT;
+            if (r < height - 1 && !walls->wall(r0 + r, c0 + c, DOWN)) mask |= 1 << DOWN;
+            moves[r * width + c] = mask;
+        }
+    }
+}
+
+void ClusterGraph::searchCluster(int k, const std::vector<uint8_t>& moves,
+        int from, std::vector<int>& dist, std::vector<int>& queue,
+        std::vector<uint8_t> *parentDirs, const std::vector<uint8_t> *stops,
+        std::vector<uint8_t> *direct) const {
+    int c0 = (k % clusterCols) * size;
+    int width = std::min(size, walls->numCols() - c0);
+    int count = (int) moves.size();
+
+    dist.assign(count, -1);
+    if ((int) queue.size() < count) queue.resize(count);
+    if (parentDirs) parentDirs->resize(count);
+    if (direct) direct->assign(count, 0);
+
+    int head = 0, tail = 0;
+    dist[from] = 0;
+    if (direct) (*direct)[from] = 1;
+    queue[tail++] = from;
+
+    while (head < tail) {
+        int i = queue[head++];
+        // Whether paths through i still haven't gone through an entrance;
+        // every node one level down gets this from all its parents before
+        // it comes off the queue
+        bool pass = direct && (*direct)[i] && (i == from || !(*stops)[i]);
+
+        for (int dir=RIGHT; dir <= DOWN; dir++) {
+            if (!((moves[i] >> dir) & 1)) continue;
+
+            int next = i;
+            switch (dir) {
+            case RIGHT: next += 1; break;
+            case UP:    next -= width; break;
+            case LEFT:  next -= 1; break;
+            case DOWN:  next += width; break;
+            }
+
+            if (dist[next] >= 0) {
+                if (pass && dist[next] == dist[i] + 1) (*direct)[next] = 1;
+                continue;
+            }
+            dist[next] = dist[i] + 1;
+            if (parentDirs) (*parentDirs)[next] = (uint8_t) dir;
+            if (pass) (*direct)[next] = 1;
+            queue[tail++] = next;
+        }
+    }
+}
+
+void ClusterGraph::buildCluster(int k) {
+    int rows = walls->numRows(), cols = walls->numCols();
+    int r0 = (k / clusterCols) * size, c0 = (k % clusterCols) * size;
+    int height = std::min(size, rows - r0), width = std::min(size, cols - c0);
+
+    // Walk the border in row-major order so the entrances come out sorted
+    std::vector<long>& found = entrances[k];
+    found.clear();
+    for (int r = r0; r < r0 + height; r++) {
+        bool edgeRow = r == r0 || r == r0 + height - 1;
+        for (int c = c0; c < c0 + width; c++) {
+            if (!edgeRow && c != c0 && c != c0 + width - 1) continue;
+
+            bool entrance = (r == r0 && r > 0 && !walls->wall(r, c, UP)) ||
+                    (r == r0 + height - 1 && r < rows - 1 && !walls->wall(r, c, DOWN)) ||
+                    (c == c0 && c > 0 && !walls->wall(r, c, LEFT)) ||
+                    (c == c0 + width - 1 && c < cols - 1 && !walls->wall(r, c, RIGHT));
+            if (entrance) found.push_back((long) r * cols + c);
+        }
+    }
+
+    int m = (int) found.size();
+    std::vector<uint8_t> moves, stops(height * width, 0), direct;
+    std::vector<int> dist, queue, positions(m);
+    clusterMoves(k, moves);
+    for (int i=0; i < m; i++) {
+        positions[i] = localIndex(k, found[i]);
+        stops[positions[i]] = 1;
+    }
+
+    std::vector<int>& offsets = edgeOffsets[k];
+    std::vector<std::pair<int, int> >& list = edges[k];
+    offsets.resize(m + 1);
+    list.clear();
+    for (int i=0; i < m; i++) {
+        offsets[i] = (int) list.size();
+        searchCluster(k, moves, positions[i], dist, queue, NULL, &stops, &direct);
+        for (int j=0; j < m; j++) {
+            if (j != i && dist[positions[j]] > 0 && direct[positions[j]]) {
+                list.push_back(std::make_pair(j, dist[positions[j]]));
+            }
+        }
+    }
+    offsets[m] = (int) list.size();
+}
+
+int ClusterGraph::search(long start, long end) {
+    int cols = walls->numCols();
+    int start_r = (int) (start / cols), start_c = (int) (start % cols);
+    int end_r = (int) (end / cols), end_c = (int) (end % cols);
+    int startCluster = clusterOf(start_r, start_c);
+    int endCluster = clusterOf(end_r, end_c);
+    long n = numEntrances();
+
+    // Inside a cluster no path is longer than the number of nodes in it, so
+    // an edge raises the f-score by less than twice that
+    long ring = 1;
+    while (ring <= 2 * (long) size * size) ring <<= 1;
+
+    if ((long) gScore.size() < n) gScore.resize(n);
+    if ((long) parents.size() < n) parents.resize(n);
+    opened.assign((n + 63) / 64, 0);
+    closed.assign(opened.size(), 0);
+    if ((long) buckets.size() < ring) buckets.resize(ring);
+    for (long b=0; b < ring; b++) buckets[b].clear();
+    numExpanded = 0;
+    lastEntrance = -1;
+
+    if (start == end) return 0;
+
+    // How far the end is from each entrance of its cluster
+    const std::vector<long>& exits = entrances[endCluster];
+    clusterMoves(endCluster, localMoves);
+    searchCluster(endCluster, localMoves, localIndex(endCluster, end), localDist,
+            localQueue, NULL, NULL, NULL);
+    endDistances.resize(exits.size());
+    for (size_t j=0; j < exits.size(); j++) {
+        endDistances[j] = localDist[localIndex(endCluster, exits[j])];
+    }
+    int best = startCluster == endCluster ? localDist[localIndex(endCluster, start)] : -1;
+
+    // Start from every entrance of the start's cluster it can reach
+    const std::vector<long>& starts = entrances[startCluster];
+    clusterMoves(startCluster, localMoves);
+    searchCluster(startCluster, localMoves, localIndex(startCluster, start),
+            localDist, localQueue, NULL, NULL, NULL);
+    long queued = 0;
+    int f = -1;
+    for (size_t i=0; i < starts.size(); i++) {
+        int g = localDist[localIndex(startCluster, starts[i])];
+        if (g < 0) continue;
+        long v = firstEntrance[startCluster] + (long) i;
+        opened[v >> 6] |= (uint64_t)1 << (v & 63);
+        gScore[v] = g;
+        parents[v] = -1;
+        int v_f = g + abs((int) (starts[i] / cols) - end_r) + abs((int) (starts[i] % cols) - end_c);
+        buckets[v_f & (ring - 1)].push_back(v);
+        ++queued;
+        if (f < 0 || v_f < f) f = v_f;
+    }
+
+    while (queued > 0) {
+        while (buckets[f & (ring - 1)].empty()) f++;
+        if (best >= 0 && f >= best) break;
+
+        std::vector<long>& bucket = buckets[f & (ring - 1)];
+        long v = bucket.back();
+        bucket.pop_back();
+        --queued;
+
+        if ((closed[v >> 6] >> (v & 63)) & 1) continue;
+        closed[v >> 6] |= (uint64_t)1 << (v & 63);
+        ++numExpanded;
+
+        int k = entranceClusters[v];
+        int i = (int) (v - firstEntrance[k]);
+        long node = entrances[k][i];
+        int g = gScore[v];
+
+        if (k == endCluster && endDistances[i] >= 0 && (best < 0 || g + endDistances[i] < best)) {
+            best = g + endDistances[i];
+            lastEntrance = v;
+        }
+
+        auto relax = [&](long u, int weight) {
+            if ((closed[u >> 6] >> (u & 63)) & 1) return;
+            int next_g = g + weight;
+            bool seen = (opened[u >> 6] >> (u & 63)) & 1;
+            if (seen && gScore[u] <= next_g) return;
+
+            opened[u >> 6] |= (uint64_t)1 << (u & 63);
+            gScore[u] = next_g;
+            parents[u] = v;
+
+            int u_k = entranceClusters[u];
+            long cell = entrances[u_k][u - firstEntrance[u_k]];
+            int next_f = next_g + abs((int) (cell / cols) - end_r) + abs((int) (cell % cols) - end_c);
+            buckets[next_f & (ring - 1)].push_back(u);
+            ++queued;
+        };
+
+        // The other entrances of the cluster
+        const std::vector<std::pair<int, int> >& list = edges[k];
+        for (int e = edgeOffsets[k][i]; e < edgeOffsets[k][i+1]; e++) {
+            relax(firstEntrance[k] + list[e].first, list[e].second);
+        }
+
+        // The entrances next door that this one opens onto
+        int node_r = (int) (node / cols), node_c = (int) (node % cols);
+        for (int dir=RIGHT; dir <= DOWN; dir++) {
+            if (walls->wall(node_r, node_c, dir)) continue;
+            long next = stepIndex(node, dir, cols);
+            int nextCluster = clusterOf((int) (next / cols), (int) (next % cols));
+            if (nextCluster == k) continue;
+            const std::vector<long>& other = entrances[nextCluster];
+            long j = std::lower_bound(other.begin(), other.end(), next) - other.begin();
+            relax(firstEntrance[nextCluster] + j, 1);
+        }
+    }
+
+    return best;
+}
+
+int ClusterGraph::distance(int start_r, int start_c, int end_r, int end_c) {
+    update();
+    int cols = walls->numCols();
+    return search((long) start_r * cols + start_c, (long) end_r * cols + end_c);
+}
+
+void ClusterGraph::appendClusterPath(long from, long to,
+        std::vector<unsigned char>& path) {
+    int cols = walls->numCols();
+    int k = clusterOf((int) (from / cols), (int) (from % cols));
+    int width = std::min(size, cols - (k % clusterCols) * size);
+
+    clusterMoves(k, localMoves);
+    searchCluster(k, localMoves, localIndex(k, from), localDist, localQueue,
+            &localParents, NULL, NULL);
+
+    size_t first = path.size();
+    for (int i = localIndex(k, to), stop = localIndex(k, from); i != stop; ) {
+        int dir = localParents[i];
+        path.push_back((unsigned char) dir);
+        switch (dir) {
+        case RIGHT: i -= 1; break;
+        case UP:    i += width; break;
+        case LEFT:  i += 1; break;
+        case DOWN:  i -= width; break;
+        }
+    }
+    std::reverse(path.begin() + first, path.end());
+}
+
+int ClusterGraph::path(int start_r, int start_c, int end_r, int end_c,
+        std::vector<unsigned char>& path) {
+    update();
+    int cols = walls->numCols();
+    long start = (long) start_r * cols + start_c;
+    long end = (long) end_r * cols + end_c;
+
+    path.clear();
+    int length = search(start, end);
+    if (length <= 0) return length;
+
+    if (lastEntrance < 0) {
+        appendClusterPath(start, end, path);
+        return length;
+    }
+
+    // The entrances the route passes through, first to last
+    std::vector<long> nodes;
+    for (long v = lastEntrance; v >= 0; v = parents[v]) {
+        int k = entranceClusters[v];
+        nodes.push_back(entrances[k][v - firstEntrance[k]]);
+    }
+    std::reverse(nodes.begin(), nodes.end());
+
+    appendClusterPath(start, nodes[0], path);
+    for (size_t i=1; i < nodes.size(); i++) {
+        long a = nodes[i-1], b = nodes[i];
+        if (clusterOf((int) (a / cols), (int) (a % cols)) == clusterOf((int) (b / cols), (int) (b % cols))) {
+            appendClusterPath(a, b, path);
+            continue;
+        }
+        // A crossing between clusters is a single step (by row first, since
+        // with one column a step down also adds one to the node's number)
+        if (b / cols > a / cols) path.push_back(DOWN);
+        else if (b / cols < a / cols) path.push_back(UP);
+        else if (b > a) path.push_back(RIGHT);
+        else path.push_back(LEFT);
+    }
+    appendClusterPath(nodes.back(), end, path);
+
+    return length;
+}
+
+#endif /* CLUSTERGRAPH_CPP_ */
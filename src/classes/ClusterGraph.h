@@ -0,0 +1,327 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ClusterGraph.h
+ * @brief Contains the declaration of the ClusterGraph class.
+ */
+
+#ifndef CLUSTERGRAPH_H_
+#define CLUSTERGRAPH_H_
+
+#include <vector>
+#include <stdint.h>
+#include "constants.h"
+#include "WallBits.h"
+
+/**
+ * @brief Hierarchical path finding (in the style of HPA*) for big mazes with
+ * loops.
+ *
+ * The maze is cut into square clusters. Every node next to an open wall
+ * between two clusters is an entrance, and for each cluster the distances
+ * between its entrances (staying inside the cluster) are worked out ahead of
+ * time. The entrances, joined by those distances and by the one-step
+ * crossings between clusters, make a small abstract graph.
+ *
+ * A query searches only the clusters holding its two ends, to link them to
+ * their entrances, and then runs A* over the abstract graph. Since every open
+ * crossing is an entrance, the distances it finds are exact. Paths are turned
+ * back into steps by searching inside each cluster the route passes through.
+ *
+ * The clusters are built in parallel. After walls change, wallChanged()
+ * marks the clusters on either side of each wall, and only those are built
+ * again (on the next query, or by calling update()).
+ *
+ * The graph keeps a pointer to the maze, so the maze must outlive it. A
+ * ClusterGraph answers one query at a time, since it keeps its search
+ * workspace from one query to the next.
+ */
+class ClusterGraph {
+
+public:
+    ClusterGraph();
+
+    /**
+     * @brief Build the abstraction for a maze
+     *
+     * @param walls the maze
+     * @param size width and height of a cluster, in nodes
+     */
+    void build(const WallBits& walls, int size = 32);
+
+    /**
+     * @brief Mark the clusters on either side of a wall as out of date
+     *
+     * @param r row of the node
+     * @param c column of the node
+     * @param dir direction of the wall from the node (RIGHT, UP, LEFT, DOWN)
+     */
+    void wallChanged(int r, int c, int dir);
+
+    /**
+     * @brief Build again the clusters that are out of date
+     *
+     * @return the number of clusters built
+     */
+    long update();
+
+    /**
+     * @brief get the number of clusters
+     *
+     * @return number of clusters
+     */
+    long numClusters() const { return (long) clusterRows * clusterCols; }
+
+    /**
+     * @brief get the number of entrances in the abstract graph
+     *
+     * @return number of entrances
+     */
+    long numEntrances() const { return firstEntrance.empty() ? 0 : firstEntrance.back(); }
+
+    /**
+     * @brief Find the length of a shortest path between two nodes
+     *
+     * @param start_r the row of the starting node
+     * @param start_c the column of the starting node
+     * @param end_r the row of the ending node
+     * @param end_c the column of the ending node
+     * @return length of the path, or -1 if there isn't one
+     */
+    int distance(int start_r, int start_c, int end_r, int end_c);
+
+    /**
+     * @brief Find a shortest path between two nodes
+     *
+     * @param start_r the row of the starting node
+     * @param start_c the column of the starting node
+     * @param end_r the row of the ending node
+     * @param end_c the column of the ending node
+     * @param path filled with the directions to take from the start
+     * @return length of the path, or -1 if there isn't one
+     */
+    int path(int start_r, int start_c, int end_r, int end_c,
+            std::vector<unsigned char>& path);
+
+    /**
+     * @brief get the number of entrances the last query took off its open
+     * list
+     *
+     * @return entrances expanded
+     */
+    long expanded() const { return numExpanded; }
+
+private:
+
+    /**
+     * @brief Get the cluster a node is in
+     *
+     * @param r row of the node
+     * @param c column of the node
+     * @return cluster index (cluster row * clusterCols + cluster column)
+     */
+    int clusterOf(int r, int c) const {
+        return (r / size) * clusterCols + c / size;
+    }
+
+    /**
+     * @brief Find the entrances of a cluster and the edges between them
+     *
+     * An edge from one entrance to another is only kept if a shortest path
+     * between them inside the cluster doesn't pass through a third
+     * entrance. Otherwise the path through the third one is just as short,
+     * so the edge adds nothing but work for the search.
+     *
+     * @param k the cluster
+     */
+    void buildCluster(int k);
+
+    /**
+     * @brief Work out the moves that stay inside a cluster
+     *
+     * @param k the cluster
+     * @param moves filled with a mask per node of the cluster, by position
+     * in the cluster, with bit dir set if a step in direction dir is open
+     * and stays inside the cluster
+     */
+    void clusterMoves(int k, std::vector<uint8_t>& moves) const;
+
+    /**
+     * @brief Breadth-first search from a node without leaving its cluster
+     *
+     * @param k the cluster of the node
+     * @param moves the moves of the cluster, from clusterMoves()
+     * @param from position of the node in the cluster
+     * @param dist filled with the distance to each node of the cluster, -1
+     * if it can't be reached, indexed by position in the cluster
+     * @param queue workspace
+     * @param parentDirs if not NULL, filled with the direction each node was
+     * reached in
+     * @param stops if not NULL, flags the nodes that count as entrances for
+     * direct
+     * @param direct if not NULL, filled with 1 for the nodes that some
+     * shortest path from the start reaches without going through a node
+     * flagged in stops
+     */
+    void searchCluster(int k, const std::vector<uint8_t>& moves, int from,
+            std::vector<int>& dist, std::vector<int>& queue,
+            std::vector<uint8_t> *parentDirs, const std::vector<uint8_t> *stops,
+            std::vector<uint8_t> *direct) const;
+
+    /**
+     * @brief Get the position of a node within its cluster
+     *
+     * @param k the cluster
+     * @param node index of the node
+     * @return row within the cluster * cluster width + column within it
+     */
+    int localIndex(int k, long node) const;
+
+    /**
+     * @brief Append the steps of a shortest path inside a cluster
+     *
+     * @param from index of the first node
+     * @param to index of the last node (in the same cluster)
+     * @param path the steps are appended to it
+     */
+    void appendClusterPath(long from, long to, std::vector<unsigned char>& path);
+
+    /**
+     * @brief Link the ends of a query to their entrances and run A* over
+     * the abstract graph
+     *
+     * @param start index of the starting node
+     * @param end index of the ending node
+     * @return length of the path, or -1 if there isn't one
+     */
+    int search(long start, long end);
+
+    /**
+     * @brief The maze
+     */
+    const WallBits *walls;
+
+    /**
+     * @brief Width and height of a cluster
+     */
+    int size;
+
+    /**
+     * @brief Number of rows of clusters
+     */
+    int clusterRows;
+
+    /**
+     * @brief Number of columns of clusters
+     */
+    int clusterCols;
+
+    /**
+     * @brief Entrance nodes of each cluster, sorted
+     */
+    std::vector<std::vector<long> > entrances;
+
+    /**
+     * @brief Index into edges of the first edge of each entrance of each
+     * cluster, plus the end of the last one
+     */
+    std::vector<std::vector<int> > edgeOffsets;
+
+    /**
+     * @brief Edges between the entrances of each cluster, as (entrance in
+     * the cluster, distance) pairs
+     */
+    std::vector<std::vector<std::pair<int, int> > > edges;
+
+    /**
+     * @brief Number of entrances before each cluster, plus the total at the
+     * end, so entrance i of cluster k is number firstEntrance[k] + i in the
+     * abstract graph
+     */
+    std::vector<long> firstEntrance;
+
+    /**
+     * @brief Cluster of each entrance in the abstract graph
+     */
+    std::vector<int> entranceClusters;
+
+    /**
+     * @brief Whether each cluster is out of date
+     */
+    std::vector<bool> stale;
+
+    /**
+     * @brief The clusters that are out of date
+     */
+    std::vector<int> staleClusters;
+
+    /**
+     * @brief Search workspace: best known distance to each entrance
+     */
+    std::vector<int> gScore;
+
+    /**
+     * @brief Search workspace: entrance each entrance was reached from, or
+     * -1 for the ones linked to the start
+     */
+    std::vector<long> parents;
+
+    /**
+     * @brief Search workspace: entrances given a g-score, one bit each
+     */
+    std::vector<uint64_t> opened;
+
+    /**
+     * @brief Search workspace: entrances expanded, one bit each
+     */
+    std::vector<uint64_t> closed;
+
+    /**
+     * @brief Search workspace: ring of buckets of entrances, by f-score
+     */
+    std::vector<std::vector<long> > buckets;
+
+    /**
+     * @brief Search workspace: distance from the end to each entrance of the
+     * end's cluster, -1 if it can't be reached inside the cluster
+     */
+    std::vector<int> endDistances;
+
+    /**
+     * @brief Search workspace: the entrance the best path so far leaves the
+     * abstract graph from, or -1 if it stays inside one cluster
+     */
+    long lastEntrance;
+
+    /**
+     * @brief Workspace for clusterMoves() and searchCluster()
+     */
+    std::vector<uint8_t> localMoves;
+    std::vector<int> localDist;
+    std::vector<int> localQueue;
+    std::vector<uint8_t> localParents;
+
+    /**
+     * @brief Entrances expanded by the last query
+     */
+    long numExpanded;
+};
+
+#endif /* CLUSTERGRAPH_H_ */
@@ -0,0 +1,258 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file CompressedMazeFile.cpp
+ * @brief Contains the methods of the CompressedMazeFile class.
+ */
+
+#ifndef COMPRESSEDMAZEFILE_CPP_
+#define COMPRESSEDMAZEFILE_CPP_
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "CompressedMazeFile.h"
+#include "WallCoder.h"
+#include "ParallelBands.h"
+
+/*
+ * The header, as it sits at the start of the file
+ */
+struct CompressedMazeHeader {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t version;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t blockRows;
+    uint32_t blocks;
+    uint64_t seed;
+    uint32_t flags;
+    uint32_t reserved0;
+    char algorithm[32];
+    char reserved[48];
+};
+
+static_assert(sizeof(CompressedMazeHeader) == 128, "the header is 128 bytes");
+
+static const char MAGIC[8] = {'M', 'A', 'Z', 'E', 'C', 'U', 'T', 'Z'};
+static const uint32_t BYTEORDER = 0x01020304;
+static const uint32_t PERFECTFLAG = 1;
+
+bool CompressedMazeFile::isCompressed(const std::string& path) {
+    std::string::size_type dot = path.rfind('.');
+    if (dot == std::string::npos) return false;
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == "mzz";
+}
+
+CompressedMazeFile::CompressedMazeFile() {
+    seed = 0;
+    perfect = true;
+    bytes = 0;
+}
+
+bool CompressedMazeFile::save(const std::string& path, const WallBits& walls) {
+    int rows = walls.numRows(), cols = walls.numCols();
+    if (rows < 1 || cols < 1) {
+        error = "the maze is empty";
+        return false;
+    }
+    int blockRows = std::max(1, std::min(rows, (BLOCKNODES + cols - 1) / cols));
+    int blocks = (rows + blockRows - 1) / blockRows;
+
+    CompressedMazeHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.byteOrder = BYTEORDER;
+    header.version = VERSION;
+    header.rows = rows;
+    header.cols = cols;
+    header.blockRows = blockRows;
+    header.blocks = blocks;
+    header.flags = perfect ? PERFECTFLAG : 0;
+    header.seed = seed;
+    strncpy(header.algorithm, algorithm.c_str(), sizeof(header.algorithm) - 1);
+
+    FILE *out = fopen(path.c_str(), "wb");
+    if (!out) {
+        error = "can't open the file for writing";
+        return false;
+    }
+
+    // The offsets are only known once the blocks are written, so they are
+    // written last, in the space left for them
+    std::vector<uint64_t> offsets(blocks + 1);
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+            fwrite(&offsets[0], sizeof(uint64_t), offsets.size(), out) == offsets.size();
+    uint64_t offset = sizeof(header) + offsets.size() * sizeof(uint64_t);
+    int written = 0;
+    forEachChunkInOrder(blocks, 1,
+            [&](long first, long, std::vector<char>& block) {
+                int top = (int) first * blockRows;
+                WallCoder::encode(walls, top, 0, std::min(blockRows, rows - top), cols, block);
+            },
+            [&](const std::vector<char>& block) {
+                offsets[written++] = offset;
+                offset += block.size();
+                ok = ok && fwrite(&block[0], 1, block.size(), out) == block.size();
+            });
+    offsets[blocks] = offset;
+    ok = ok && fseek(out, sizeof(header), SEEK_SET) == 0 &&
+            fwrite(&offsets[0], sizeof(uint64_t), offsets.size(), out) == offsets.size();
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+        error = "can't write the file";
+        return false;
+    }
+    bytes = offset;
+    error.clear();
+    return true;
+}
+
+FILE *CompressedMazeFile::openAndCheck(const std::string& path, int& rows, int& cols,
+        int& blockRows, std::vector<uint64_t>& offsets) {
+    FILE *in = fopen(path.c_str(), "rb");
+    if (!in) {
+        error = "can't open the file";
+        return NULL;
+    }
+    fseek(in, 0, SEEK_END);
+    uint64_t length = (uint64_t) ftell(in);
+    rewind(in);
+
+    CompressedMazeHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1) {
+        error = "the file is too short to be a compressed maze";
+        fclose(in);
+        return NULL;
+    }
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = "not a compressed maze file";
+    } else if (header.byteOrder != BYTEORDER) {
+        error = "the file was written on a machine with a different byte order";
+    } else if (header.version != VERSION) {
+        error = "unknown version of the compressed maze format";
+    } else if (header.rows == 0 || header.cols == 0 || header.rows > 0x7fffffff ||
+            header.cols > 0x7fffffff || header.blockRows == 0 ||
+            header.blocks != (header.rows + (uint64_t) header.blockRows - 1) / header.blockRows ||
+            sizeof(header) + (header.blocks + (uint64_t) 1) * sizeof(uint64_t) > length) {
+        error = "the header doesn't match the size of the file";
+    }
+    if (!error.empty()) {
+        fclose(in);
+        return NULL;
+    }
+
+    // The blocks have to follow each other and end with the file
+    offsets.resize(header.blocks + 1);
+    bool ok = fread(&offsets[0], sizeof(uint64_t), offsets.size(), in) == offsets.size();
+    uint64_t start = sizeof(header) + offsets.size() * sizeof(uint64_t);
+    for (size_t k=0; ok && k < offsets.size(); k++) {
+        ok = offsets[k] >= (k == 0 ? start : offsets[k-1]);
+    }
+    if (!ok || offsets[0] != start || offsets.back() != length) {
+        error = "the block offsets don't match the size of the file";
+        fclose(in);
+        return NULL;
+    }
+
+    rows = (int) header.rows;
+    cols = (int) header.cols;
+    blockRows = (int) header.blockRows;
+    algorithm.assign(header.algorithm, strnlen(header.algorithm, sizeof(header.algorithm)));
+    seed = header.seed;
+    perfect = (header.flags & PERFECTFLAG) != 0;
+    return in;
+}
+
+bool CompressedMazeFile::decodeBlocks(FILE *in, int rows, int cols, int blockRows,
+        const std::vector<uint64_t>& offsets, int first, int last, int top, WallBits& walls) {
+    // Read the blocks in one go, then decode them on one thread per core
+    std::vector<char> data(offsets[last] - offsets[first] + 1);
+    if (fseek(in, (long) offsets[first], SEEK_SET) != 0 ||
+            fread(&data[0], 1, data.size() - 1, in) != data.size() - 1) {
+        error = "can't read the file";
+        return false;
+    }
+
+    int words = walls.wordsPerRow();
+    int lastRow = walls.numRows() - 1;
+    std::vector<char> good(last - first, 1);
+    forEachChunk(last - first, 1, [&](int, long k, long) {
+        int block = first + (int) k;
+        int blockTop = block * blockRows;
+        good[k] = WallCoder::decode(&data[offsets[block] - offsets[first]],
+                offsets[block+1] - offsets[block], rows, cols,
+                blockTop, 0, std::min(blockRows, rows - blockTop), cols,
+                [&](int r, const uint64_t *right, const uint64_t *down) {
+                    int row = r - top;
+                    if (row < 0 || row > lastRow) return;
+                    for (int w=0; w < words; w++) {
+                        walls.rightRow(row)[w] = right[w] | ~walls.validMask(w);
+                        walls.downRow(row)[w] = row == lastRow ? ~(uint64_t)0
+                                : down[w] | ~walls.validMask(w);
+                    }
+                });
+    });
+    if (std::find(good.begin(), good.end(), 0) != good.end()) {
+        error = "a block of the file is cut short";
+        return false;
+    }
+    return true;
+}
+
+bool CompressedMazeFile::load(const std::string& path, WallBits& walls) {
+    int rows, cols, blockRows;
+    std::vector<uint64_t> offsets;
+    FILE *in = openAndCheck(path, rows, cols, blockRows, offsets);
+    if (!in) return false;
+    WallBits decoded(rows, cols);
+    bool ok = decodeBlocks(in, rows, cols, blockRows, offsets, 0, (int) offsets.size() - 1,
+            0, decoded);
+    fclose(in);
+    if (!ok) return false;
+    walls = std::move(decoded);
+    error.clear();
+    return true;
+}
+
+bool CompressedMazeFile::loadRows(const std::string& path, int first, int count, WallBits& walls) {
+    int rows, cols, blockRows;
+    std::vector<uint64_t> offsets;
+    FILE *in = openAndCheck(path, rows, cols, blockRows, offsets);
+    if (!in) return false;
+    if (first < 0 || count < 1 || first > rows - count) {
+        error = "the rows aren't in the maze";
+        fclose(in);
+        return false;
+    }
+    WallBits decoded(count, cols);
+    bool ok = decodeBlocks(in, rows, cols, blockRows, offsets, first / blockRows,
+            (first + count - 1) / blockRows + 1, first, decoded);
+    fclose(in);
+    if (!ok) return false;
+    walls = std::move(decoded);
+    error.clear();
+    return true;
+}
+
+#endif /* COMPRESSEDMAZEFILE_CPP_ */
@@ -0,0 +1,157 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file CompressedMazeFile.h
+ * @brief Contains the declaration of the CompressedMazeFile class.
+ */
+
+#ifndef COMPRESSEDMAZEFILE_H_
+#define COMPRESSEDMAZEFILE_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "WallBits.h"
+
+/**
+ * @brief Reads and writes mazes in the compressed .mzz format.
+ *
+ * The maze is cut into blocks of whole rows, of at least BLOCKNODES nodes
+ * each, and each block is compressed on its own with WallCoder. Blocks are
+ * compressed and decompressed on one thread per core, and since each can
+ * be decoded without the others, loadRows() reads and decodes only the
+ * blocks holding the rows asked for.
+ *
+ * The file is a 128-byte header, laid out like that of a .maze file (see
+ * MazeFile) but starting with the magic "MAZECUTZ" and holding the rows per
+ * block and the number of blocks in place of the words per row; then the
+ * 64-bit offsets in the file of each block, and of the end of the last one;
+ * then the blocks. Numbers are in the byte order of the machine that wrote
+ * the file.
+ */
+class CompressedMazeFile {
+
+public:
+    /**
+     * @brief The version of the format written by save()
+     */
+    static const uint32_t VERSION = 1;
+
+    /**
+     * @brief Fewest nodes in a block (unless the maze is smaller)
+     */
+    static const int BLOCKNODES = 1 << 16;
+
+    /**
+     * @brief Tell whether a file name is that of a compressed maze
+     *
+     * @param path name of the file
+     * @return true if it ends in .mzz, in any case
+     */
+    static bool isCompressed(const std::string& path);
+
+    CompressedMazeFile();
+
+    /**
+     * @brief Write a maze to a file
+     *
+     * The algorithm, seed and perfect fields are written as the maze's
+     * metadata.
+     *
+     * @param path name of the file
+     * @param walls the maze
+     * @return true if success; otherwise error says why
+     */
+    bool save(const std::string& path, const WallBits& walls);
+
+    /**
+     * @brief Read a maze from a file
+     *
+     * Fills in the algorithm, seed and perfect fields from the file.
+     *
+     * @param path name of the file
+     * @param walls set to the maze
+     * @return true if success; otherwise error says why
+     */
+    bool load(const std::string& path, WallBits& walls);
+
+    /**
+     * @brief Read some rows of a maze from a file, decoding only the blocks
+     * that hold them
+     *
+     * The rows come back as a maze of their own, so the down walls of the
+     * last of them are up whatever they are in the whole maze.
+     *
+     * @param path name of the file
+     * @param first first row to read
+     * @param count number of rows to read
+     * @param walls set to the rows
+     * @return true if success; otherwise error says why
+     */
+    bool loadRows(const std::string& path, int first, int count, WallBits& walls);
+
+    /**
+     * @brief Name of the algorithm that generated the maze
+     */
+    std::string algorithm;
+
+    /**
+     * @brief Seed the maze was generated with
+     */
+    uint64_t seed;
+
+    /**
+     * @brief Whether the maze is perfect (has no loops)
+     */
+    bool perfect;
+
+    /**
+     * @brief Size of the file written by the last save(), in bytes
+     */
+    uint64_t bytes;
+
+    /**
+     * @brief Why the last save(), load() or loadRows() failed
+     */
+    std::string error;
+
+private:
+
+    /**
+     * @brief Open a file, check its header and read its block offsets
+     *
+     * @return the open file, or NULL with error set
+     */
+    FILE *openAndCheck(const std::string& path, int& rows, int& cols, int& blockRows,
+            std::vector<uint64_t>& offsets);
+
+    /**
+     * @brief Decode blocks first..last-1 of an open file into walls, whose
+     * row 0 is row top of the maze
+     *
+     * @return true if success; otherwise error says why
+     */
+    bool decodeBlocks(FILE *in, int rows, int cols, int blockRows,
+            const std::vector<uint64_t>& offsets, int first, int last, int top,
+            WallBits& walls);
+};
+
+#endif /* COMPRESSEDMAZEFILE_H_ */
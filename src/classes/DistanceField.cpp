@@ -0,0 +1,300 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file DistanceField.cpp
+ * @brief Contains the methods of the DistanceField class.
+ */
+
+#ifndef DISTANCEFIELD_CPP_
+#define DISTANCEFIELD_CPP_
+
+#include <algorithm>
+#include <mutex>
+#include "DistanceField.h"
+#include "MazeSolver.h"
+#include "ParallelBands.h"
+
+const uint32_t DistanceField::UNREACHABLE;
+
+/*
+ * A level goes bottom-up when the frontier has more than one node for every
+ * BOTTOMUPWORDS words of the rows it spans. Checking a word bottom-up costs
+ * about a sixteenth of expanding a node top-down.
+ */
+static const long BOTTOMUPWORDS = 16;
+
+/*
+ * Levels with less work than this (frontier nodes top-down, row words
+ * bottom-up) stay on the calling thread, since starting threads costs more
+ * than they would save.
+ */
+static const long PARALLELNODES = 1 << 14;
+static const long PARALLELWORDS = 1 << 15;
+
+/*
+ * Mask of the open sides of a node, bit dir set for each direction without
+ * a wall
+ */
+static inline int openSides(const WallBits& walls, int r, int c) {
+    int w = c / 64, b = c % 64;
+    int open = 0;
+    if (!((walls.rightRow(r)[w] >> b) & 1)) open |= 1 << RIGHT;
+    if (r > 0 && !((walls.downRow(r-1)[w] >> b) & 1)) open |= 1 << UP;
+    if (c > 0 && !((walls.rightRow(r)[(c-1) / 64] >> ((c-1) % 64)) & 1)) open |= 1 << LEFT;
+    if (!((walls.downRow(r)[w] >> b) & 1)) open |= 1 << DOWN;
+    return open;
+}
+
+DistanceField::DistanceField() {
+    frontierSize = 0;
+    firstRow = 0;
+    lastRow = -1;
+    numReached = 0;
+    numTopDown = 0;
+    numBottomUp = 0;
+}
+
+uint32_t DistanceField::compute(const WallBits& walls, int start_r,
+        int start_c, uint32_t *distances) {
+    int rows = walls.numRows(), cols = walls.numCols();
+    int words = walls.wordsPerRow();
+
+    // Padding bits start out visited so they never join the frontier
+    visited.resize((size_t)rows * words);
+    forEachRowBand(rows, [&](int first, int last) {
+        for (int r=first; r < last; r++) {
+            for (int w=0; w < words; w++) {
+                visited[(size_t)r * words + w] = ~walls.validMask(w);
+            }
+            std::fill(distances + (size_t)r * cols, distances + (size_t)(r+1) * cols, UNREACHABLE);
+        }
+    });
+
+    long start = (long) start_r * cols + start_c;
+    distances[start] = 0;
+    visited[(size_t)start_r * words + start_c / 64] |= (uint64_t)1 << (start_c % 64);
+    frontier.assign(1, start);
+    frontierSize = 1;
+    firstRow = lastRow = start_r;
+    numReached = 1;
+    numTopDown = 0;
+    numBottomUp = 0;
+
+    bool bitmap = false;
+    uint32_t level = 0;
+    while (true) {
+        long spanWords = (long) (lastRow - firstRow + 3) * words;
+        bool wantBitmap = frontierSize * BOTTOMUPWORDS > spanWords;
+
+        if (wantBitmap && !bitmap) {
+            // Move the frontier list into the bitmap
+            if (frontierBits.size() != visited.size()) {
+                frontierBits.assign(visited.size(), 0);
+                nextBits.assign(visited.size(), 0);
+            }
+            for (size_t k=0; k < frontier.size(); k++) {
+                long i = frontier[k];
+                int r = (int) (i / cols), c = (int) (i % cols);
+                frontierBits[(size_t)r * words + c / 64] |= (uint64_t)1 << (c % 64);
+            }
+            bitmap = true;
+        } else if (!wantBitmap && bitmap) {
+            // Move the frontier bitmap into the list, clearing it as we go
+            frontier.clear();
+            for (int r = firstRow; r <= lastRow; r++) {
+                for (int w=0; w < words; w++) {
+                    uint64_t& bits = frontierBits[(size_t)r * words + w];
+                    while (bits) {
+                        frontier.push_back((long) r * cols + w * 64 + __builtin_ctzll(bits));
+                        bits &= bits - 1;
+                    }
+                }
+            }
+            bitmap = false;
+        }
+
+        ++level;
+        if (bitmap) {
+            bottomUp(walls, level, distances);
+            ++numBottomUp;
+        } else {
+            topDown(walls, level, distances);
+            ++numTopDown;
+        }
+
+        if (frontierSize == 0) break;
+        numReached += frontierSize;
+    }
+
+    // An empty last level leaves the bitmap clear for next time
+    return level - 1;
+}
+
+void DistanceField::topDown(const WallBits& walls, uint32_t level,
+        uint32_t *distances) {
+    int rows = walls.numRows(), cols = walls.numCols();
+    int words = walls.wordsPerRow();
+    long count = (long) frontier.size();
+    int newFirst = rows, newLast = -1;
+
+    if (count < PARALLELNODES) {
+        nextFrontier.clear();
+        for (long k=0; k < count; k++) {
+            long i = frontier[k];
+            int open = openSides(walls, (int) (i / cols), (int) (i % cols));
+            for (int dir=RIGHT; dir <= DOWN; dir++) {
+                if (!((open >> dir) & 1)) continue;
+                long next = stepIndex(i, dir, cols);
+                int next_r = (int) (next / cols), next_c = (int) (next % cols);
+                uint64_t& word = visited[(size_t)next_r * words + next_c / 64];
+                uint64_t bit = (uint64_t)1 << (next_c % 64);
+                if (word & bit) continue;
+                word |= bit;
+                distances[next] = level;
+                nextFrontier.push_back(next);
+                newFirst = std::min(newFirst, next_r);
+                newLast = std::max(newLast, next_r);
+            }
+        }
+    } else {
+        // Each thread claims nodes with an atomic OR and keeps its own list
+        int threads = numWorkerThreads();
+        std::vector<std::vector<long> > found(threads);
+        std::vector<int> firsts(threads, rows), lasts(threads, -1);
+        forEachChunk(count, 4096, [&](int thread, long first, long last) {
+            std::vector<long>& out = found[thread];
+            for (long k=first; k < last; k++) {
+                long i = frontier[k];
+                int open = openSides(walls, (int) (i / cols), (int) (i % cols));
+                for (int dir=RIGHT; dir <= DOWN; dir++) {
+                    if (!((open >> dir) & 1)) continue;
+                    long next = stepIndex(i, dir, cols);
+                    int next_r = (int) (next / cols), next_c = (int) (next % cols);
+                    uint64_t *word = &visited[(size_t)next_r * words + next_c / 64];
+                    uint64_t bit = (uint64_t)1 << (next_c % 64);
+                    if (*word & bit) continue;
+                    if (__atomic_fetch_or(word, bit, __ATOMIC_RELAXED) & bit) continue;
+                    distances[next] = level;
+                    out.push_back(next);
+                    firsts[thread] = std::min(firsts[thread], next_r);
+                    lasts[thread] = std::max(lasts[thread], next_r);
+                }
+            }
+        });
+
+        nextFrontier.clear();
+        for (int t=0; t < threads; t++) {
+            nextFrontier.insert(nextFrontier.end(), found[t].begin(), found[t].end());
+            newFirst = std::min(newFirst, firsts[t]);
+            newLast = std::max(newLast, lasts[t]);
+        }
+    }
+
+    frontier.swap(nextFrontier);
+    frontierSize = (long) frontier.size();
+    firstRow = newFirst;
+    lastRow = newLast;
+}
+
+void DistanceField::bottomUp(const WallBits& walls, uint32_t level,
+        uint32_t *distances) {
+    int rows = walls.numRows(), cols = walls.numCols();
+    int words = walls.wordsPerRow();
+    int first = std::max(0, firstRow - 1);
+    int last = std::min(rows - 1, lastRow + 1);
+
+    std::mutex lock;
+    long total = 0;
+    int newFirst = rows, newLast = -1;
+
+    std::function<void(int, int)> band = [&](int bandFirst, int bandLast) {
+        long count = 0;
+        int bandNewFirst = rows, bandNewLast = -1;
+
+        for (int r = first + bandFirst; r < first + bandLast; r++) {
+            const uint64_t *rightWalls = walls.rightRow(r);
+            const uint64_t *downWalls = walls.downRow(r);
+            const uint64_t *upWalls = r > 0 ? walls.downRow(r-1) : NULL;
+            const uint64_t *here = &frontierBits[(size_t)r * words];
+            const uint64_t *above = r > 0 ? &frontierBits[(size_t)(r-1) * words] : NULL;
+            const uint64_t *below = r < rows-1 ? &frontierBits[(size_t)(r+1) * words] : NULL;
+            uint64_t *seen = &visited[(size_t)r * words];
+            uint64_t *out = &nextBits[(size_t)r * words];
+            bool any = false;
+
+            for (int w=0; w < words; w++) {
+                // Frontier nodes that can step right, and the ones to the
+                // right of each node that it can step left from
+                uint64_t goesRight = here[w] & ~rightWalls[w];
+                uint64_t fromLeft = (goesRight << 1) |
+                        (w > 0 ? (here[w-1] & ~rightWalls[w-1]) >> 63 : 0);
+                uint64_t fromRight = ((here[w] >> 1) | (w < words-1 ? here[w+1] << 63 : 0)) &
+                        ~rightWalls[w];
+                uint64_t fromAbove = above ? above[w] & ~upWalls[w] : 0;
+                uint64_t fromBelow = below ? below[w] & ~downWalls[w] : 0;
+
+                uint64_t fresh = (fromLeft | fromRight | fromAbove | fromBelow) & ~seen[w];
+                out[w] = fresh;
+                if (!fresh) continue;
+
+                seen[w] |= fresh;
+                count += __builtin_popcountll(fresh);
+                any = true;
+                uint32_t *rowDistances = distances + (size_t)r * cols + w * 64;
+                while (fresh) {
+                    rowDistances[__builtin_ctzll(fresh)] = level;
+                    fresh &= fresh - 1;
+                }
+            }
+
+            if (any) {
+                bandNewFirst = std::min(bandNewFirst, r);
+                bandNewLast = std::max(bandNewLast, r);
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        total += count;
+        newFirst = std::min(newFirst, bandNewFirst);
+        newLast = std::max(newLast, bandNewLast);
+    };
+
+    int span = last - first + 1;
+    if ((long) span * words < PARALLELWORDS) band(0, span);
+    else forEachRowBand(span, band, 16);
+
+    // The old frontier is done with; clear it so the buffers can swap
+    for (int r = firstRow; r <= lastRow; r++) {
+        std::fill(frontierBits.begin() + (size_t)r * words,
+                frontierBits.begin() + (size_t)(r+1) * words, 0);
+    }
+    frontierBits.swap(nextBits);
+
+    frontierSize = total;
+    firstRow = newFirst;
+    lastRow = newLast;
+    if (total == 0) {
+        // Rows first..last of the new frontier were written with zeros
+        firstRow = 0;
+        lastRow = -1;
+    }
+}
+
+#endif /* DISTANCEFIELD_CPP_ */
@@ -0,0 +1,181 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file DistanceField.h
+ * @brief Contains the declaration of the DistanceField class.
+ */
+
+#ifndef DISTANCEFIELD_H_
+#define DISTANCEFIELD_H_
+
+#include <vector>
+#include <stdint.h>
+#include "constants.h"
+#include "WallBits.h"
+
+/**
+ * @brief Computes the distance from one node to every node of a maze with a
+ * level-by-level breadth-first search.
+ *
+ * Each level is expanded one of two ways, picked by how crowded the
+ * frontier is:
+ *
+ * - top-down: every node in the frontier (kept as a list) claims its
+ *   unvisited neighbors. With a big frontier the list is split between
+ *   threads, which claim nodes with an atomic OR on the visited bitmap.
+ *
+ * - bottom-up: the frontier is kept as a bitmap in the layout of WallBits,
+ *   and every row between the frontier's first and last row (plus one on
+ *   each side) works out which of its unvisited nodes have a frontier
+ *   neighbor through an open wall, 64 nodes at a time. Each row is written
+ *   only by the thread that owns it, so no atomics are needed.
+ *
+ * Mazes have long, thin frontiers, so most levels are small and run
+ * top-down on the calling thread; the threads and the bitmap only come out
+ * when a level has enough work to pay for them (open areas and braided
+ * mazes).
+ *
+ * The workspace (visited bitmap, frontier lists and bitmaps) is kept from
+ * one call to the next.
+ */
+class DistanceField {
+
+public:
+    /**
+     * @brief Distance written for nodes that can't be reached
+     */
+    static const uint32_t UNREACHABLE = 0xffffffffu;
+
+    DistanceField();
+
+    /**
+     * @brief Compute the distance from a node to every node
+     *
+     * @param walls the maze
+     * @param start_r row of the node to measure from
+     * @param start_c column of the node to measure from
+     * @param distances rows*columns values to write the distances into, in
+     * row-major order (UNREACHABLE for nodes that can't be reached)
+     * @return the largest distance
+     */
+    uint32_t compute(const WallBits& walls, int start_r, int start_c,
+            uint32_t *distances);
+
+    /**
+     * @brief get the number of nodes the last call reached
+     *
+     * @return nodes reached, the start included
+     */
+    long reached() const { return numReached; }
+
+    /**
+     * @brief get the number of levels the last call expanded top-down
+     *
+     * @return top-down levels
+     */
+    long topDownLevels() const { return numTopDown; }
+
+    /**
+     * @brief get the number of levels the last call expanded bottom-up
+     *
+     * @return bottom-up levels
+     */
+    long bottomUpLevels() const { return numBottomUp; }
+
+private:
+
+    /**
+     * @brief Expand the frontier list by one level
+     *
+     * @param walls the maze
+     * @param level distance of the new frontier
+     * @param distances the distances being written
+     */
+    void topDown(const WallBits& walls, uint32_t level, uint32_t *distances);
+
+    /**
+     * @brief Expand the frontier bitmap by one level
+     *
+     * @param walls the maze
+     * @param level distance of the new frontier
+     * @param distances the distances being written
+     */
+    void bottomUp(const WallBits& walls, uint32_t level, uint32_t *distances);
+
+    /**
+     * @brief Visited bitmap, one bit per node in the layout of WallBits
+     * (padding bits are set)
+     */
+    std::vector<uint64_t> visited;
+
+    /**
+     * @brief Frontier as a list of node indices, in top-down mode
+     */
+    std::vector<long> frontier;
+
+    /**
+     * @brief Next frontier as a list of node indices, in top-down mode
+     */
+    std::vector<long> nextFrontier;
+
+    /**
+     * @brief Frontier as a bitmap, in bottom-up mode; rows outside
+     * firstRow..lastRow are always clear
+     */
+    std::vector<uint64_t> frontierBits;
+
+    /**
+     * @brief Next frontier as a bitmap, in bottom-up mode (always clear
+     * between levels)
+     */
+    std::vector<uint64_t> nextBits;
+
+    /**
+     * @brief Number of nodes in the frontier
+     */
+    long frontierSize;
+
+    /**
+     * @brief First row with a node in the frontier
+     */
+    int firstRow;
+
+    /**
+     * @brief Last row with a node in the frontier
+     */
+    int lastRow;
+
+    /**
+     * @brief Nodes reached by the last call
+     */
+    long numReached;
+
+    /**
+     * @brief Levels the last call expanded top-down
+     */
+    long numTopDown;
+
+    /**
+     * @brief Levels the last call expanded bottom-up
+     */
+    long numBottomUp;
+};
+
+#endif /* DISTANCEFIELD_H_ */
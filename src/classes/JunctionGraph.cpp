@@ -0,0 +1,143 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file JunctionGraph.cpp
+ * @brief Contains the methods of the JunctionGraph class.
+ */
+
+#ifndef JUNCTIONGRAPH_CPP_
+#define JUNCTIONGRAPH_CPP_
+
+#include <algorithm>
+#include "JunctionGraph.h"
+#include "MazeSolver.h"
+#include "ParallelBands.h"
+
+JunctionGraph::JunctionGraph() {
+    walls = NULL;
+    maxWeight = 0;
+    words = 0;
+}
+
+void JunctionGraph::build(const WallBits& w) {
+    walls = &w;
+    words = walls->wordsPerRow();
+    int rows = walls->numRows();
+    int cols = walls->numCols();
+
+    // Every node that isn't a corridor node is a vertex
+    vertexBits.assign((size_t)rows * words, 0);
+    forEachRowBand(rows, [&](int first, int last) {
+        for (int r=first; r < last; r++) {
+            uint64_t *bits = &vertexBits[(size_t)r * words];
+            walls->corridors(r, bits);
+            for (int i=0; i < words; i++) {
+                bits[i] = ~bits[i] & walls->validMask(i);
+            }
+        }
+    });
+
+    ranks.resize(vertexBits.size());
+    long count = 0;
+    for (size_t i=0; i < vertexBits.size(); i++) {
+        ranks[i] = count;
+        count += __builtin_popcountll(vertexBits[i]);
+    }
+
+    // Number the vertices and count their edges (their openings)
+    vertexNodes.resize(count);
+    offsets.assign(count + 1, 0);
+    forEachRowBand(rows, [&](int first, int last) {
+        for (int r=first; r < last; r++) {
+            for (int i=0; i < words; i++) {
+                uint64_t bits = vertexBits[(size_t)r * words + i];
+                long v = ranks[(size_t)r * words + i];
+                while (bits) {
+                    int c = i * 64 + __builtin_ctzll(bits);
+                    bits &= bits - 1;
+
+                    vertexNodes[v] = (long) r * cols + c;
+                    int degree = 0;
+                    for (int dir=RIGHT; dir <= DOWN; dir++) {
+                        if (!walls->wall(r, c, dir)) degree++;
+                    }
+                    offsets[++v] = degree;
+                }
+            }
+        }
+    });
+    for (long v=0; v < count; v++) offsets[v+1] += offsets[v];
+
+    // Walk every corridor out of every vertex
+    long edges = offsets[count];
+    targets.resize(edges);
+    weights.resize(edges);
+    directions.resize(edges);
+    forEachRowBand(rows, [&](int first, int last) {
+        long v = ranks[(size_t)first * words];
+        long end = last < rows ? ranks[(size_t)last * words] : count;
+        for (; v < end; v++) {
+            long e = offsets[v];
+            int r = (int) (vertexNodes[v] / cols), c = (int) (vertexNodes[v] % cols);
+            for (int dir=RIGHT; dir <= DOWN; dir++) {
+                if (walls->wall(r, c, dir)) continue;
+                int length;
+                long to = walk(vertexNodes[v], dir, -1, NULL, length);
+                targets[e] = vertex((int) (to / cols), (int) (to % cols));
+                weights[e] = length;
+                directions[e] = (uint8_t) dir;
+                e++;
+            }
+        }
+    });
+
+    maxWeight = 0;
+    for (long e=0; e < edges; e++) maxWeight = std::max(maxWeight, weights[e]);
+}
+
+long JunctionGraph::source(long e) const {
+    return std::upper_bound(offsets.begin(), offsets.end(), e) - offsets.begin() - 1;
+}
+
+long JunctionGraph::walk(long node, int dir, long stop,
+        std::vector<unsigned char> *path, int& length) const {
+    int cols = walls->numCols();
+    long start = node;
+    length = 0;
+
+    while (true) {
+        node = stepIndex(node, dir, cols);
+        length++;
+        if (path) path->push_back((unsigned char) dir);
+
+        int r = (int) (node / cols), c = (int) (node % cols);
+        if (node == stop || node == start || isVertex(r, c)) return node;
+
+        int back = flip(dir);
+        for (int next=RIGHT; next <= DOWN; next++) {
+            if (next != back && !walls->wall(r, c, next)) {
+                dir = next;
+                break;
+            }
+        }
+    }
+}
+
+#endif /* JUNCTIONGRAPH_CPP_ */
@@ -0,0 +1,237 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file JunctionGraph.h
+ * @brief Contains the declaration of the JunctionGraph class.
+ */
+
+#ifndef JUNCTIONGRAPH_H_
+#define JUNCTIONGRAPH_H_
+
+#include <vector>
+#include <stdint.h>
+#include "constants.h"
+#include "WallBits.h"
+
+/**
+ * @brief A maze with its corridors contracted into weighted edges.
+ *
+ * Most nodes of a maze are corridor nodes, with exactly two openings. The
+ * junction graph keeps only the other nodes (dead ends and junctions, called
+ * vertices here) and turns each corridor between two of them into one edge
+ * weighted by its number of steps. The edges are stored in compressed sparse
+ * row form: the edges out of vertex v are firstEdge(v) up to
+ * firstEdge(v+1), in the order RIGHT, UP, LEFT, DOWN of the direction they
+ * leave v in.
+ *
+ * Vertices are numbered in row-major order of their nodes, and a rank
+ * count per word of the vertex bitmap turns a node into its vertex number
+ * without a table over every node.
+ *
+ * The graph keeps a pointer to the maze to turn edges back into steps, so
+ * the maze must outlive it and not change while it is in use. Rings made
+ * only of corridor nodes have no vertices and are left out of the graph.
+ */
+class JunctionGraph {
+
+public:
+    JunctionGraph();
+
+    /**
+     * @brief Build the graph for a maze
+     *
+     * @param walls the maze
+     */
+    void build(const WallBits& walls);
+
+    /**
+     * @brief get the maze the graph was built from
+     *
+     * @return the maze
+     */
+    const WallBits& getWalls() const { return *walls; }
+
+    /**
+     * @brief get the number of vertices
+     *
+     * @return number of vertices
+     */
+    long numVertices() const { return (long) vertexNodes.size(); }
+
+    /**
+     * @brief get the number of edges (each corridor counts once from each
+     * end)
+     *
+     * @return number of edges
+     */
+    long numEdges() const { return (long) targets.size(); }
+
+    /**
+     * @brief get the length of the longest edge
+     *
+     * @return number of steps along the longest corridor
+     */
+    int longestEdge() const { return maxWeight; }
+
+    /**
+     * @brief Tell whether a node is a vertex of the graph
+     *
+     * @param r row of the node
+     * @param c column of the node
+     * @return true if the node isn't a corridor node
+     */
+    bool isVertex(int r, int c) const {
+        return (vertexBits[(size_t)r * words + c / 64] >> (c % 64)) & 1;
+    }
+
+    /**
+     * @brief Get the vertex number of a node that is a vertex
+     *
+     * @param r row of the node
+     * @param c column of the node
+     * @return the vertex number
+     */
+    long vertex(int r, int c) const {
+        size_t w = (size_t)r * words + c / 64;
+        uint64_t below = ((uint64_t)1 << (c % 64)) - 1;
+        return ranks[w] + __builtin_popcountll(vertexBits[w] & below);
+    }
+
+    /**
+     * @brief Get the node of a vertex
+     *
+     * @param v vertex number
+     * @return index of the node (row * columns + column)
+     */
+    long node(long v) const { return vertexNodes[v]; }
+
+    /**
+     * @brief Get the first edge out of a vertex
+     *
+     * @param v vertex number (numVertices() gives the end of the last one)
+     * @return edge number
+     */
+    long firstEdge(long v) const { return offsets[v]; }
+
+    /**
+     * @brief Get the vertex an edge goes to
+     *
+     * @param e edge number
+     * @return vertex number
+     */
+    long target(long e) const { return targets[e]; }
+
+    /**
+     * @brief Get the number of steps along an edge
+     *
+     * @param e edge number
+     * @return length of the corridor
+     */
+    int weight(long e) const { return weights[e]; }
+
+    /**
+     * @brief Get the direction an edge leaves its vertex in
+     *
+     * @param e edge number
+     * @return RIGHT, UP, LEFT or DOWN
+     */
+    int direction(long e) const { return directions[e]; }
+
+    /**
+     * @brief Find the vertex an edge comes from
+     *
+     * @param e edge number
+     * @return vertex number
+     */
+    long source(long e) const;
+
+    /**
+     * @brief Follow a corridor until it reaches a vertex
+     *
+     * The walk takes one step from the node in the given direction, then
+     * keeps going through corridor nodes. It stops early if it reaches the
+     * stop node, or comes back around to the node it started from.
+     *
+     * @param node index of the node to start from
+     * @param dir direction of the first step (there must be no wall)
+     * @param stop index of a node to stop at, or -1
+     * @param path if not NULL, the steps taken are appended to it
+     * @param length set to the number of steps taken
+     * @return index of the node the walk stopped on
+     */
+    long walk(long node, int dir, long stop, std::vector<unsigned char> *path,
+            int& length) const;
+
+private:
+
+    /**
+     * @brief The maze
+     */
+    const WallBits *walls;
+
+    /**
+     * @brief Length of the longest edge
+     */
+    int maxWeight;
+
+    /**
+     * @brief Number of 64-bit words per row of vertexBits
+     */
+    int words;
+
+    /**
+     * @brief One bit per node, set for vertices, in the layout of the rows of
+     * walls
+     */
+    std::vector<uint64_t> vertexBits;
+
+    /**
+     * @brief Number of vertices before each word of vertexBits
+     */
+    std::vector<long> ranks;
+
+    /**
+     * @brief Node of each vertex
+     */
+    std::vector<long> vertexNodes;
+
+    /**
+     * @brief Index of the first edge of each vertex, plus one past the last
+     * edge at the end
+     */
+    std::vector<long> offsets;
+
+    /**
+     * @brief Target vertex of each edge
+     */
+    std::vector<long> targets;
+
+    /**
+     * @brief Length of each edge
+     */
+    std::vector<int> weights;
+
+    /**
+     * @brief Direction each edge leaves its source in
+     */
+    std::vector<uint8_t> directions;
+};
+
+#endif /* JUNCTIONGRAPH_H_ */
@@ -0,0 +1,138 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file LifeGrid.cpp
+ * @brief Contains the methods of the LifeGrid class.
+ */
+
+#ifndef LIFEGRID_CPP_
+#define LIFEGRID_CPP_
+
+#include <cstdlib>
+#include "LifeGrid.h"
+
+LifeGrid::LifeGrid(int r, int c) {
+    rows = r;
+    cols = c;
+    words = (cols + 63) / 64;
+    lastWordMask = (cols % 64 == 0) ? ~(uint64_t)0 : (((uint64_t)1 << (cols % 64)) - 1);
+
+    cells.assign((size_t)rows * words, 0);
+    next.assign((size_t)rows * words, 0);
+}
+
+bool LifeGrid::get(int r, int c) const {
+    return (cells[(size_t)r * words + c / 64] >> (c % 64)) & 1;
+}
+
+void LifeGrid::set(int r, int c, bool alive) {
+    uint64_t bit = (uint64_t)1 << (c % 64);
+    if (alive) cells[(size_t)r * words + c / 64] |= bit;
+    else cells[(size_t)r * words + c / 64] &= ~bit;
+}
+
+void LifeGrid::randomize(int oneIn, uint64_t seed) {
+    // splitmix64
+    for (int r=0; r < rows; r++) {
+        for (int c=0; c < cols; c++) {
+            uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            set(r, c, ((z ^ (z >> 31)) >> 33) % oneIn == 0);
+        }
+    }
+}
+
+/*
+ * Add a one-bit-per-cell word x into the bit-sliced counter (b0..b3).
+ */
+static inline void addToCounter(uint64_t x, uint64_t& b0, uint64_t& b1,
+        uint64_t& b2, uint64_t& b3) {
+    uint64_t carry = b0 & x;
+    b0 ^= x;
+    x = carry;
+    carry = b1 & x;
+    b1 ^= x;
+    x = carry;
+    carry = b2 & x;
+    b2 ^= x;
+    b3 |= carry; // at most 8 neighbors, so the counter never overflows
+}
+
+/*
+ * Every cell of the counter equal to k
+ */
+static inline uint64_t counterEquals(int k, uint64_t b0, uint64_t b1,
+        uint64_t b2, uint64_t b3) {
+    return ((k & 1) ? b0 : ~b0) & ((k & 2) ? b1 : ~b1) &
+           ((k & 4) ? b2 : ~b2) & ((k & 8) ? b3 : ~b3);
+}
+
+bool LifeGrid::step(int birth, int survive) {
+    static const uint64_t zero = 0;
+    bool changed = false;
+
+    for (int r=0; r < rows; r++) {
+        const uint64_t *above = r > 0 ? &cells[(size_t)(r-1) * words] : NULL;
+        const uint64_t *here = &cells[(size_t)r * words];
+        const uint64_t *below = r < rows-1 ? &cells[(size_t)(r+1) * words] : NULL;
+        uint64_t *out = &next[(size_t)r * words];
+
+        for (int w=0; w < words; w++) {
+            uint64_t b0 = 0, b1 = 0, b2 = 0, b3 = 0;
+            const uint64_t *neighborRows[3] = { above, here, below };
+
+            for (int i=0; i < 3; i++) {
+                const uint64_t *row = neighborRows[i];
+                if (row == NULL) continue;
+                uint64_t mid = row[w];
+                uint64_t prev = w > 0 ? row[w-1] : zero;
+                uint64_t succ = w < words-1 ? row[w+1] : zero;
+
+                // bit k of west is the cell at column k-1, east at k+1
+                uint64_t west = (mid << 1) | (prev >> 63);
+                uint64_t east = (mid >> 1) | (succ << 63);
+
+                addToCounter(west, b0, b1, b2, b3);
+                addToCounter(east, b0, b1, b2, b3);
+                if (row != here) addToCounter(mid, b0, b1, b2, b3);
+            }
+
+            uint64_t born = 0, survives = 0;
+            for (int k=0; k <= 8; k++) {
+                uint64_t eq = counterEquals(k, b0, b1, b2, b3);
+                if (birth & (1 << k)) born |= eq;
+                if (survive & (1 << k)) survives |= eq;
+            }
+
+            uint64_t cur = here[w];
+            uint64_t result = (cur & survives) | (~cur & born);
+            if (w == words-1) result &= lastWordMask;
+
+            changed = changed || result != cur;
+            out[w] = result;
+        }
+    }
+
+    cells.swap(next);
+    return changed;
+}
+
+#endif /* LIFEGRID_CPP_ */
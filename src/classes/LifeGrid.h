@@ -0,0 +1,138 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file LifeGrid.h
+ * @brief Contains the declaration of the LifeGrid class.
+ */
+
+#ifndef LIFEGRID_H_
+#define LIFEGRID_H_
+
+#include <vector>
+#include <stdint.h>
+
+/**
+ * @brief A bit-packed grid for life-like cellular automata.
+ *
+ * Each row is stored as an array of 64-bit words, one bit per cell. A
+ * generation is computed with bit-sliced neighbor counting: the eight
+ * neighbor words are added together as a 4-bit counter spread over four
+ * words, so every bit position (cell) in a word is updated at once. Cells
+ * outside the grid are always dead.
+ */
+class LifeGrid {
+
+public:
+    /**
+     * @brief Create an empty (all dead) grid with r rows and c columns.
+     *
+     * @param r number of rows
+     * @param c number of columns
+     */
+    LifeGrid(int r, int c);
+
+    /**
+     * @brief get the number of rows in the grid
+     *
+     * @return number of rows
+     */
+    int numRows() const { return rows; }
+
+    /**
+     * @brief get the number of columns in the grid
+     *
+     * @return number of columns
+     */
+    int numCols() const { return cols; }
+
+    /**
+     * @brief Tell whether a cell is alive
+     *
+     * @param r row of the cell
+     * @param c column of the cell
+     * @return true if the cell is alive
+     */
+    bool get(int r, int c) const;
+
+    /**
+     * @brief Set a cell to be alive or dead
+     *
+     * @param r row of the cell
+     * @param c column of the cell
+     * @param alive the new state of the cell
+     */
+    void set(int r, int c, bool alive);
+
+    /**
+     * @brief Make every cell alive with probability 1/oneIn
+     *
+     * @param oneIn inverse of the probability that a cell is alive
+     * @param seed seed of the random stream the cells are drawn from
+     */
+    void randomize(int oneIn, uint64_t seed);
+
+    /**
+     * @brief Advance the grid by one generation.
+     *
+     * The rule is given as two masks of neighbor counts: bit k of
+     * <code>birth</code> means a dead cell with k live neighbors is born, and
+     * bit k of <code>survive</code> means a live cell with k live neighbors
+     * stays alive. "Maze" (B3/S12345) is step(1<<3, 0x3e).
+     *
+     * @param birth mask of neighbor counts that cause a birth
+     * @param survive mask of neighbor counts that allow survival
+     * @return true if any cell changed
+     */
+    bool step(int birth, int survive);
+
+private:
+
+    /**
+     * @brief Number of rows
+     */
+    int rows;
+
+    /**
+     * @brief Number of columns
+     */
+    int cols;
+
+    /**
+     * @brief Number of 64-bit words per row
+     */
+    int words;
+
+    /**
+     * @brief Mask of the valid bits in the last word of each row
+     */
+    uint64_t lastWordMask;
+
+    /**
+     * @brief The cells, rows*words words in row-major order
+     */
+    std::vector<uint64_t> cells;
+
+    /**
+     * @brief Scratch space for the next generation (same layout as cells)
+     */
+    std::vector<uint64_t> next;
+};
+
+#endif /* LIFEGRID_H_ */
@@ -0,0 +1,408 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file LinkCutForest.cpp
+ * @brief Contains the methods of the LinkCutForest class.
+ */
+
+#ifndef LINKCUTFOREST_CPP_
+#define LINKCUTFOREST_CPP_
+
+#include <algorithm>
+#include "LinkCutForest.h"
+#include "MazeSolver.h"
+
+LinkCutForest::LinkCutForest() {
+    walls = NULL;
+    rows = cols = 0;
+    spareCount = 0;
+}
+
+bool LinkCutForest::build(const WallBits& w) {
+    if ((long) w.numRows() * w.numCols() > MAXNODES) return false;
+    walls = &w;
+    rows = walls->numRows();
+    cols = walls->numCols();
+    int count = rows * cols;
+    long wallCount = 2 * (long) count;
+    int posts = (rows-1) * (cols-1) + 1;
+
+    Node blank;
+    blank.child[0] = blank.child[1] = -1;
+    blank.parent = -1;
+    blank.size = 1;
+    blank.weight = -1;
+    blank.raised = blank.open = -1;
+    blank.flipped = false;
+    nodes.assign(count + wallCount + posts, blank);
+    inTree.assign(wallCount, false);
+    spareCount = 0;
+
+    for (long wall=0; wall < wallCount; wall++) {
+        int x = wallNode(wall);
+        int i = (int) (wall / 2);
+        nodes[x].weight = walls->wall(i / cols, i % cols, wall % 2 ? DOWN : RIGHT) ? 1 : 0;
+        pullUp(x);
+    }
+
+    /*
+     * A breadth-first search over the open walls from each unvisited node
+     * gives a spanning forest of the maze, and raised walls then join its
+     * pieces into one tree, the way Kruskal's algorithm would.
+     */
+    std::vector<int> piece(count, -1);
+    std::vector<int> queue;
+    for (int root=0; root < count; root++) {
+        if (piece[root] >= 0) continue;
+        piece[root] = root;
+        queue.assign(1, root);
+        for (size_t head=0; head < queue.size(); head++) {
+            int i = queue[head];
+            for (int dir=RIGHT; dir <= DOWN; dir++) {
+                long wall = wallOf(i, dir);
+                if (wall < 0 || nodes[wallNode(wall)].weight) continue;
+                int next = (int) stepIndex(i, dir, cols);
+                if (piece[next] >= 0) continue;
+                piece[next] = root;
+                inTree[wall] = true;
+                queue.push_back(next);
+            }
+        }
+    }
+    std::vector<int> leader(count);
+    for (int i=0; i < count; i++) leader[i] = i;
+    for (long wall=0; wall < wallCount; wall++) {
+        int a, b;
+        if (wallOf((int) (wall / 2), wall % 2 ? DOWN : RIGHT) < 0) continue;
+        if (!nodes[wallNode(wall)].weight) {
+            if (!inTree[wall]) spareCount++;
+            continue;
+        }
+        wallEnds(wall, a, b);
+        a = piece[a];
+        b = piece[b];
+        while (leader[a] != a) a = leader[a] = leader[leader[a]];
+        while (leader[b] != b) b = leader[b] = leader[leader[b]];
+        if (a == b) continue;
+        leader[a] = b;
+        inTree[wall] = true;
+    }
+
+    /*
+     * Hanging each node from its parent in a search of the tree, through
+     * the wall between them, as a path of its own, is already a valid set of
+     * link-cut trees. The walls left out are hung from the posts the same
+     * way, starting from the boundary.
+     */
+    std::vector<bool> visited(count, false);
+    visited[0] = true;
+    queue.assign(1, 0);
+    for (size_t head=0; head < queue.size(); head++) {
+        int i = queue[head];
+        for (int dir=RIGHT; dir <= DOWN; dir++) {
+            long wall = wallOf(i, dir);
+            if (wall < 0 || !inTree[wall]) continue;
+            int next = (int) stepIndex(i, dir, cols);
+            if (visited[next]) continue;
+            visited[next] = true;
+            nodes[next].parent = wallNode(wall);
+            nodes[wallNode(wall)].parent = i;
+            queue.push_back(next);
+        }
+    }
+
+    int boundary = postNode(0, 0);
+    std::vector<bool> reached(posts, false);
+    std::vector<long> hanging;
+    reached[boundary - count - wallCount] = true;
+    queue.assign(1, boundary);
+    for (size_t head=0; head < queue.size(); head++) {
+        int p = queue[head];
+        // The posts inside have four walls; the boundary has all the walls
+        // that touch it
+        hanging.clear();
+        if (p == boundary) {
+            for (long wall=0; wall < wallCount; wall++) {
+                if (inTree[wall] || wallOf((int) (wall / 2), wall % 2 ? DOWN : RIGHT) < 0) continue;
+                int x, y;
+                dualEnds(wall, x, y);
+                if (x == boundary || y == boundary) hanging.push_back(wall);
+            }
+        } else {
+            int post = p - count - (int) wallCount;
+            int r = post / (cols-1) + 1, c = post % (cols-1) + 1;
+            hanging.push_back(((long) r * cols + c-1) * 2);
+            hanging.push_back(((long) (r-1) * cols + c-1) * 2);
+            hanging.push_back(((long) (r-1) * cols + c) * 2 + 1);
+            hanging.push_back(((long) (r-1) * cols + c-1) * 2 + 1);
+        }
+        for (size_t k=0; k < hanging.size(); k++) {
+            long wall = hanging[k];
+            if (inTree[wall]) continue;
+            int x, y;
+            dualEnds(wall, x, y);
+            int next = x == p ? y : x;
+            if (reached[next - count - wallCount]) continue;
+            reached[next - count - wallCount] = true;
+            nodes[next].parent = wallNode(wall);
+            nodes[wallNode(wall)].parent = p;
+            queue.push_back(next);
+        }
+    }
+    return true;
+}
+
+void LinkCutForest::pushDown(int x) {
+    Node& n = nodes[x];
+    if (!n.flipped) return;
+    std::swap(n.child[0], n.child[1]);
+    if (n.child[0] >= 0) nodes[n.child[0]].flipped ^= true;
+    if (n.child[1] >= 0) nodes[n.child[1]].flipped ^= true;
+    n.flipped = false;
+}
+
+void LinkCutForest::pullUp(int x) {
+    Node& n = nodes[x];
+    n.size = n.weight < 0;
+    n.raised = n.weight == 1 ? x : -1;
+    n.open = n.weight == 0 ? x : -1;
+    for (int side=0; side < 2; side++) {
+        int y = n.child[side];
+        if (y < 0) continue;
+        n.size += nodes[y].size;
+        if (n.raised < 0) n.raised = nodes[y].raised;
+        if (n.open < 0) n.open = nodes[y].open;
+    }
+}
+
+void LinkCutForest::rotate(int x) {
+    int p = nodes[x].parent, g = nodes[p].parent;
+    int side = nodes[p].child[1] == x;
+    int inner = nodes[x].child[!side];
+
+    if (!isSplayRoot(p)) nodes[g].child[nodes[g].child[1] == p] = x;
+    nodes[x].parent = g;
+    nodes[p].child[side] = inner;
+    if (inner >= 0) nodes[inner].parent = p;
+    nodes[x].child[!side] = p;
+    nodes[p].parent = x;
+
+    pullUp(p);
+    pullUp(x);
+}
+
+void LinkCutForest::splay(int x) {
+    // Flips have to be handed down from the top before anything moves
+    stack.assign(1, x);
+    for (int y = x; !isSplayRoot(y); y = nodes[y].parent) {
+        stack.push_back(nodes[y].parent);
+    }
+    while (!stack.empty()) {
+        pushDown(stack.back());
+        stack.pop_back();
+    }
+
+    while (!isSplayRoot(x)) {
+        int p = nodes[x].parent;
+        if (!isSplayRoot(p)) {
+            int g = nodes[p].parent;
+            bool zigzig = (nodes[g].child[0] == p) == (nodes[p].child[0] == x);
+            rotate(zigzig ? p : x);
+        }
+        rotate(x);
+    }
+}
+
+void LinkCutForest::access(int x) {
+    int last = -1;
+    for (int y = x; y >= 0; y = nodes[y].parent) {
+        splay(y);
+        nodes[y].child[1] = last;
+        pullUp(y);
+        last = y;
+    }
+    splay(x);
+}
+
+void LinkCutForest::makeRoot(int x) {
+    access(x);
+    nodes[x].flipped ^= true;
+}
+
+int LinkCutForest::pathWall(int a, int b, bool raised) {
+    makeRoot(a);
+    access(b);
+    return raised ? nodes[b].raised : nodes[b].open;
+}
+
+void LinkCutForest::setWeight(int x, int weight) {
+    access(x);
+    nodes[x].weight = weight;
+    pullUp(x);
+}
+
+void LinkCutForest::link(int a, int b) {
+    makeRoot(a);
+    nodes[a].parent = b;
+}
+
+void LinkCutForest::cut(int a, int b) {
+    // With a as the root, the path to b is just a then b
+    makeRoot(a);
+    access(b);
+    nodes[b].child[0] = -1;
+    nodes[a].parent = -1;
+    pullUp(b);
+}
+
+void LinkCutForest::exchange(long out, long in) {
+    int a, b, p, q;
+    int x = wallNode(out), y = wallNode(in);
+
+    wallEnds(out, a, b);
+    cut(a, x);
+    cut(x, b);
+    dualEnds(in, p, q);
+    cut(p, y);
+    cut(y, q);
+
+    wallEnds(in, a, b);
+    link(y, b);
+    link(a, y);
+    dualEnds(out, p, q);
+    link(x, q);
+    link(p, x);
+
+    inTree[out] = false;
+    inTree[in] = true;
+}
+
+long LinkCutForest::wallOf(int i, int dir) const {
+    int r = i / cols, c = i % cols;
+    switch (dir) {
+    case RIGHT: return c < cols-1 ? (long) i * 2 : -1;
+    case UP:    return r > 0 ? (long) (i - cols) * 2 + 1 : -1;
+    case LEFT:  return c > 0 ? (long) (i - 1) * 2 : -1;
+    default:    return r < rows-1 ? (long) i * 2 + 1 : -1;
+    }
+}
+
+void LinkCutForest::wallEnds(long wall, int& a, int& b) const {
+    a = (int) (wall / 2);
+    b = wall % 2 ? a + cols : a + 1;
+}
+
+void LinkCutForest::dualEnds(long wall, int& p, int& q) const {
+    int i = (int) (wall / 2);
+    int r = i / cols, c = i % cols;
+    if (wall % 2) {
+        p = postNode(r+1, c);
+        q = postNode(r+1, c+1);
+    } else {
+        p = postNode(r, c+1);
+        q = postNode(r+1, c+1);
+    }
+}
+
+int LinkCutForest::postNode(int r, int c) const {
+    int first = 3 * rows * cols;
+    if (r <= 0 || c <= 0 || r >= rows || c >= cols) return first + (rows-1) * (cols-1);
+    return first + (r-1) * (cols-1) + c-1;
+}
+
+void LinkCutForest::wallChanged(int r, int c, int dir) {
+    if (r < 0 || c < 0 || r >= rows || c >= cols) return;
+    long wall = wallOf(r * cols + c, dir);
+    if (wall < 0) return;
+    int x = wallNode(wall);
+    int weight = walls->wall(r, c, dir) ? 1 : 0;
+    if (nodes[x].weight == weight) return;
+    setWeight(x, weight);
+
+    if (weight) {
+        // A spare can just go; an open wall of the tree trades places with
+        // an open wall that joins the halves again, if there is one
+        if (!inTree[wall]) {
+            spareCount--;
+            return;
+        }
+        int p, q;
+        dualEnds(wall, p, q);
+        int spare = pathWall(p, q, false);
+        if (spare < 0) return;
+        exchange(wall, spare - (long) rows * cols);
+        spareCount--;
+        return;
+    }
+
+    // A raised wall of the tree, or one whose nodes the tree joins through
+    // a raised wall already, takes no search; otherwise it's a spare
+    if (inTree[wall]) return;
+    int a, b;
+    wallEnds(wall, a, b);
+    int raised = pathWall(a, b, true);
+    if (raised < 0) spareCount++;
+    else exchange(raised - (long) rows * cols, wall);
+}
+
+bool LinkCutForest::connected(int start_r, int start_c, int end_r, int end_c) {
+    return pathWall(start_r * cols + start_c, end_r * cols + end_c, true) < 0;
+}
+
+int LinkCutForest::distance(int start_r, int start_c, int end_r, int end_c) {
+    if (!connected(start_r, start_c, end_r, end_c)) return -1;
+    return nodes[end_r * cols + end_c].size - 1;
+}
+
+int LinkCutForest::path(int start_r, int start_c, int end_r, int end_c,
+        std::vector<unsigned char>& path) {
+    path.clear();
+    if (!connected(start_r, start_c, end_r, end_c)) return -1;
+    int start = start_r * cols + start_c, end = end_r * cols + end_c;
+    int count = rows * cols;
+
+    // The splay tree at end holds the path, start first: walk it in order,
+    // skipping the walls
+    int previous = start;
+    stack.clear();
+    int x = end;
+    while (x >= 0 || !stack.empty()) {
+        if (x >= 0) {
+            pushDown(x);
+            stack.push_back(x);
+            x = nodes[x].child[0];
+            continue;
+        }
+        x = stack.back();
+        stack.pop_back();
+        if (x < count) {
+            int step = x - previous;
+            if (step == cols) path.push_back(DOWN);
+            else if (step == -cols) path.push_back(UP);
+            else if (step == 1) path.push_back(RIGHT);
+            else if (step == -1) path.push_back(LEFT);
+            previous = x;
+        }
+        x = nodes[x].child[1];
+    }
+    return (int) path.size();
+}
+
+#endif /* LINKCUTFOREST_CPP_ */
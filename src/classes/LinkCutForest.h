@@ -0,0 +1,287 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file LinkCutForest.h
+ * @brief Contains the declaration of the LinkCutForest class.
+ */
+
+#ifndef LINKCUTFOREST_H_
+#define LINKCUTFOREST_H_
+
+#include <vector>
+#include "constants.h"
+#include "WallBits.h"
+
+/**
+ * @brief Keeps the path between two nodes up to date while walls are
+ * raised and knocked down, without searching the maze again.
+ *
+ * A spanning tree of the whole grid, open walls and raised ones, is kept in
+ * link-cut trees (Sleator and Tarjan), using as many open walls as it can:
+ * its open walls are then a spanning forest of the maze, and its raised
+ * walls only join the maze's separate pieces. Walls are nodes of their own,
+ * between the two nodes they join. Each tree is split into paths, each path
+ * is a splay tree ordered from the tree's root down, and every operation
+ * below takes O(log n) amortized time.
+ *
+ * The walls left out of that tree make a spanning tree of the dual grid,
+ * whose nodes are the posts where walls meet (the posts on the boundary all
+ * being one node), and it is kept in link-cut trees too. Its open walls are
+ * the spares, the ones that close loops. When an open wall of the first
+ * tree is raised, the walls that could join the two halves again are
+ * exactly those on the dual tree's path between the posts at the wall's
+ * ends, so one path query finds an open one, which trades places with it,
+ * or tells that there is none. Likewise a wall that isn't in the first tree
+ * is knocked down by trading places with a raised wall on that tree's path
+ * between its nodes, if there is one, or else becomes a spare.
+ *
+ * Two nodes are connected if the path between them has no raised walls. In
+ * a perfect maze that path is the solution; with loops it is a path that
+ * exists, but not always the shortest one.
+ *
+ * The forest keeps a pointer to the maze, so the maze must outlive it.
+ */
+class LinkCutForest {
+
+public:
+    /**
+     * @brief Most nodes a maze can have, so that every node, wall and post
+     * of the forest has an int id
+     */
+    static const long MAXNODES = (1L << 29) - 1;
+
+    LinkCutForest();
+
+    /**
+     * @brief Build the forest for a maze
+     *
+     * @param walls the maze
+     * @return true if success, false if the maze has more than MAXNODES
+     * nodes
+     */
+    bool build(const WallBits& walls);
+
+    /**
+     * @brief Bring the forest up to date after a wall was raised or knocked
+     * down in the maze
+     *
+     * @param r row of the node
+     * @param c column of the node
+     * @param dir direction of the wall from the node (RIGHT, UP, LEFT, DOWN)
+     */
+    void wallChanged(int r, int c, int dir);
+
+    /**
+     * @brief Tell whether there is a path between two nodes
+     *
+     * @param start_r the row of the starting node
+     * @param start_c the column of the starting node
+     * @param end_r the row of the ending node
+     * @param end_c the column of the ending node
+     * @return true if the nodes are connected
+     */
+    bool connected(int start_r, int start_c, int end_r, int end_c);
+
+    /**
+     * @brief Find the length of the path through the forest between two
+     * nodes
+     *
+     * @param start_r the row of the starting node
+     * @param start_c the column of the starting node
+     * @param end_r the row of the ending node
+     * @param end_c the column of the ending node
+     * @return length of the path, or -1 if there isn't one
+     */
+    int distance(int start_r, int start_c, int end_r, int end_c);
+
+    /**
+     * @brief Find the path through the forest between two nodes
+     *
+     * Takes O(log n) plus the length of the path.
+     *
+     * @param start_r the row of the starting node
+     * @param start_c the column of the starting node
+     * @param end_r the row of the ending node
+     * @param end_c the column of the ending node
+     * @param path filled with the directions to take from the start
+     * @return length of the path, or -1 if there isn't one
+     */
+    int path(int start_r, int start_c, int end_r, int end_c,
+            std::vector<unsigned char>& path);
+
+    /**
+     * @brief get the number of open walls that aren't in the forest
+     *
+     * @return number of spares
+     */
+    long numSpares() const { return spareCount; }
+
+private:
+
+    /**
+     * @brief A node of the splay trees
+     *
+     * parent is the parent in the splay tree, or for the root of a splay
+     * tree the node its path hangs from (-1 for none). flipped means the
+     * children of the subtree are to be swapped, which turns the path
+     * around. weight is 1 for a raised wall, 0 for an open one and -1 for a
+     * maze node or a post; size counts the maze nodes in the subtree, and
+     * raised and open are a raised and an open wall in it, or -1.
+     */
+    struct Node {
+        int child[2];
+        int parent;
+        int size;
+        int weight;
+        int raised, open;
+        bool flipped;
+    };
+
+    /**
+     * @brief Tell whether a node is the root of its splay tree
+     */
+    bool isSplayRoot(int x) const {
+        int p = nodes[x].parent;
+        return p < 0 || (nodes[p].child[0] != x && nodes[p].child[1] != x);
+    }
+
+    /**
+     * @brief Hand a node's flip down to its children
+     */
+    void pushDown(int x);
+
+    /**
+     * @brief Work out a node's size, and the walls in its subtree, from its
+     * children
+     */
+    void pullUp(int x);
+
+    /**
+     * @brief Rotate a node above its parent
+     */
+    void rotate(int x);
+
+    /**
+     * @brief Move a node to the root of its splay tree
+     */
+    void splay(int x);
+
+    /**
+     * @brief Make the path from the root of the tree to a node preferred,
+     * and splay the node to the root of it
+     */
+    void access(int x);
+
+    /**
+     * @brief Make a node the root of its tree
+     */
+    void makeRoot(int x);
+
+    /**
+     * @brief Find a raised (or open) wall on the path between two nodes of
+     * one tree, which is left splayed at b
+     *
+     * @return the wall's node, or -1 if the path has none
+     */
+    int pathWall(int a, int b, bool raised);
+
+    /**
+     * @brief Change the weight of a wall's node
+     */
+    void setWeight(int x, int weight);
+
+    /**
+     * @brief Join two trees with an edge
+     */
+    void link(int a, int b);
+
+    /**
+     * @brief Remove the edge between two nodes from the forest
+     */
+    void cut(int a, int b);
+
+    /**
+     * @brief Move one wall out of the tree of the maze and into the dual
+     * tree, and another the other way
+     */
+    void exchange(long out, long in);
+
+    /**
+     * @brief Get the wall on one side of a maze node, as node * 2 for a
+     * right wall and node * 2 + 1 for a down wall, or -1 on the boundary
+     */
+    long wallOf(int i, int dir) const;
+
+    /**
+     * @brief Get the splay tree node of a wall
+     */
+    int wallNode(long wall) const { return (int) ((long) rows * cols + wall); }
+
+    /**
+     * @brief Get the maze nodes on either side of a wall
+     */
+    void wallEnds(long wall, int& a, int& b) const;
+
+    /**
+     * @brief Get the splay tree nodes of the posts at the ends of a wall
+     */
+    void dualEnds(long wall, int& p, int& q) const;
+
+    /**
+     * @brief Get the splay tree node of the post at the top left corner of
+     * a maze node (the one for the whole boundary if it's on it)
+     */
+    int postNode(int r, int c) const;
+
+    /**
+     * @brief The maze
+     */
+    const WallBits *walls;
+
+    /**
+     * @brief Number of rows and columns
+     */
+    int rows, cols;
+
+    /**
+     * @brief Splay tree nodes: one per maze node, then one per wall (at
+     * wallNode()), then one per post inside the maze and one for the
+     * boundary
+     */
+    std::vector<Node> nodes;
+
+    /**
+     * @brief Whether each wall is in the tree of the maze, rather than the
+     * dual tree
+     */
+    std::vector<bool> inTree;
+
+    /**
+     * @brief Number of open walls not in the tree of the maze
+     */
+    long spareCount;
+
+    /**
+     * @brief Workspace for splay() and path()
+     */
+    std::vector<int> stack;
+};
+
+#endif /* LINKCUTFOREST_H_ */
@@ -31,12 +31,39 @@
 #include "Maze2d.h"
 #include "constants.h"
 #include "MazeNode.h"
+#include "LifeGrid.h"
+
+/*
+ * A seed for a maze's random stream, from rand()
+ */
+static uint64_t seedFromRand() {
+    uint64_t high = (uint64_t) rand();
+    return high << 31 ^ (uint64_t) rand();
+}
+
+Maze2d::Maze2d(int r, int c, std::string algorithm)
+        : Maze2d(r, c, algorithm, seedFromRand()) {
+}
+
+bool Maze2d::isAlgorithm(const std::string& algorithm) {
+    static const char *NAMES[] = {
+        "rb", "recursivebacktracking", "e", "eller", "ellers",
+        "ab", "aldousbroder", "aldousbroders", "w", "wilson", "wilsons",
+        "bt", "binarytree", "p", "prim", "prims", "s", "sidewinder",
+        "ca", "maze", "mc", "mazectric"
+    };
+    for (size_t i=0; i < sizeof(NAMES) / sizeof(NAMES[0]); i++) {
+        if (algorithm == NAMES[i]) return true;
+    }
+    return false;
+}
 
 /*
  * Constructor initializes the number of rows and cols, and also
  * allocates memory for the array of nodes.
  */
-Maze2d::Maze2d(int r, int c, std::string algorithm) {
+Maze2d::Maze2d(int r, int c, std::string algorithm, uint64_t seed) {
+    randomState = seed;
     rows = r < MAXMAZEWIDTH ? r : MAXMAZEWIDTH;
     cols = c < MAXMAZEHEIGHT ? c : MAXMAZEHEIGHT;
 
@@ -44,6 +71,10 @@ Maze2d::Maze2d(int r, int c, std::string algorithm) {
     nodes = new MazeNode *[rows];
     for(int i = 0; i < rows; i++)
         nodes[i] = new MazeNode[cols]; // initializes each node also
+    walls = WallBits(rows, cols);
+    perfect = true;
+    liveBuilt = false;
+    batch = NULL;
 
     setNodeLocations();
 
@@ -68,15 +99,41 @@ Maze2d::Maze2d(int r, int c, std::string algorithm) {
         binaryTree();
     } else if (algorithm == "p" || algorithm == "prim" || algorithm == "prims") {
         if (small_debug) std::cout << "Using Prim's algorithm\n";
-        prims(rand()%rows, rand()%cols);
+        prims(nextRandom()%rows, nextRandom()%cols);
     } else if (algorithm == "s" || algorithm == "sidewinder") {
     	if (small_debug) std::cout << "Using a sidewinder algorithm\n";
     	sidewinder();
+    } else if (algorithm == "ca" || algorithm == "maze") {
+        if (small_debug) std::cout << "Using the Maze cellular automaton\n";
+        cellularAutomaton(0x3e);
+    } else if (algorithm == "mc" || algorithm == "mazectric") {
+        if (small_debug) std::cout << "Using the Mazectric cellular automaton\n";
+        cellularAutomaton(0x1e);
     } else {
+        // Every wall is still up, so the nodes aren't joined
         std::cerr << "Algorithm \"" << algorithm << "\" not recognized.\n";
+        perfect = false;
     }
 }
 
+Maze2d::Maze2d(const WallBits& w, bool isPerfect) {
+    rows = w.numRows();
+    cols = w.numCols();
+
+    nodes = new MazeNode *[rows];
+    for(int i = 0; i < rows; i++)
+        nodes[i] = new MazeNode[cols];
+    walls = w;
+    // Files can claim a maze is perfect when it isn't
+    perfect = isPerfect && walls.isSpanningTree();
+    liveBuilt = false;
+    batch = NULL;
+    randomState = seedFromRand();
+
+    setNodeLocations();
+    linkNodesFromWalls();
+}
+
 /*
  * Delete the array row by row
  */
@@ -85,6 +142,17 @@ Maze2d::~Maze2d() {
         delete[] nodes[i];
     }
     delete[] nodes;
+    delete batch;
+}
+
+/*
+ * splitmix64, cut to the 31 bits rand() gives
+ */
+unsigned int Maze2d::nextRandom() {
+    uint64_t z = (randomState += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return (unsigned int) ((z ^ (z >> 31)) >> 33);
 }
 
 MazeNode& Maze2d::getCopyOfNode(int r, int c) {
@@ -92,6 +160,66 @@ MazeNode& Maze2d::getCopyOfNode(int r, int c) {
 	return copy;
 }
 
+bool Maze2d::setWalls(const WallBits& newWalls) {
+    if (newWalls.numRows() != rows || newWalls.numCols() != cols) return false;
+    walls = newWalls;
+    linkNodesFromWalls();
+    liveBuilt = false;
+    delete batch;
+    batch = NULL;
+    return true;
+}
+
+bool Maze2d::setWall(int r, int c, int dir, bool up) {
+    if (r < 0 || c < 0 || r >= rows || c >= cols) return false;
+    if (!walls.setWall(r, c, dir, up)) return false;
+    MazeNode *other = nodeTo(r, c, dir);
+    linkNodeFromWalls(r, c);
+    linkNodeFromWalls(other->row, other->col);
+    perfect = false;
+    if (liveBuilt) live.wallChanged(r, c, dir);
+    delete batch;
+    batch = NULL;
+    return true;
+}
+
+int Maze2d::liveSolution(std::vector<unsigned char>& path) {
+    if (!liveBuilt) {
+        if (!live.build(walls)) return -1;
+        liveBuilt = true;
+    }
+    return live.path(0, 0, rows-1, cols-1, path);
+}
+
+long Maze2d::braid(double fraction) {
+    long removed = walls.braid(fraction, nextRandom());
+    if (removed > 0) perfect = false;
+    linkNodesFromWalls();
+    liveBuilt = false;
+    delete batch;
+    batch = NULL;
+    if (small_debug) {
+        std::cout << "Braiding knocked down " << removed << " walls.\n";
+    }
+    return removed;
+}
+
+void Maze2d::linkNodesFromWalls() {
+    for (int r=0; r < rows; r++) {
+        for (int c=0; c < cols; c++) {
+            linkNodeFromWalls(r, c);
+        }
+    }
+}
+
+void Maze2d::linkNodeFromWalls(int r, int c) {
+    MazeNode& node = nodes[r][c];
+    node.right = walls.wall(r, c, RIGHT) ? NULL : &nodes[r][c+1];
+    node.up    = walls.wall(r, c, UP)    ? NULL : &nodes[r-1][c];
+    node.left  = walls.wall(r, c, LEFT)  ? NULL : &nodes[r][c-1];
+    node.down  = walls.wall(r, c, DOWN)  ? NULL : &nodes[r+1][c];
+}
+
 void Maze2d::setNodeLocations() {
     int r, c;
     for(r=0; r < rows; r++) {
@@ -111,87 +239,20 @@ void Maze2d::resetFlags() {
     }
 }
 
-void Maze2d::draw() {
-
-    int r, c;
-
-    // Top of the maze
-    std::cout << "  "; // leave entrance open
-    for (c=1; c < cols; c++) {
-        std::cout << " _";
-    }
-    std::cout << "\n";
-
-    // Cells
-    for (r=0; r < rows; r++) {
-        // Left side of the maze
-        std::cout << "|";
-        for (c=0; c < cols; c++) {
-            if (r == rows-1 && c == cols-1) {
-                std::cout << " |"; // leave exit open
-            }
-            else {
-                nodes[r][c].draw();
-            }
-        }
-        std::cout << "\n";
-    }
+void Maze2d::draw(MazeRenderer::Style style) {
+    MazeRenderer renderer(style);
+    renderer.draw(walls);
 }
 
-void Maze2d::drawBig(bool solve) {
-    int r, c;
-    int *solution_path, solution_length;
+void Maze2d::drawBig(bool solve, MazeRenderer::Style style) {
+    // Mark the nodes on the solution, one bit per node
+    std::vector<uint64_t> on_path;
     if (solve) {
-        solution_length = findPath(0,0,rows-1,cols-1,&solution_path);
+        findSolution(on_path);
     }
 
-    // Top of the maze
-    std::cout << "    ";
-    for (c=1; c < cols; c++) {
-        std::cout << " ___";
-    }
-    std::cout << "\n";
-
-    // Cells
-    for (r=0; r < rows; r++) {
-
-        // Top of row
-        std::cout << "|";
-        for (c=0; c < cols; c++) {
-            if (solve && nodes[r][c].part_of_solution) {
-                std::cout << " * ";
-            } else {
-                std::cout << "   ";
-            }
-            if (nodes[r][c].right) {
-                std::cout << " ";
-            }
-            else {
-                std::cout << "|";
-            }
-        }
-        std::cout << "\n";
-
-        // Bottom of row
-        std::cout << "|";
-        for (c=0; c < cols; c++) {
-            for (c=0; c < cols; c++) {
-                if (nodes[r][c].down || (r == rows-1 && c == cols-1)) {
-                    std::cout << "   ";
-                } else {
-                    std::cout << "___";
-                }
-
-                if (nodes[r][c].right) {
-                    std::cout << " ";
-                } else {
-                    std::cout << "|";
-                }
-
-            }
-        }
-        std::cout << "\n";
-    }
+    MazeRenderer renderer(style);
+    renderer.drawBig(walls, solve ? &on_path : NULL);
 }
 
 bool Maze2d::join(int r, int c, int dir) {
@@ -234,6 +295,7 @@ bool Maze2d::join(int r, int c, int dir) {
         break;
     }
 
+    walls.setWall(r, c, dir, false);
     return true;
 }
 
@@ -244,18 +306,22 @@ bool Maze2d::join(MazeNode *one, MazeNode *two) {
     if (one_r == two_r && one_c + 1 == two_c) {
         one->right = two;
         two->left = one;
+        walls.setWall(one_r, one_c, RIGHT, false);
     }
     else if (one_r - 1 == two_r && one_c == two_c) {
         one->up = two;
         two->down = one;
+        walls.setWall(one_r, one_c, UP, false);
     }
     else if (one_r == two_r && one_c - 1 == two_c) {
         one->left = two;
         two->right = one;
+        walls.setWall(one_r, one_c, LEFT, false);
     }
     else if (one_r + 1 == two_r && one_c == two_c) {
         one->down = two;
         two->up = one;
+        walls.setWall(one_r, one_c, DOWN, false);
     }
 
     return true;
@@ -505,7 +571,7 @@ void Maze2d::rb(int r, int c) {
         }
         else {
             // Pick a random place to go, and go!
-            int x = rand() % num_options;
+            int x = nextRandom() % num_options;
             int dir = option_array[x];
             if (debug) {
                 std::cout << "\tOptions are " << directionsToString(option_array, num_options) << "\n";
@@ -534,7 +600,7 @@ void Maze2d::rb(int r, int c) {
 
 /* Perform recursive backtracking starting in a random place */
 void Maze2d::rb() {
-    rb(rand() % rows, rand() % cols);
+    rb(nextRandom() % rows, nextRandom() % cols);
 }
 
 void Maze2d::ellers() {
@@ -565,7 +631,7 @@ void Maze2d::ellers() {
         for(int c=0; c < cols-1; c++) {
             // If the nodes are not already in the same set, 50/50 chance of
             // joining them
-            if(forwards[c] != c+1 && (rand() % 2) == 1) {
+            if(forwards[c] != c+1 && (nextRandom() % 2) == 1) {
                 if (debug) {
                     std::cout << "\t\tJoining node " << nodes[r][c];
                     std::cout << " with node " << nodes[r][c+1] << "\n";
@@ -594,7 +660,7 @@ void Maze2d::ellers() {
             // random number reflect how many nodes are in the set?
 
             // If it's a singleton set or 50/50 chance
-            if (forwards[c] == c || rand() % 2) {
+            if (forwards[c] == c || nextRandom() % 2) {
                 if (debug) {
                     std::cout << "\t\tJoining node " << nodes[r][c];
                     std::cout << " with node " << nodes[r+1][c] << "\n";
@@ -664,7 +730,7 @@ void Maze2d::prims(int r, int c) {
             std::cout << nodesToString(frontier) << "\n";
         }
 
-        int new_in_index = rand() % frontier.size();
+        int new_in_index = nextRandom() % frontier.size();
         MazeNode *new_in = frontier[new_in_index];
         int new_r = new_in->row, new_c = new_in->col;
 
@@ -694,7 +760,7 @@ void Maze2d::prims(int r, int c) {
             std::cout << "\n";
         }
 
-        int rand_visited_neighbor_index = rand() % visitedNeighbors.size();
+        int rand_visited_neighbor_index = nextRandom() % visitedNeighbors.size();
         MazeNode *rand_visited_neighbor = visitedNeighbors[rand_visited_neighbor_index];
         if (debug) {
             std::cout << "\tConnecting " << *new_in << " to ";
@@ -749,7 +815,7 @@ void Maze2d::prims(int r, int c) {
 
     while(!frontier.empty()) {
 
-        int new_in_index = rand() % frontier.size();
+        int new_in_index = nextRandom() % frontier.size();
         MazeNode *new_in = frontier[new_in_index];
         int new_r = new_in->row, new_c = new_in->col;
 
@@ -760,7 +826,7 @@ void Maze2d::prims(int r, int c) {
         std::vector<MazeNode *> unvisitedNeighbors = getUnvisitedNeighbors(new_r, new_c);
         std::vector<MazeNode *> visitedNeighbors = getVisitedNeighbors(new_r, new_c);
 
-        int rand_visited_neighbor_index = rand() % visitedNeighbors.size();
+        int rand_visited_neighbor_index = nextRandom() % visitedNeighbors.size();
         MazeNode *rand_visited_neighbor = visitedNeighbors[rand_visited_neighbor_index];
 
         join(new_in, rand_visited_neighbor);
@@ -823,7 +889,7 @@ void Maze2d::prims(int r, int c) {
             std::cout << nodesToString(frontier) << "\n";
         }
 
-        new_in_index = rand() % frontier.size();
+        new_in_index = nextRandom() % frontier.size();
         new_in = frontier[new_in_index];
         new_r = new_in->row;
         new_c = new_in->col;
@@ -851,7 +917,7 @@ void Maze2d::prims(int r, int c) {
             std::cout << "\n";
         }
 
-        rand_visited_neighbor_index = rand() % numVisitedNeighbors;
+        rand_visited_neighbor_index = nextRandom() % numVisitedNeighbors;
         rand_visited_neighbor = nodeTo(new_r, new_c, visitedNeighbors[rand_visited_neighbor_index]);
         if (debug) {
             std::cout << "\tConnecting " << *new_in << " to ";
@@ -883,7 +949,7 @@ void Maze2d::prims(int r, int c) {
 }
 
 void Maze2d::prims() {
-    prims(rand() % rows, rand() % cols);
+    prims(nextRandom() % rows, nextRandom() % cols);
 }
 
 void Maze2d::binaryTree() {
@@ -895,7 +961,7 @@ void Maze2d::binaryTree() {
             } else if (c == 0) {
                 join(r, c, UP);
             } else {
-                int which = rand() % 2;
+                int which = nextRandom() % 2;
                 if (which == 0) {
                     join(r, c, UP);
                 } else {
@@ -922,7 +988,7 @@ void Maze2d::aldousBroder(int r, int c) {
 
         int *direction_array;
         int num_directions = getAllNeighbors(row, col, &direction_array);
-        int direction = direction_array[rand() % num_directions];
+        int direction = direction_array[nextRandom() % num_directions];
 
         last_node = current_node;
         current_node = nodeTo(row, col, direction);
@@ -950,7 +1016,7 @@ void Maze2d::aldousBroder(int r, int c) {
 }
 
 void Maze2d::aldousBroder() {
-    aldousBroder(rand() % rows, rand() % cols);
+    aldousBroder(nextRandom() % rows, nextRandom() % cols);
 }
 
 void Maze2d::wilsons() {
@@ -965,7 +1031,8 @@ void Maze2d::wilsons() {
     }
 
     // Put the vector in a random order
-    std::random_shuffle(pairs.begin(), pairs.end());
+    std::random_shuffle(pairs.begin(), pairs.end(),
+            [this](long n) { return (long) (nextRandom() % n); });
     unsigned int pairs_index = 0; // refers to the place we're at in pairs
 
     if (debug) {
@@ -992,7 +1059,7 @@ void Maze2d::wilsons() {
             int num_all_neighbors;
             num_all_neighbors = getAllNeighbors(current_node->row, current_node->col, &all_neighbors);
 
-            int rand_neighbor_index = rand() % num_all_neighbors;
+            int rand_neighbor_index = nextRandom() % num_all_neighbors;
             int random_direction = all_neighbors[rand_neighbor_index];
 
             current_node->to = random_direction;
@@ -1025,52 +1092,42 @@ void Maze2d::wilsons() {
 }
 
 int Maze2d::findPath(int start_r, int start_c, int end_r, int end_c,
-        int **path_array) {
-    resetFlags();
-    // The path could potentially be as long as the maze
-    *path_array = new int[MAXMAZEWIDTH*MAXMAZEHEIGHT];
-
-    int len=0;
-
-    MazeNode *current_node = &nodes[start_r][start_c];
-    while (current_node != NULL &&
-            (current_node->row != end_r || current_node->col != end_c)) {
-
-        int *option_array;
-        int num_options = current_node->pathOptions(&option_array);
-
-        current_node->visited = true;
-        if (num_options == 0) {
-            // Set the part_of_solution variable to false
-            current_node->part_of_solution = false;
-
-            int from = (*path_array)[--len];
-
-            // std::cout << "backtracking " << from << "\n";
-            current_node = current_node->nodeTo(flip(from));
-        }
-        else {
-            // Set the part_of_solution variable to true
-            current_node->part_of_solution = true;
-
-            // go in the first direction
-            int dir = option_array[0];
-            (*path_array)[len++] = dir;
-            // std::cout << "moving " << dir << "\n";
-
-            // Get the next node
-            MazeNode *next_node = current_node->nodeTo(dir);
+        std::vector<unsigned char>& path) {
+    int len = solver.solve(walls, start_r, start_c, end_r, end_c, path);
+    if (small_debug) {
+        std::cout << "The solver expanded " << solver.expanded() << " nodes.\n";
+    }
+    return len;
+}
 
-            current_node = next_node;
-            current_node->from = flip(dir);
+void Maze2d::findSolution(std::vector<uint64_t>& onPath) {
+    if (perfect) {
+        solver.fillDeadEnds(walls, 0, 0, rows-1, cols-1, onPath);
+        return;
+    }
+
+    int words = walls.wordsPerRow();
+    std::vector<unsigned char> path;
+    onPath.assign((size_t)rows * words, 0);
+    if (findPath(0, 0, rows-1, cols-1, path) < 0) return;
+
+    int r = 0, c = 0;
+    onPath[0] |= 1;
+    for (unsigned int step=0; step < path.size(); step++) {
+        switch (path[step]) {
+        case RIGHT: c++; break;
+        case UP:    r--; break;
+        case LEFT:  c--; break;
+        case DOWN:  r++; break;
         }
-        delete[] option_array;
-    }
-    if (len > 0) {
-        nodes[end_r][end_c].part_of_solution = true;
+        onPath[(size_t)r * words + c / 64] |= (uint64_t)1 << (c % 64);
     }
+}
 
-    return len;
+void Maze2d::batchQuery(const PathQuery *queries, long count, int *distances,
+        std::vector<unsigned char> *paths) {
+    if (!batch) batch = new BatchQuery(walls);
+    batch->run(queries, count, distances, paths);
 }
 
 void Maze2d::huntAndKill() {
@@ -1088,13 +1145,13 @@ void Maze2d::sidewinder() {
 	for (int r=1; r < rows; r++) {
 		std::vector<MazeNode *> bunch;
 		for (int c=0; c < cols; c++) {
-			bool keepGoing = rand() % 2;
+			bool keepGoing = nextRandom() % 2;
 			bunch.push_back(&nodes[r][c]);
 			if (keepGoing && c < cols-1) {
 				join(r, c, RIGHT);
 			}
 			else {
-				MazeNode *randomFromBunch = bunch[rand() % bunch.size()];
+				MazeNode *randomFromBunch = bunch[nextRandom() % bunch.size()];
 				int rand_r = randomFromBunch->row;
 				int rand_c = randomFromBunch->col;
 				join(rand_r, rand_c, UP);
@@ -1104,4 +1161,75 @@ void Maze2d::sidewinder() {
 	}
 }
 
+void Maze2d::cellularAutomaton(int survive) {
+    LifeGrid grid(2*rows + 1, 2*cols + 1);
+    int total_steps = 0;
+    perfect = false;
+
+    // A sparse random soup; the automaton grows corridors out of it
+    grid.randomize(8, nextRandom());
+
+    /*
+     * Corridors form locally within a few dozen generations; big grids
+     * nearly always keep an oscillator going somewhere, so don't wait for
+     * the whole grid to settle.
+     */
+    int max_steps = 100;
+    while (total_steps < max_steps && grid.step(1 << 3, survive)) {
+        ++total_steps;
+    }
+
+    // Node (r, c) sits at (2r+1, 2c+1); a dead cell between two nodes is an
+    // opening
+    for (int r=0; r < rows; r++) {
+        for (int c=0; c < cols; c++) {
+            if (c < cols-1 && !grid.get(2*r + 1, 2*c + 2)) join(r, c, RIGHT);
+            if (r < rows-1 && !grid.get(2*r + 2, 2*c + 1)) join(r, c, DOWN);
+        }
+    }
+
+    connectComponents();
+
+    if (small_debug) {
+        std::cout << "The automaton ran for " << total_steps << " generations.\n";
+    }
+}
+
+void Maze2d::connectComponents() {
+    std::vector<MazeNode *> stack;
+    stack.reserve(rows * cols);
+
+    /*
+     * Scanning in row-major order, every node before (r, c) is reachable
+     * by the time we get to it, so an unreachable node can always be joined
+     * to the node above it (or to its left, in the top row).
+     */
+    for (int r=0; r < rows; r++) {
+        for (int c=0; c < cols; c++) {
+            if (nodes[r][c].visited) continue;
+
+            if (r > 0) join(r, c, UP);
+            else if (c > 0) join(r, c, LEFT);
+
+            if (debug) std::cout << "Flooding from " << nodes[r][c] << "\n";
+
+            nodes[r][c].visited = true;
+            stack.push_back(&nodes[r][c]);
+            while (!stack.empty()) {
+                MazeNode *node = stack.back();
+                stack.pop_back();
+                for (int dir=RIGHT; dir <= DOWN; dir++) {
+                    MazeNode *next = node->nodeTo(dir);
+                    if (next != NULL && !next->visited) {
+                        next->visited = true;
+                        stack.push_back(next);
+                    }
+                }
+            }
+        }
+    }
+
+    resetFlags();
+}
+
 #endif /* MAZE_CPP_ */
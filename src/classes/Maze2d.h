@@ -36,6 +36,11 @@
 #include <algorithm>
 #include "constants.h"
 #include "MazeNode.h"
+#include "WallBits.h"
+#include "MazeSolver.h"
+#include "BatchQuery.h"
+#include "LinkCutForest.h"
+#include "MazeRenderer.h"
 
 /**
  * @brief Maze data structure.
@@ -58,14 +63,50 @@ public:
      * @param algorithm the algorithm to be used to generate the maze
      */
     Maze2d(int r, int c, std::string algorithm);
+
+    /**
+     * @brief Initialize the maze with r rows and c columns, generated from
+     * its own random stream
+     *
+     * The maze draws nothing from rand(), so the same seed always gives the
+     * same maze, and mazes can be generated on several threads at once.
+     *
+     * @param r number of rows
+     * @param c number of columns
+     * @param algorithm the algorithm to be used to generate the maze
+     * @param seed seed of the maze's random stream
+     */
+    Maze2d(int r, int c, std::string algorithm, uint64_t seed);
+
+    /**
+     * @brief Initialize the maze from its walls, as loaded from a file
+     *
+     * The maze takes its size from the walls; no limit is applied.
+     *
+     * @param w the walls
+     * @param isPerfect whether the maze has no loops; only believed if the
+     * walls agree (see WallBits::isSpanningTree())
+     */
+    Maze2d(const WallBits& w, bool isPerfect);
     ~Maze2d();
 
+    /**
+     * @brief Tell whether a name is that of an algorithm a maze can be
+     * generated with
+     *
+     * @param algorithm the name, as given to the constructor
+     * @return true if the constructor knows it
+     */
+    static bool isAlgorithm(const std::string& algorithm);
+
     /**
      * @brief Draw this maze
      *
      * Prints the maze to standard out.
+     *
+     * @param style ASCII or UNICODE box-drawing characters
      */
-    void draw();
+    void draw(MazeRenderer::Style style = MazeRenderer::ASCII);
 
     /**
      * @brief Draw this maze bigger
@@ -73,8 +114,9 @@ public:
      * Prints the maze to standard out (twice as large as <code>draw()</code>)
      *
      * @param solve show the maze's solution if true
+     * @param style ASCII or UNICODE box-drawing characters
      */
-    void drawBig(bool solve);
+    void drawBig(bool solve, MazeRenderer::Style style = MazeRenderer::ASCII);
 
     /**
      * @brief Inquire whether the r, c node is connected to a neighboring node.
@@ -102,6 +144,114 @@ public:
 
     MazeNode& getCopyOfNode(int r, int c);
 
+    /**
+     * @brief Get the packed wall bitmap of the maze
+     *
+     * The bitmap is kept up to date as the maze is carved, so this is free.
+     *
+     * @return the walls
+     */
+    const WallBits& getWalls() const { return walls; }
+
+    /**
+     * @brief Replace every wall of the maze
+     *
+     * @param newWalls the new walls; must be the same size as the maze
+     * @return true if success, false if the sizes don't match
+     */
+    bool setWalls(const WallBits& newWalls);
+
+    /**
+     * @brief Raise or knock down one wall of the maze
+     *
+     * Keeps the nodes and the live solution (see liveSolution()) up to date.
+     * The maze is no longer counted as perfect afterwards.
+     *
+     * @param r row of the node
+     * @param c column of the node
+     * @param dir direction of the wall from the node (RIGHT, UP, LEFT, DOWN)
+     * @param up true to raise the wall, false to knock it down
+     * @return true if success, false for a wall on the boundary
+     */
+    bool setWall(int r, int c, int dir, bool up);
+
+    /**
+     * @brief Get the path from the entrance (0,0) to the exit (rows-1,
+     * cols-1), kept up to date through setWall()
+     *
+     * The first call builds a LinkCutForest of the maze; after that each
+     * wall edit costs O(log n) and this costs O(log n) plus the length of
+     * the path, instead of a search over the whole maze. In a maze with
+     * loops the path isn't always the shortest one.
+     *
+     * @param path filled with the directions to take from the entrance
+     * @return length of the path, or -1 if there isn't one or the maze is
+     * too big for a LinkCutForest
+     */
+    int liveSolution(std::vector<unsigned char>& path);
+
+    /**
+     * @brief Knock down walls to remove a fraction of the dead ends, making
+     * a braided maze with loops.
+     *
+     * @param fraction fraction of dead ends to remove, 0 to 1
+     * @return the number of walls knocked down
+     */
+    long braid(double fraction);
+
+    /**
+     * @brief Find a shortest path from a starting to ending position, and
+     * get the length of the solution
+     *
+     * Reuses the maze's solver workspace, so repeated calls don't allocate.
+     * Doesn't touch the nodes' flags.
+     *
+     * @param start_r the row of the starting node
+     * @param start_c the column of the starting node
+     * @param end_r the row of the ending node
+     * @param end_c the column of the ending node
+     * @param path filled with the directions to take from the start
+     * @return length of the path, or -1 if there isn't one
+     */
+    int findPath(int start_r, int start_c, int end_r, int end_c,
+            std::vector<unsigned char>& path);
+
+    /**
+     * @brief Mark every node on the solution from the entrance (0,0) to the
+     * exit (rows-1, cols-1) at once
+     *
+     * Perfect mazes are solved by filling in dead ends; mazes with loops
+     * fall back to findPath().
+     *
+     * @param onPath filled with one bit per node, set if the node is on the
+     * solution, in the same layout as the rows of getWalls()
+     */
+    void findSolution(std::vector<uint64_t>& onPath);
+
+    /**
+     * @brief Answer a batch of distance and/or path queries on several
+     * threads
+     *
+     * The BatchQuery behind it is built on the first call and kept until the
+     * walls change, so later batches on the same maze skip building the
+     * index. See BatchQuery.
+     *
+     * @param queries the start and end of each query
+     * @param count number of queries
+     * @param distances count ints to write the path lengths into (-1 if there
+     * is no path), or NULL
+     * @param paths count vectors to write the paths into, or NULL
+     */
+    void batchQuery(const PathQuery *queries, long count, int *distances,
+            std::vector<unsigned char> *paths);
+
+    /**
+     * @brief Tell whether the maze is perfect (has no loops)
+     *
+     * @return true if there is exactly one path between any two nodes
+     */
+    bool isPerfect() { return perfect; }
+
 private:
 
     /**
@@ -119,6 +269,63 @@ private:
      */
     int cols;
 
+    /**
+     * @brief The walls of the maze, packed (kept in sync by join())
+     */
+    WallBits walls;
+
+    /**
+     * @brief Whether the maze is perfect; cleared by generators with loops
+     * and by braiding
+     */
+    bool perfect;
+
+    /**
+     * @brief Workspace for findPath()
+     */
+    MazeSolver solver;
+
+    /**
+     * @brief Spanning forest behind liveSolution()
+     */
+    LinkCutForest live;
+
+    /**
+     * @brief Whether live has been built for the current walls
+     */
+    bool liveBuilt;
+
+    /**
+     * @brief Queries behind batchQuery(), or NULL until the first batch
+     * after the walls change
+     */
+    BatchQuery *batch;
+
+    /**
+     * @brief State of the maze's random stream (seeded from rand() unless
+     * given)
+     */
+    uint64_t randomState;
+
+    /**
+     * @brief Next number from the maze's random stream, 0 to 2^31-1 like
+     * rand()
+     */
+    unsigned int nextRandom();
+
+    /**
+     * @brief Point every node at its neighbors according to walls.
+     */
+    void linkNodesFromWalls();
+
+    /**
+     * @brief Point one node at its neighbors according to walls.
+     *
+     * @param r row of the node
+     * @param c column of the node
+     */
+    void linkNodeFromWalls(int r, int c);
+
     /**
      * @brief Sets the locations of every node in the maze.
      *
@@ -276,20 +483,6 @@ private:
      */
     bool getVisited(std::pair<int, int>& rowAndColumn);
 
-    /**
-     * @brief Find a path from a starting to ending position, and get the
-     * length of the solution
-     *
-     * @param start_r the row of the starting node
-     * @param start_c the column of the starting node
-     * @param end_r the row of the ending node
-     * @param end_c the column of the ending node
-     * @param path_array the address of an array to which we copy the path
-     * @return length of the path
-     */
-    int findPath(int start_r, int start_c, int end_r, int end_c,
-            int **path_array);
-
     /**
      * @brief Generate the maze using recursive backtracking
      *
@@ -377,6 +570,27 @@ private:
      * TODO Implement hunt-and-kill
      */
     void huntAndKill();
+
+    /**
+     * @brief Generate the maze with a life-like cellular automaton
+     *
+     * Runs a birth-on-3 automaton on a (2*rows+1) by (2*cols+1) LifeGrid
+     * until it settles, then reads the live cells between nodes as walls.
+     * The result has loops, so afterwards any pieces that the automaton
+     * closed off are joined back onto the rest of the maze.
+     *
+     * @param survive mask of neighbor counts that let a live cell survive
+     * (0x3e for "Maze", B3/S12345; 0x1e for "Mazectric", B3/S1234)
+     */
+    void cellularAutomaton(int survive);
+
+    /**
+     * @brief Join every node that can't be reached from node 0,0 onto the
+     * part of the maze that can.
+     *
+     * Uses the visited flags, and resets them when done.
+     */
+    void connectComponents();
 };
 
 #endif /* MAZE_H_ */
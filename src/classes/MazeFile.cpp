@@ -0,0 +1,225 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeFile.cpp
+ * @brief Contains the methods of the MazeFile class.
+ */
+
+#ifndef MAZEFILE_CPP_
+#define MAZEFILE_CPP_
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "MazeFile.h"
+
+/*
+ * The header, as it sits at the start of the file
+ */
+struct MazeFileHeader {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t version;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t wordsPerRow;
+    uint32_t flags;
+    uint64_t seed;
+    uint64_t rightOffset;
+    uint64_t downOffset;
+    uint64_t sectionBytes;
+    char algorithm[32];
+    char reserved[32];
+};
+
+static_assert(sizeof(MazeFileHeader) == 128, "the header is 128 bytes");
+
+static const char MAGIC[8] = {'M', 'A', 'Z', 'E', 'C', 'U', 'T', 0};
+static const uint32_t BYTEORDER = 0x01020304;
+static const uint32_t PERFECTFLAG = 1;
+
+/*
+ * Round a size up to a multiple of 64 bytes
+ */
+static inline uint64_t align64(uint64_t bytes) {
+    return (bytes + 63) & ~(uint64_t)63;
+}
+
+MazeFile::MazeFile() {
+    seed = 0;
+    perfect = true;
+    fd = -1;
+    writeRows = writeWords = rowsWritten = 0;
+    rightOffset = downOffset = 0;
+}
+
+MazeFile::~MazeFile() {
+    if (fd >= 0) close(fd);
+}
+
+bool MazeFile::save(const std::string& path, const WallBits& walls) {
+    if (!create(path, walls.numRows(), walls.numCols())) return false;
+    for (int r=0; r < walls.numRows(); r++) {
+        if (!appendRow(walls.rightRow(r), walls.downRow(r))) break;
+    }
+    return finish();
+}
+
+bool MazeFile::create(const std::string& path, int rows, int cols) {
+    if (fd >= 0) close(fd);
+    writeRows = rows;
+    writeWords = (cols + 63) / 64;
+    rowsWritten = 0;
+    uint64_t sectionBytes = (uint64_t) rows * writeWords * sizeof(uint64_t);
+
+    MazeFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.byteOrder = BYTEORDER;
+    header.version = VERSION;
+    header.rows = rows;
+    header.cols = cols;
+    header.wordsPerRow = writeWords;
+    header.flags = perfect ? PERFECTFLAG : 0;
+    header.seed = seed;
+    header.rightOffset = rightOffset = align64(sizeof(header));
+    header.downOffset = downOffset = rightOffset + align64(sectionBytes);
+    header.sectionBytes = sectionBytes;
+    strncpy(header.algorithm, algorithm.c_str(), sizeof(header.algorithm) - 1);
+
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        error = "can't open the file for writing";
+        return false;
+    }
+    // Size the file up front, so the padding comes out as zeros
+    if (ftruncate(fd, (off_t) (downOffset + sectionBytes)) != 0 ||
+            pwrite(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)) {
+        error = "can't write the file";
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool MazeFile::appendRow(const uint64_t *right, const uint64_t *down) {
+    if (fd < 0 || rowsWritten >= writeRows) {
+        error = "no row is expected";
+        return false;
+    }
+    size_t bytes = (size_t) writeWords * sizeof(uint64_t);
+    off_t offset = (off_t) rowsWritten * bytes;
+    if (pwrite(fd, right, bytes, (off_t) rightOffset + offset) != (ssize_t) bytes ||
+            pwrite(fd, down, bytes, (off_t) downOffset + offset) != (ssize_t) bytes) {
+        error = "can't write the file";
+        return false;
+    }
+    rowsWritten++;
+    return true;
+}
+
+bool MazeFile::finish() {
+    if (fd < 0) {
+        error = "no file is being written";
+        return false;
+    }
+    bool ok = rowsWritten == writeRows;
+    if (!ok) error = "the file is missing rows";
+    if (close(fd) != 0 && ok) {
+        error = "can't write the file";
+        ok = false;
+    }
+    fd = -1;
+    return ok;
+}
+
+bool MazeFile::load(const std::string& path, WallBits& walls) {
+    walls = WallBits();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "can't open the file";
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (uint64_t) info.st_size < sizeof(MazeFileHeader)) {
+        close(fd);
+        error = "the file is too short to be a maze";
+        return false;
+    }
+
+    // Private and writable, so the walls can still be changed in memory
+    size_t length = (size_t) info.st_size;
+    void *base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        error = "can't map the file";
+        return false;
+    }
+    std::shared_ptr<void> mapping(base, [length](void *p) { munmap(p, length); });
+
+    const MazeFileHeader& header = *(const MazeFileHeader *) base;
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = "not a maze file";
+        return false;
+    }
+    if (header.byteOrder != BYTEORDER) {
+        error = "the file was written on a machine with a different byte order";
+        return false;
+    }
+    if (header.version != VERSION) {
+        error = "unknown version of the maze format";
+        return false;
+    }
+
+    // Sizes have to agree with each other and with the file
+    uint64_t sectionBytes = (uint64_t) header.rows * header.wordsPerRow * sizeof(uint64_t);
+    if (header.rows == 0 || header.cols == 0 || header.rows > 0x7fffffff ||
+            header.cols > 0x7fffffff ||
+            header.wordsPerRow != (header.cols + 63) / 64 ||
+            header.sectionBytes != sectionBytes ||
+            header.rightOffset % 64 != 0 || header.downOffset % 64 != 0 ||
+            header.rightOffset < sizeof(MazeFileHeader) ||
+            header.rightOffset > length || length - header.rightOffset < sectionBytes ||
+            header.downOffset < header.rightOffset + sectionBytes ||
+            header.downOffset > length || length - header.downOffset < sectionBytes) {
+        error = "the header doesn't match the size of the file";
+        return false;
+    }
+
+    char *bytes = (char *) base;
+    if (!walls.attach((int) header.rows, (int) header.cols,
+            (uint64_t *) (bytes + header.rightOffset),
+            (uint64_t *) (bytes + header.downOffset), mapping)) {
+        error = "the boundary of the maze isn't walled";
+        return false;
+    }
+
+    algorithm.assign(header.algorithm, strnlen(header.algorithm, sizeof(header.algorithm)));
+    seed = header.seed;
+    perfect = (header.flags & PERFECTFLAG) != 0;
+    error.clear();
+    return true;
+}
+
+#endif /* MAZEFILE_CPP_ */
@@ -0,0 +1,156 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeFile.h
+ * @brief Contains the declaration of the MazeFile class.
+ */
+
+#ifndef MAZEFILE_H_
+#define MAZEFILE_H_
+
+#include <string>
+#include <stdint.h>
+#include "WallBits.h"
+
+/**
+ * @brief Reads and writes mazes in the binary .maze format.
+ *
+ * A .maze file is a 128-byte header followed by two sections, each starting
+ * on a 64-byte boundary: the right walls and then the down walls, exactly as
+ * WallBits keeps them in memory (rows * ((cols+63)/64) 64-bit words each,
+ * in the byte order of the machine that wrote the file).
+ *
+ * The header holds, in order: the magic "MAZECUT" and a zero byte, the
+ * 32-bit value 0x01020304 (to catch files from a machine of the other byte
+ * order), the format version, rows, columns, words per row, flags (bit 0 set
+ * for a perfect maze), the 64-bit seed, the offsets and length in bytes of
+ * the sections, and the name of the generating algorithm (up to 31
+ * characters, zero padded). The rest is zero.
+ *
+ * load() maps the file into memory and points a WallBits straight at the
+ * sections, so opening a maze of any size reads nothing but the header and
+ * the boundary walls. The mapping is private: changing the walls afterwards
+ * doesn't change the file.
+ *
+ * A maze that isn't held in a WallBits (because it doesn't fit in memory,
+ * say) can be written a row at a time with create(), appendRow() and
+ * finish().
+ */
+class MazeFile {
+
+public:
+    /**
+     * @brief The version of the format written by save()
+     */
+    static const uint32_t VERSION = 1;
+
+    MazeFile();
+    ~MazeFile();
+
+    /**
+     * @brief Write a maze to a file
+     *
+     * The algorithm, seed and perfect fields are written as the maze's
+     * metadata.
+     *
+     * @param path name of the file
+     * @param walls the maze
+     * @return true if success; otherwise error says why
+     */
+    bool save(const std::string& path, const WallBits& walls);
+
+    /**
+     * @brief Start writing a maze to a file a row at a time
+     *
+     * The algorithm, seed and perfect fields are written as the maze's
+     * metadata, so they have to be set first.
+     *
+     * @param path name of the file
+     * @param rows number of rows
+     * @param cols number of columns
+     * @return true if success; otherwise error says why
+     */
+    bool create(const std::string& path, int rows, int cols);
+
+    /**
+     * @brief Write the next row of the maze started with create()
+     *
+     * @param right the right walls of the row, laid out as WallBits::rightRow()
+     * @param down the down walls of the row, laid out as WallBits::downRow()
+     * @return true if success; otherwise error says why
+     */
+    bool appendRow(const uint64_t *right, const uint64_t *down);
+
+    /**
+     * @brief Close the file started with create()
+     *
+     * @return true if every row was written; otherwise error says why
+     */
+    bool finish();
+
+    /**
+     * @brief Map a maze from a file
+     *
+     * Fills in the algorithm, seed and perfect fields from the file.
+     *
+     * @param path name of the file
+     * @param walls set to the maze, using the mapped file
+     * @return true if success; otherwise error says why
+     */
+    bool load(const std::string& path, WallBits& walls);
+
+    /**
+     * @brief Name of the algorithm that generated the maze
+     */
+    std::string algorithm;
+
+    /**
+     * @brief Seed the maze was generated with
+     */
+    uint64_t seed;
+
+    /**
+     * @brief Whether the maze is perfect (has no loops)
+     */
+    bool perfect;
+
+    /**
+     * @brief Why the last save() or load() failed
+     */
+    std::string error;
+
+private:
+    /**
+     * @brief The file being written, or -1
+     */
+    int fd;
+
+    /**
+     * @brief Size of the maze being written, and the rows written so far
+     */
+    int writeRows, writeWords, rowsWritten;
+
+    /**
+     * @brief Where the sections of the file being written start
+     */
+    uint64_t rightOffset, downOffset;
+};
+
+#endif /* MAZEFILE_H_ */
@@ -0,0 +1,141 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeImage.h
+ * @brief Contains the declaration of the MazeImage class.
+ */
+
+#ifndef MAZEIMAGE_H_
+#define MAZEIMAGE_H_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "WallBits.h"
+
+/**
+ * @brief Writes a maze as a PBM, PGM or PNG image, a band of rows at a time.
+ *
+ * Each node is a square of cellPx pixels, with one-pixel walls on the lines
+ * between the squares, so the image is cols*cellPx+1 pixels wide and
+ * rows*cellPx+1 high. Walls are black and corridors white; in a PGM, or a
+ * PNG of a solved maze, the nodes on the solution are gray. The entrance and
+ * exit are left open, as in the text drawings.
+ *
+ * The scanlines of each row of nodes are drawn straight from the wall bits,
+ * and the rows go through forEachChunkInOrder() in bands of about a megabyte
+ * of pixels: worker threads draw the bands (and for a PNG, deflate each band
+ * on its own with zlib, ending on a byte boundary) while the calling thread
+ * writes them out in order. Memory use depends only on the width of the
+ * image, never its height.
+ *
+ * A PNG of an unsolved maze is 1 bit per pixel, otherwise 8. Its IDAT
+ * chunks are the deflated bands, one after another, which together make a
+ * single zlib stream.
+ */
+class MazeImage {
+
+public:
+    /**
+     * @brief Image formats
+     */
+    enum Format {PBM, PGM, PNG};
+
+    /**
+     * @brief Work out the format of an image from the end of its file name
+     *
+     * @param path name of the file (.pbm, .pgm or .png, in any case)
+     * @param format set to the format
+     * @return false if the name isn't that of an image
+     */
+    static bool formatOf(const std::string& path, Format& format);
+
+    /**
+     * @brief Create an image writer
+     *
+     * @param f the format
+     * @param cellPx pixels along the side of a node (at least 2)
+     */
+    MazeImage(Format f, int cellPx = 4);
+
+    /**
+     * @brief Write a maze to an image file
+     *
+     * @param path name of the file
+     * @param walls the maze
+     * @param onPath nodes to shade as on the solution, one bit per node laid
+     * out as WallBits::rightRow() (none if NULL; ignored for a PBM)
+     * @return true if success; otherwise error says why
+     */
+    bool save(const std::string& path, const WallBits& walls,
+            const std::vector<uint64_t> *onPath = NULL);
+
+    /**
+     * @brief Why the last save() failed
+     */
+    std::string error;
+
+private:
+
+    /**
+     * @brief Draw the scanlines of piece first..last-1 (piece r is the wall
+     * line above row r and row r's inside; piece rows is the bottom wall
+     * line) and replace bytes with them, packed and, for a PNG, deflated (or
+     * with nothing if deflating fails)
+     */
+    void drawBand(const WallBits& walls, const std::vector<uint64_t> *onPath,
+            int first, int last, std::vector<char>& bytes) const;
+
+    /**
+     * @brief Draw one scanline, one byte per pixel
+     *
+     * Pixels are 0 for a wall, 255 for a corridor and 160 for the solution.
+     *
+     * @param walls the maze
+     * @param onPath the solution bits, or NULL
+     * @param r the row of nodes the line goes through, or above if wallLine
+     * @param wallLine whether the line is on the walls above row r
+     * @param pixels filled with the line
+     */
+    void drawLine(const WallBits& walls, const std::vector<uint64_t> *onPath, int r,
+            bool wallLine, std::vector<unsigned char>& pixels) const;
+
+    /**
+     * @brief Append a scanline to bytes as the format stores it
+     */
+    void packLine(const std::vector<unsigned char>& pixels, std::vector<char>& bytes) const;
+
+    /**
+     * @brief The format
+     */
+    Format format;
+
+    /**
+     * @brief Pixels along the side of a node
+     */
+    int cellPx;
+
+    /**
+     * @brief Whether pixels are 8 bits (otherwise 1)
+     */
+    bool gray;
+};
+
+#endif /* MAZEIMAGE_H_ */
@@ -153,27 +153,6 @@ MazeNode *MazeNode::nodeTo(int dir) {
     }
 }
 
-int MazeNode::pathOptions(int **options_array) {
-    int len = 0;
-
-    *options_array = new int[4];
-
-    if (right && !right->visited) {
-        (*options_array)[len++] = RIGHT;
-    }
-    if (up && !up->visited) {
-        (*options_array)[len++] = UP;
-    }
-    if (left && !left->visited) {
-        (*options_array)[len++] = LEFT;
-    }
-    if (down && !down->visited) {
-        (*options_array)[len++] = DOWN;
-    }
-
-    return len;
-}
-
 std::string MazeNode::toString() {
     std::stringstream stream;
     stream << "(" << row << "," << col <<  ")";
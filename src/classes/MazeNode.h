@@ -164,16 +164,6 @@ public:
      */
     MazeNode *nodeTo(int dir);
 
-    /**
-     * @brief Get an array of all the directions that have an attaching node
-     *
-     * Don't forget to delete[] the pointer.
-     *
-     * @param options_array The address of an array in which to copy the directions into.
-     * @return The length of the array.
-     */
-    int pathOptions(int **options_array);
-
     /**
      * @brief Get a string description of this node of the form "row,col".
      *
@@ -0,0 +1,293 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeRenderer.cpp
+ * @brief Contains the methods of the MazeRenderer class.
+ */
+
+#ifndef MAZERENDERER_CPP_
+#define MAZERENDERER_CPP_
+
+#include <cstring>
+#include "MazeRenderer.h"
+#include "ParallelBands.h"
+
+/*
+ * Rows are formatted in chunks of about this much text
+ */
+static const size_t BLOCKBYTES = 1 << 20;
+
+/*
+ * Tables for the ASCII style, four nodes per entry. Entry bits 0-3 are the
+ * right walls of the nodes and bits 4-7 their down walls (or, for the top
+ * line of drawBig(), whether they're on the solution).
+ */
+struct AsciiTables {
+    char small[256][8];
+    char bigTop[256][16];
+    char bigBottom[256][16];
+
+    AsciiTables() {
+        for (int i=0; i < 256; i++) {
+            for (int k=0; k < 4; k++) {
+                bool right = (i >> k) & 1, low = (i >> (k + 4)) & 1;
+                char bar = right ? '|' : ' ';
+                small[i][2*k] = low ? '_' : ' ';
+                small[i][2*k+1] = bar;
+                memcpy(&bigTop[i][4*k], low ? " * " : "   ", 3);
+                bigTop[i][4*k+3] = bar;
+                memcpy(&bigBottom[i][4*k], low ? "___" : "   ", 3);
+                bigBottom[i][4*k+3] = bar;
+            }
+        }
+    }
+};
+
+static const AsciiTables& asciiTables() {
+    static const AsciiTables tables;
+    return tables;
+}
+
+/*
+ * Corners for the UNICODE style, indexed by which walls meet there: bit 0
+ * up, bit 1 right, bit 2 down, bit 3 left
+ */
+static const char *const CORNERS[16] = {
+    " ", "\xe2\x95\xb5", "\xe2\x95\xb6", "\xe2\x94\x94",
+    "\xe2\x95\xb7", "\xe2\x94\x82", "\xe2\x94\x8c", "\xe2\x94\x9c",
+    "\xe2\x95\xb4", "\xe2\x94\x98", "\xe2\x94\x80", "\xe2\x94\xb4",
+    "\xe2\x94\x90", "\xe2\x94\xa4", "\xe2\x94\xac", "\xe2\x94\xbc"
+};
+static const char HORIZONTAL[] = "\xe2\x94\x80";
+static const char VERTICAL[] = "\xe2\x94\x82";
+
+/*
+ * Get the bit of column c from a row of words
+ */
+static inline bool bitAt(const uint64_t *row, int c) {
+    return (row[c / 64] >> (c % 64)) & 1;
+}
+
+/*
+ * Get the four bits of columns c..c+3 (c a multiple of 4) from a row of words
+ */
+static inline unsigned nibbleAt(const uint64_t *row, int c) {
+    return (unsigned) (row[c / 64] >> (c % 64)) & 15;
+}
+
+MazeRenderer::MazeRenderer(Style s, FILE *o) {
+    style = s;
+    out = o;
+}
+
+void MazeRenderer::draw(const WallBits& walls) {
+    render(walls, NULL, false);
+}
+
+void MazeRenderer::drawBig(const WallBits& walls, const std::vector<uint64_t> *onPath) {
+    render(walls, onPath, true);
+}
+
+void MazeRenderer::drawInto(const WallBits& walls, bool big, const std::vector<uint64_t> *onPath,
+        std::vector<char>& text) const {
+    std::vector<char> pieces;
+    format(walls, onPath, big, 0, walls.numRows() + 1, pieces);
+    text.insert(text.end(), pieces.begin(), pieces.end());
+}
+
+size_t MazeRenderer::pieceBytes(int cols, bool big) const {
+    if (style == UNICODE) {
+        // Two lines, with every character taking at most three bytes
+        return 2 * (3 * (size_t) (cols + 1) * (big ? 4 : 2) + 1);
+    }
+    // Two lines, plus a whole table entry past the end of each
+    return big ? 2 * (4 * (size_t) cols + 2) + 32 : 2 * (size_t) cols + 2 + 16;
+}
+
+void MazeRenderer::render(const WallBits& walls, const std::vector<uint64_t> *onPath, bool big) {
+    long pieces = walls.numRows() + 1;
+    long chunk = (long) (BLOCKBYTES / pieceBytes(walls.numCols(), big));
+    forEachChunkInOrder(pieces, chunk > 0 ? chunk : 1,
+            [&](long first, long last, std::vector<char>& text) {
+                format(walls, onPath, big, (int) first, (int) last, text);
+            },
+            [&](const std::vector<char>& text) {
+                if (!text.empty()) fwrite(&text[0], 1, text.size(), out);
+            });
+    fflush(out);
+}
+
+void MazeRenderer::format(const WallBits& walls, const std::vector<uint64_t> *onPath, bool big,
+        int first, int last, std::vector<char>& text) const {
+    int rows = walls.numRows(), cols = walls.numCols();
+    int words = walls.wordsPerRow();
+    // An empty maze has no rows or columns to draw
+    if (rows == 0 || cols == 0) {
+        text.clear();
+        return;
+    }
+    text.resize((size_t) (last - first) * pieceBytes(cols, big));
+    char *p = &text[0];
+
+    // The last row, with the exit open
+    std::vector<uint64_t> lastDown;
+    if (last == rows + 1) {
+        lastDown.assign(walls.downRow(rows-1), walls.downRow(rows-1) + words);
+        lastDown[(cols-1) / 64] &= ~((uint64_t)1 << ((cols-1) % 64));
+    }
+
+    for (int piece=first; piece < last; piece++) {
+        if (style == UNICODE) {
+            p = formatUnicode(walls, onPath, big, piece, lastDown, p);
+        } else {
+            p = formatAscii(walls, onPath, big, piece, lastDown, p);
+        }
+    }
+    text.resize(p - &text[0]);
+}
+
+char *MazeRenderer::formatAscii(const WallBits& walls, const std::vector<uint64_t> *onPath,
+        bool big, int piece, const std::vector<uint64_t>& lastDown, char *p) const {
+    const AsciiTables& tables = asciiTables();
+    int rows = walls.numRows(), cols = walls.numCols();
+    int words = walls.wordsPerRow();
+
+    if (piece == 0) {
+        // Top of the maze, leaving the entrance open
+        if (big) {
+            memcpy(p, "    ", 4);
+            p += 4;
+            for (int c=1; c < cols; c++) {
+                memcpy(p, " ___", 4);
+                p += 4;
+            }
+        } else {
+            *p++ = ' ';
+            *p++ = ' ';
+            for (int c=1; c < cols; c++) {
+                *p++ = ' ';
+                *p++ = '_';
+            }
+        }
+        *p++ = '\n';
+        return p;
+    }
+
+    int r = piece - 1;
+    const uint64_t *right = walls.rightRow(r);
+    const uint64_t *down = r == rows-1 ? &lastDown[0] : walls.downRow(r);
+    char *line = p;
+
+    if (!big) {
+        *p++ = '|';
+        for (int c=0; c < cols; c += 4) {
+            memcpy(p, tables.small[nibbleAt(right, c) | nibbleAt(down, c) << 4], 8);
+            p += 8;
+        }
+        p = line + 1 + 2 * cols;
+        *p++ = '\n';
+        return p;
+    }
+
+    // Top of row
+    const uint64_t *path = onPath ? &(*onPath)[(size_t) r * words] : NULL;
+    *p++ = '|';
+    for (int c=0; c < cols; c += 4) {
+        unsigned marks = path ? nibbleAt(path, c) : 0;
+        memcpy(p, tables.bigTop[nibbleAt(right, c) | marks << 4], 16);
+        p += 16;
+    }
+    p = line + 1 + 4 * cols;
+    *p++ = '\n';
+
+    // Bottom of row
+    line = p;
+    *p++ = '|';
+    for (int c=0; c < cols; c += 4) {
+        memcpy(p, tables.bigBottom[nibbleAt(right, c) | nibbleAt(down, c) << 4], 16);
+        p += 16;
+    }
+    p = line + 1 + 4 * cols;
+    *p++ = '\n';
+    return p;
+}
+
+char *MazeRenderer::formatUnicode(const WallBits& walls, const std::vector<uint64_t> *onPath,
+        bool big, int piece, const std::vector<uint64_t>& lastDown, char *p) const {
+    int rows = walls.numRows(), cols = walls.numCols();
+    int words = walls.wordsPerRow();
+    int width = big ? 3 : 1;
+
+    if (big && piece > 0) {
+        // Middle of the row above the corners
+        int r = piece - 1;
+        const uint64_t *right = walls.rightRow(r);
+        const uint64_t *path = onPath ? &(*onPath)[(size_t) r * words] : NULL;
+        for (int j=0; j <= cols; j++) {
+            if (j == 0 || bitAt(right, j-1)) {
+                memcpy(p, VERTICAL, 3);
+                p += 3;
+            } else {
+                *p++ = ' ';
+            }
+            if (j == cols) break;
+            memcpy(p, path && bitAt(path, j) ? " * " : "   ", 3);
+            p += 3;
+        }
+        *p++ = '\n';
+    }
+
+    // Walls along the top of row i, and those on the right of the rows
+    // above and below the corners. The top line has its bits inverted: set
+    // means the wall is down, so only the entrance is open.
+    int i = piece;
+    uint64_t entrance = 1;
+    const uint64_t *across;
+    if (i == 0) across = &entrance;
+    else if (i == rows) across = &lastDown[0];
+    else across = walls.downRow(i-1);
+    const uint64_t *above = i > 0 ? walls.rightRow(i-1) : NULL;
+    const uint64_t *below = i < rows ? walls.rightRow(i) : NULL;
+    bool inverted = i == 0;
+
+    for (int j=0; j <= cols; j++) {
+        bool leftWall = j > 0 && (inverted ? j-1 != 0 : bitAt(across, j-1));
+        bool rightWall = j < cols && (inverted ? j != 0 : bitAt(across, j));
+        bool upWall = above && (j == 0 || bitAt(above, j-1));
+        bool downWall = below && (j == 0 || bitAt(below, j-1));
+        const char *corner = CORNERS[upWall | rightWall << 1 | downWall << 2 | leftWall << 3];
+        size_t length = corner[1] ? 3 : 1;
+        memcpy(p, corner, length);
+        p += length;
+        if (j == cols) break;
+        for (int k=0; k < width; k++) {
+            if (rightWall) {
+                memcpy(p, HORIZONTAL, 3);
+                p += 3;
+            } else {
+                *p++ = ' ';
+            }
+        }
+    }
+    *p++ = '\n';
+    return p;
+}
+
+#endif /* MAZERENDERER_CPP_ */
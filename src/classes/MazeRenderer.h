@@ -0,0 +1,148 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeRenderer.h
+ * @brief Contains the declaration of the MazeRenderer class.
+ */
+
+#ifndef MAZERENDERER_H_
+#define MAZERENDERER_H_
+
+#include <cstdio>
+#include <vector>
+#include <stdint.h>
+#include "WallBits.h"
+
+/**
+ * @brief Draws a maze as text.
+ *
+ * In the ASCII style the text is what Maze2d has always printed: draw() gives
+ * each node two characters ("_" or " " for the wall below it, "|" or " " for
+ * the wall on its right), and drawBig() gives it four characters on two
+ * lines. Four nodes at a time are looked up in a table indexed by their wall
+ * bits (and solution bits), which hands back all of their characters at
+ * once, so a row costs a handful of table lookups per 64 nodes.
+ *
+ * In the UNICODE style the walls are drawn with box-drawing characters. The
+ * text has a line for each row of corners between the nodes, and each corner
+ * is looked up in a table indexed by which of the four walls meeting there
+ * are up. drawBig() adds a line through the middle of each row of nodes.
+ *
+ * Either way, rows are formatted in chunks of about a megabyte of text, on
+ * one thread per core, and written out in order by the calling thread (see
+ * forEachChunkInOrder()), so a large maze is written about as fast as the
+ * file or pipe takes it. As in Maze2d, the entrance (the top of the top left
+ * node) and the exit (the bottom of the bottom right node) are left open.
+ */
+class MazeRenderer {
+
+public:
+    /**
+     * @brief Styles of text
+     */
+    enum Style {ASCII, UNICODE};
+
+    /**
+     * @brief Create a renderer
+     *
+     * @param s the style of text
+     * @param out where to write it
+     */
+    MazeRenderer(Style s = ASCII, FILE *out = stdout);
+
+    /**
+     * @brief Draw a maze
+     *
+     * @param walls the maze
+     */
+    void draw(const WallBits& walls);
+
+    /**
+     * @brief Draw a maze bigger
+     *
+     * @param walls the maze
+     * @param onPath nodes to mark as on the solution, one bit per node laid
+     * out as WallBits::rightRow() (none if NULL)
+     */
+    void drawBig(const WallBits& walls, const std::vector<uint64_t> *onPath = NULL);
+
+    /**
+     * @brief Add the text of a maze to the end of a buffer, formatted on
+     * the calling thread, instead of writing it out
+     *
+     * @param walls the maze
+     * @param big whether to draw it as drawBig() does
+     * @param onPath as for drawBig()
+     * @param text the buffer
+     */
+    void drawInto(const WallBits& walls, bool big, const std::vector<uint64_t> *onPath,
+            std::vector<char>& text) const;
+
+private:
+
+    /**
+     * @brief Draw a maze, bigger if big
+     */
+    void render(const WallBits& walls, const std::vector<uint64_t> *onPath, bool big);
+
+    /**
+     * @brief Most bytes of text a piece can take
+     *
+     * Piece 0 is the top line of the maze. Piece r+1 is row r in the ASCII
+     * style, and in the UNICODE style the middle line of row r (if big) and
+     * the corners below it.
+     */
+    size_t pieceBytes(int cols, bool big) const;
+
+    /**
+     * @brief Replace text with the text of pieces first..last-1 (nothing
+     * for a maze with no rows or columns)
+     */
+    void format(const WallBits& walls, const std::vector<uint64_t> *onPath, bool big,
+            int first, int last, std::vector<char>& text) const;
+
+    /**
+     * @brief Write the text of a piece in the ASCII style
+     *
+     * @return the end of the text
+     */
+    char *formatAscii(const WallBits& walls, const std::vector<uint64_t> *onPath,
+            bool big, int piece, const std::vector<uint64_t>& lastDown, char *p) const;
+
+    /**
+     * @brief Write the text of a piece in the UNICODE style
+     *
+     * @return the end of the text
+     */
+    char *formatUnicode(const WallBits& walls, const std::vector<uint64_t> *onPath,
+            bool big, int piece, const std::vector<uint64_t>& lastDown, char *p) const;
+
+    /**
+     * @brief The style of text
+     */
+    Style style;
+
+    /**
+     * @brief Where the text goes
+     */
+    FILE *out;
+};
+
+#endif /* MAZERENDERER_H_ */
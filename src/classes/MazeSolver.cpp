@@ -0,0 +1,538 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeSolver.cpp
+ * @brief Contains the methods of the MazeSolver class.
+ */
+
+#ifndef MAZESOLVER_CPP_
+#define MAZESOLVER_CPP_
+
+#include <algorithm>
+#include <cstdlib>
+#include "MazeSolver.h"
+
+MazeSolver::MazeSolver() {
+    numExpanded = 0;
+}
+
+void MazeSolver::prepare(const WallBits& walls) {
+    long n = (long) walls.numRows() * walls.numCols();
+
+    visited.assign((n + 63) / 64, 0);
+    // Parents are only ever read for visited nodes, so no need to clear them
+    if ((long) parents.size() < (n + 3) / 4) parents.resize((n + 3) / 4);
+    if ((long) queue.size() < n) queue.resize(n);
+
+    numExpanded = 0;
+}
+
+void MazeSolver::tracePath(const WallBits& walls, long start, long end,
+        std::vector<unsigned char>& path) const {
+    path.clear();
+    for (long i = end; i != start; ) {
+        int dir = parentDir(i);
+        path.push_back((unsigned char) dir);
+        i = stepIndex(i, flip(dir), walls.numCols());
+    }
+    std::reverse(path.begin(), path.end());
+}
+
+int MazeSolver::solve(const WallBits& walls, int start_r, int start_c,
+        int end_r, int end_c, std::vector<unsigned char>& path) {
+    int cols = walls.numCols();
+    long start = (long) start_r * cols + start_c;
+    long end = (long) end_r * cols + end_c;
+
+    prepare(walls);
+    path.clear();
+
+    long head = 0, tail = 0;
+    queue[tail++] = start;
+    markVisited(start);
+
+    while (head < tail) {
+        long i = queue[head++];
+        ++numExpanded;
+        if (i == end) {
+            tracePath(walls, start, end, path);
+            return (int) path.size();
+        }
+
+        int r = (int) (i / cols), c = (int) (i % cols);
+        for (int dir=RIGHT; dir <= DOWN; dir++) {
+            if (walls.wall(r, c, dir)) continue;
+            long next = stepIndex(i, dir, cols);
+            if (isVisited(next)) continue;
+            markVisited(next);
+            setParentDir(next, dir);
+            queue[tail++] = next;
+        }
+    }
+
+    return -1;
+}
+
+int MazeSolver::farthestFrom(const WallBits& walls, int r, int c,
+        int& far_r, int& far_c) {
+    int cols = walls.numCols();
+    long start = (long) r * cols + c;
+
+    prepare(walls);
+
+    long head = 0, tail = 0;
+    queue[tail++] = start;
+    markVisited(start);
+
+    // Go one level at a time so we know how far away the last node is
+    int distance = -1;
+    while (head < tail) {
+        long levelEnd = tail;
+        ++distance;
+        for (; head < levelEnd; head++) {
+            long i = queue[head];
+            ++numExpanded;
+            int i_r = (int) (i / cols), i_c = (int) (i % cols);
+            for (int dir=RIGHT; dir <= DOWN; dir++) {
+                if (walls.wall(i_r, i_c, dir)) continue;
+                long next = stepIndex(i, dir, cols);
+                if (isVisited(next)) continue;
+                markVisited(next);
+                queue[tail++] = next;
+            }
+        }
+    }
+
+    far_r = (int) (queue[tail-1] / cols);
+    far_c = (int) (queue[tail-1] % cols);
+    return distance;
+}
+
+int MazeSolver::solveBidirectional(const WallBits& walls, int start_r,
+        int start_c, int end_r, int end_c, std::vector<unsigned char>& path) {
+    int cols = walls.numCols();
+    long n = (long) walls.numRows() * cols;
+    long start = (long) start_r * cols + start_c;
+    long end = (long) end_r * cols + end_c;
+
+    prepare(walls);
+    side.assign(visited.size(), 0);
+    path.clear();
+
+    if (start == end) {
+        numExpanded = 1;
+        return 0;
+    }
+
+    // The forward queue grows up from 0, the backward one down from n-1
+    long fHead = 0, fTail = 0;
+    long bHead = n-1, bTail = n-1;
+    queue[fTail++] = start;
+    markVisited(start);
+    queue[bTail--] = end;
+    markVisited(end);
+    side[end >> 6] |= (uint64_t)1 << (end & 63);
+
+    long meetFrom = -1, meetTo = -1;
+    int meetDir = -1;
+
+    while (meetFrom < 0 && fHead < fTail && bHead > bTail) {
+        bool forwards = (fTail - fHead) <= (bHead - bTail);
+
+        // Expand one whole level of the chosen frontier
+        long levelEnd = forwards ? fTail : bTail;
+        while (meetFrom < 0 && (forwards ? fHead < levelEnd : bHead > levelEnd)) {
+            long i = forwards ? queue[fHead++] : queue[bHead--];
+            ++numExpanded;
+
+            int r = (int) (i / cols), c = (int) (i % cols);
+            for (int dir=RIGHT; dir <= DOWN; dir++) {
+                if (walls.wall(r, c, dir)) continue;
+                long next = stepIndex(i, dir, cols);
+                if (isVisited(next)) {
+                    bool nextBackwards = (side[next >> 6] >> (next & 63)) & 1;
+                    if (nextBackwards == forwards) {
+                        // The searches meet on the edge i -> next
+                        meetFrom = i;
+                        meetTo = next;
+                        meetDir = dir;
+                        break;
+                    }
+                    continue;
+                }
+                markVisited(next);
+                setParentDir(next, dir);
+                if (forwards) {
+                    queue[fTail++] = next;
+                } else {
+                    side[next >> 6] |= (uint64_t)1 << (next & 63);
+                    queue[bTail--] = next;
+                }
+            }
+        }
+    }
+
+    if (meetFrom < 0) return -1;
+
+    // Orient the meeting edge so it runs from the start side to the end side
+    if ((side[meetFrom >> 6] >> (meetFrom & 63)) & 1) {
+        std::swap(meetFrom, meetTo);
+        meetDir = flip(meetDir);
+    }
+
+    tracePath(walls, start, meetFrom, path);
+    path.push_back((unsigned char) meetDir);
+    // Parents on the end side point away from the end, so walk them back
+    for (long i = meetTo; i != end; ) {
+        int dir = flip(parentDir(i));
+        path.push_back((unsigned char) dir);
+        i = stepIndex(i, dir, cols);
+    }
+
+    return (int) path.size();
+}
+
+int MazeSolver::solveAStar(const WallBits& walls, int start_r, int start_c,
+        int end_r, int end_c, std::vector<unsigned char>& path) {
+    const int RING = 4;
+    int cols = walls.numCols();
+    long n = (long) walls.numRows() * cols;
+    long start = (long) start_r * cols + start_c;
+    long end = (long) end_r * cols + end_c;
+
+    prepare(walls);
+    opened.assign(visited.size(), 0);
+    if ((long) gScore.size() < n) gScore.resize(n);
+    for (int b=0; b < RING; b++) buckets[b].clear();
+    path.clear();
+
+    int f = abs(start_r - end_r) + abs(start_c - end_c);
+    gScore[start] = 0;
+    opened[start >> 6] |= (uint64_t)1 << (start & 63);
+    buckets[f % RING].push_back(start);
+    long queued = 1;
+
+    while (queued > 0) {
+        // Find the lowest non-empty bucket; f never goes down
+        while (buckets[f % RING].empty()) f++;
+        long i = buckets[f % RING].back();
+        buckets[f % RING].pop_back();
+        --queued;
+
+        // Skip stale entries left behind when a node's g-score improved
+        if (isVisited(i)) continue;
+        markVisited(i);
+        ++numExpanded;
+
+        if (i == end) {
+            tracePath(walls, start, end, path);
+            return gScore[end];
+        }
+
+        int r = (int) (i / cols), c = (int) (i % cols);
+        int g = gScore[i] + 1;
+        for (int dir=RIGHT; dir <= DOWN; dir++) {
+            if (walls.wall(r, c, dir)) continue;
+            long next = stepIndex(i, dir, cols);
+            if (isVisited(next)) continue;
+
+            bool seen = (opened[next >> 6] >> (next & 63)) & 1;
+            if (seen && gScore[next] <= g) continue;
+
+            opened[next >> 6] |= (uint64_t)1 << (next & 63);
+            gScore[next] = g;
+            setParentDir(next, dir);
+
+            int next_r = (int) (next / cols), next_c = (int) (next % cols);
+            int next_f = g + abs(next_r - end_r) + abs(next_c - end_c);
+            buckets[next_f % RING].push_back(next);
+            ++queued;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * The places a search can start or end from a node: the node itself if it is
+ * a vertex, otherwise the vertices at the ends of its corridor, with the
+ * distance and the direction to leave the node in. Walks that reach the
+ * other node first are left out, since the route along the corridor is
+ * always shorter, and their length goes in direct. Returns the count.
+ */
+static int corridorEnds(const JunctionGraph& graph, long node, long other,
+        long *vertices, int *distances, int *dirs, int& direct, int& directDir) {
+    const WallBits& walls = graph.getWalls();
+    int cols = walls.numCols();
+    int r = (int) (node / cols), c = (int) (node % cols);
+
+    if (graph.isVertex(r, c)) {
+        vertices[0] = graph.vertex(r, c);
+        distances[0] = 0;
+        dirs[0] = -1;
+        return 1;
+    }
+
+    int count = 0;
+    for (int dir=RIGHT; dir <= DOWN; dir++) {
+        if (walls.wall(r, c, dir)) continue;
+        int length;
+        long to = graph.walk(node, dir, other, NULL, length);
+        if (to == other) {
+            if (direct < 0 || length < direct) {
+                direct = length;
+                directDir = dir;
+            }
+        } else if (to != node) {
+            int to_r = (int) (to / cols), to_c = (int) (to % cols);
+            vertices[count] = graph.vertex(to_r, to_c);
+            distances[count] = length;
+            dirs[count] = dir;
+            count++;
+        }
+    }
+    return count;
+}
+
+int MazeSolver::solveJunctions(const JunctionGraph& graph, int start_r,
+        int start_c, int end_r, int end_c, std::vector<unsigned char>& path) {
+    const WallBits& walls = graph.getWalls();
+    int cols = walls.numCols();
+    long n = graph.numVertices();
+    long start = (long) start_r * cols + start_c;
+    long end = (long) end_r * cols + end_c;
+
+    // Smallest power of two that's more than twice the longest edge
+    long ring = 1;
+    while (ring <= 2 * (long) graph.longestEdge()) ring <<= 1;
+
+    visited.assign((n + 63) / 64, 0);
+    opened.assign(visited.size(), 0);
+    if ((long) gScore.size() < n) gScore.resize(n);
+    if ((long) parentEdges.size() < n) parentEdges.resize(n);
+    if ((long) vertexBuckets.size() < ring) vertexBuckets.resize(ring);
+    for (long b=0; b < ring; b++) vertexBuckets[b].clear();
+    numExpanded = 0;
+    path.clear();
+
+    if (start == end) return 0;
+
+    long startVertices[4], endVertices[4];
+    int startDistances[4], endDistances[4];
+    int startDirs[4], endDirs[4];
+    int best = -1, bestDir = -1, fromEnd = -1, fromEndDir = -1;
+    int numStarts = corridorEnds(graph, start, end, startVertices,
+            startDistances, startDirs, best, bestDir);
+    int numEnds = corridorEnds(graph, end, start, endVertices, endDistances,
+            endDirs, fromEnd, fromEndDir);
+
+    // The end's corridor can lead straight to a start that is a vertex
+    bool backwards = false;
+    if (fromEnd >= 0 && (best < 0 || fromEnd < best)) {
+        best = fromEnd;
+        bestDir = fromEndDir;
+        backwards = true;
+    }
+
+    long queued = 0;
+    int f = -1;
+    for (int k=0; k < numStarts; k++) {
+        long v = startVertices[k];
+        bool seen = (opened[v >> 6] >> (v & 63)) & 1;
+        if (seen && gScore[v] <= startDistances[k]) continue;
+        opened[v >> 6] |= (uint64_t)1 << (v & 63);
+        gScore[v] = startDistances[k];
+        parentEdges[v] = -1 - k;
+        long node = graph.node(v);
+        int v_f = startDistances[k] + abs((int) (node / cols) - end_r) + abs((int) (node % cols) - end_c);
+        vertexBuckets[v_f & (ring - 1)].push_back(v);
+        ++queued;
+        if (f < 0 || v_f < f) f = v_f;
+    }
+
+    long bestVertex = -1;
+    int bestEnd = -1;
+    while (queued > 0) {
+        // Find the lowest non-empty bucket; f never goes down
+        while (vertexBuckets[f & (ring - 1)].empty()) f++;
+
+        // Nothing left in the open list can beat the best path so far
+        if (best >= 0 && f >= best) break;
+
+        std::vector<long>& bucket = vertexBuckets[f & (ring - 1)];
+        long v = bucket.back();
+        bucket.pop_back();
+        --queued;
+
+        // Skip stale entries left behind when a vertex's g-score improved
+        if (isVisited(v)) continue;
+        markVisited(v);
+        ++numExpanded;
+
+        int g = gScore[v];
+        for (int k=0; k < numEnds; k++) {
+            if (endVertices[k] == v && (best < 0 || g + endDistances[k] < best)) {
+                best = g + endDistances[k];
+                bestVertex = v;
+                bestEnd = k;
+            }
+        }
+
+        for (long e = graph.firstEdge(v); e < graph.firstEdge(v+1); e++) {
+            long u = graph.target(e);
+            if (isVisited(u)) continue;
+            int next_g = g + graph.weight(e);
+
+            bool seen = (opened[u >> 6] >> (u & 63)) & 1;
+            if (seen && gScore[u] <= next_g) continue;
+
+            opened[u >> 6] |= (uint64_t)1 << (u & 63);
+            gScore[u] = next_g;
+            parentEdges[u] = e;
+
+            long node = graph.node(u);
+            int next_f = next_g + abs((int) (node / cols) - end_r) + abs((int) (node % cols) - end_c);
+            vertexBuckets[next_f & (ring - 1)].push_back(u);
+            ++queued;
+        }
+    }
+
+    if (best < 0) return -1;
+
+    int length;
+    if (bestVertex < 0) {
+        // Straight along the corridor
+        if (!backwards) {
+            graph.walk(start, bestDir, end, &path, length);
+        } else {
+            graph.walk(end, bestDir, start, &path, length);
+            std::reverse(path.begin(), path.end());
+            for (size_t i=0; i < path.size(); i++) path[i] = (unsigned char) flip(path[i]);
+        }
+        return best;
+    }
+
+    // The edges taken, from the last back to the first
+    std::vector<long> edges;
+    long v = bestVertex;
+    while (parentEdges[v] >= 0) {
+        edges.push_back(parentEdges[v]);
+        v = graph.source(parentEdges[v]);
+    }
+
+    int k = (int) (-1 - parentEdges[v]);
+    if (startDirs[k] >= 0) graph.walk(start, startDirs[k], -1, &path, length);
+    for (long i = (long) edges.size() - 1; i >= 0; i--) {
+        graph.walk(graph.node(graph.source(edges[i])), graph.direction(edges[i]), -1, &path, length);
+    }
+    if (endDirs[bestEnd] >= 0) {
+        // Walk from the end to the vertex, then turn it around
+        std::vector<unsigned char> tail;
+        graph.walk(end, endDirs[bestEnd], -1, &tail, length);
+        for (long i = (long) tail.size() - 1; i >= 0; i--) {
+            path.push_back((unsigned char) flip(tail[i]));
+        }
+    }
+
+    return best;
+}
+
+long MazeSolver::fillDeadEnds(const WallBits& walls, int start_r,
+        int start_c, int end_r, int end_c, std::vector<uint64_t>& solution) {
+    int rows = walls.numRows();
+    int words = walls.wordsPerRow();
+    numExpanded = 0;
+
+    // Padding bits count as filled so they block their neighbors
+    std::vector<uint64_t> filled((size_t)rows * words);
+    for (int r=0; r < rows; r++) {
+        for (int w=0; w < words; w++) {
+            filled[(size_t)r * words + w] = ~walls.validMask(w);
+        }
+    }
+
+    // The two ends are never filled
+    std::vector<uint64_t> keep((size_t)rows * words, 0);
+    keep[(size_t)start_r * words + start_c / 64] |= (uint64_t)1 << (start_c % 64);
+    keep[(size_t)end_r * words + end_c / 64] |= (uint64_t)1 << (end_c % 64);
+
+    // Worklist of row words that might still change, by index r*words+w
+    std::vector<long> worklist;
+    std::vector<bool> listed((size_t)rows * words, true);
+    worklist.reserve((size_t)rows * words);
+    for (long i=(long)rows * words - 1; i >= 0; i--) worklist.push_back(i);
+
+    while (!worklist.empty()) {
+        long i = worklist.back();
+        worklist.pop_back();
+        listed[i] = false;
+        int r = (int) (i / words), w = (int) (i % words);
+
+        uint64_t right = walls.rightRow(r)[w];
+        uint64_t prevRight = w > 0 ? walls.rightRow(r)[w-1] : ~(uint64_t)0;
+        uint64_t up = r > 0 ? (walls.downRow(r-1)[w] | filled[i - words]) : ~(uint64_t)0;
+        uint64_t down = walls.downRow(r)[w] | (r < rows-1 ? filled[i + words] : ~(uint64_t)0);
+        uint64_t prevFilled = w > 0 ? filled[i-1] : ~(uint64_t)0;
+        uint64_t nextFilled = w < words-1 ? filled[i+1] : ~(uint64_t)0;
+        uint64_t here = filled[i];
+        uint64_t before = here;
+
+        // Fill the word until it stops changing; corridors along the row
+        // fill one node per round
+        while (true) {
+            ++numExpanded;
+            // A side is blocked by a wall or by a filled neighbor
+            uint64_t a = right | (here >> 1) | (nextFilled << 63);
+            uint64_t b = (right << 1) | (prevRight >> 63) | (here << 1) | (prevFilled >> 63);
+
+            uint64_t threeBlocked = (a & b & (up | down)) | (up & down & (a | b));
+            uint64_t fill = threeBlocked & ~here & ~keep[i];
+            if (!fill) break;
+            here |= fill;
+        }
+
+        if (here == before) continue;
+        filled[i] = here;
+
+        // Only the neighbors next to newly filled nodes can change
+        uint64_t changed = here ^ before;
+        long neighbors[4] = { -1, -1, -1, -1 };
+        if (w > 0 && (changed & 1)) neighbors[0] = i - 1;
+        if (w < words-1 && (changed >> 63)) neighbors[1] = i + 1;
+        if (r > 0) neighbors[2] = i - words;
+        if (r < rows-1) neighbors[3] = i + words;
+        for (int k=0; k < 4; k++) {
+            if (neighbors[k] >= 0 && !listed[neighbors[k]]) {
+                listed[neighbors[k]] = true;
+                worklist.push_back(neighbors[k]);
+            }
+        }
+    }
+
+    long count = 0;
+    solution.resize((size_t)rows * words);
+    for (size_t i=0; i < solution.size(); i++) {
+        solution[i] = ~filled[i];
+        count += __builtin_popcountll(solution[i]);
+    }
+    return count;
+}
+
+#endif /* MAZESOLVER_CPP_ */
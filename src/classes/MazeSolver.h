@@ -0,0 +1,318 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeSolver.h
+ * @brief Contains the declaration of the MazeSolver class.
+ */
+
+#ifndef MAZESOLVER_H_
+#define MAZESOLVER_H_
+
+#include <vector>
+#include <stdint.h>
+#include "constants.h"
+#include "WallBits.h"
+#include "JunctionGraph.h"
+
+/**
+ * @brief Finds paths through a maze's WallBits.
+ *
+ * A solver owns its workspace (a visited bitset, a 2-bit parent direction per
+ * node and a flat queue) and reuses it from one query to the next, so after
+ * the first query on a maze no more memory is allocated. The maze is only
+ * read, so several solvers can work on the same maze at once.
+ *
+ * Paths are returned as the list of directions (RIGHT, UP, LEFT, DOWN) to
+ * take from the start node, one byte per step.
+ */
+class MazeSolver {
+
+public:
+    MazeSolver();
+
+    /**
+     * @brief Find a shortest path from a starting to ending node with a
+     * breadth-first search.
+     *
+     * @param walls the maze
+     * @param start_r the row of the starting node
+     * @param start_c the column of the starting node
+     * @param end_r the row of the ending node
+     * @param end_c the column of the ending node
+     * @param path filled with the directions to take from the start
+     * @return length of the path, or -1 if there isn't one
+     */
+    int solve(const WallBits& walls, int start_r, int start_c,
+            int end_r, int end_c, std::vector<unsigned char>& path);
+
+    /**
+     * @brief Find a path from a starting to ending node by searching from
+     * both ends at once.
+     *
+     * Each round expands one whole level of whichever frontier is smaller,
+     * and the search stops at the first node where the two searches meet.
+     * In a perfect maze that gives the only path; in a maze with loops the
+     * path found may be a little longer than the shortest one.
+     *
+     * @param walls the maze
+     * @param start_r the row of the starting node
+     * @param start_c the column of the starting node
+     * @param end_r the row of the ending node
+     * @param end_c the column of the ending node
+     * @param path filled with the directions to take from the start
+     * @return length of the path, or -1 if there isn't one
+     */
+    int solveBidirectional(const WallBits& walls, int start_r, int start_c,
+            int end_r, int end_c, std::vector<unsigned char>& path);
+
+    /**
+     * @brief Find a shortest path from a starting to ending node with A*
+     * and a Manhattan distance heuristic.
+     *
+     * The open list is a bucket queue indexed by f-score instead of a heap.
+     * Every step changes the Manhattan distance to the end by exactly one,
+     * so a node's children have the same f-score as it or two more, and only
+     * a small ring of buckets is ever in use. Within a bucket the most
+     * recently pushed node (the deepest one) comes out first.
+     *
+     * Unlike solve() and solveBidirectional(), this is worth using on mazes
+     * with loops: on a perfect maze the heuristic can only steer the search
+     * down dead ends that point at the goal.
+     *
+     * @param walls the maze
+     * @param start_r the row of the starting node
+     * @param start_c the column of the starting node
+     * @param end_r the row of the ending node
+     * @param end_c the column of the ending node
+     * @param path filled with the directions to take from the start
+     * @return length of the path, or -1 if there isn't one
+     */
+    int solveAStar(const WallBits& walls, int start_r, int start_c,
+            int end_r, int end_c, std::vector<unsigned char>& path);
+
+    /**
+     * @brief Find a shortest path from a starting to ending node with A*
+     * over a JunctionGraph.
+     *
+     * A start or end in the middle of a corridor is joined to the vertices
+     * at both ends of the corridor, and a start and end on the same corridor
+     * also get the direct route along it. The search only visits vertices,
+     * with the Manhattan distance to the end as its heuristic (no corridor
+     * is shorter than that), and the corridors are only walked step by step
+     * to write out the path at the end.
+     *
+     * The open list is a bucket queue like solveAStar()'s. Following an edge
+     * of weight w raises the f-score by at most 2w, so a ring of a little
+     * more than twice the longest edge's buckets is enough.
+     *
+     * @param graph the junction graph of the maze
+     * @param start_r the row of the starting node
+     * @param start_c the column of the starting node
+     * @param end_r the row of the ending node
+     * @param end_c the column of the ending node
+     * @param path filled with the directions to take from the start
+     * @return length of the path, or -1 if there isn't one
+     */
+    int solveJunctions(const JunctionGraph& graph, int start_r, int start_c,
+            int end_r, int end_c, std::vector<unsigned char>& path);
+
+    /**
+     * @brief Mark the solution between two nodes by filling in dead ends.
+     *
+     * Any node other than the two ends with three of its sides blocked (by a
+     * wall or a filled neighbor) is filled, until nothing changes. The
+     * filling works on whole 64-node words of a row at once from a worklist
+     * of row words: a word is filled over and over until it stops changing,
+     * and then the words around it that could be affected go back on the
+     * worklist.
+     *
+     * On a perfect maze the nodes left unfilled are exactly the path between
+     * the two ends. On a maze with loops they also include every loop that
+     * the path could take.
+     *
+     * @param walls the maze
+     * @param start_r the row of the starting node
+     * @param start_c the column of the starting node
+     * @param end_r the row of the ending node
+     * @param end_c the column of the ending node
+     * @param solution filled with one bit per unfilled node, in the same
+     * layout as the rows of walls
+     * @return the number of unfilled nodes
+     */
+    long fillDeadEnds(const WallBits& walls, int start_r, int start_c,
+            int end_r, int end_c, std::vector<uint64_t>& solution);
+
+    /**
+     * @brief Find the node farthest from a given node with a breadth-first
+     * search
+     *
+     * Running this twice (from anywhere, then from the node it finds) gives
+     * the diameter of a perfect maze.
+     *
+     * @param walls the maze
+     * @param r row of the node to start from
+     * @param c column of the node to start from
+     * @param far_r set to the row of the farthest node
+     * @param far_c set to the column of the farthest node
+     * @return the distance to the farthest node
+     */
+    int farthestFrom(const WallBits& walls, int r, int c, int& far_r, int& far_c);
+
+    /**
+     * @brief get the number of nodes the last query took off its queue
+     *
+     * @return nodes expanded
+     */
+    long expanded() const { return numExpanded; }
+
+private:
+
+    /**
+     * @brief Size the workspace for a maze and clear the visited bits
+     *
+     * @param walls the maze
+     */
+    void prepare(const WallBits& walls);
+
+    /**
+     * @brief Tell whether a node has been visited
+     *
+     * @param i index of the node (row * columns + column)
+     * @return true if visited
+     */
+    bool isVisited(long i) const { return (visited[i >> 6] >> (i & 63)) & 1; }
+
+    /**
+     * @brief Mark a node as visited
+     *
+     * @param i index of the node
+     */
+    void markVisited(long i) { visited[i >> 6] |= (uint64_t)1 << (i & 63); }
+
+    /**
+     * @brief Get the direction a node was reached from
+     *
+     * @param i index of the node
+     * @return the direction taken to get to the node from its parent
+     */
+    int parentDir(long i) const { return (parents[i >> 2] >> ((i & 3) * 2)) & 3; }
+
+    /**
+     * @brief Record the direction a node was reached from
+     *
+     * @param i index of the node
+     * @param dir the direction taken to get to the node from its parent
+     */
+    void setParentDir(long i, int dir) {
+        int shift = (i & 3) * 2;
+        parents[i >> 2] = (uint8_t) ((parents[i >> 2] & ~(3 << shift)) | (dir << shift));
+    }
+
+    /**
+     * @brief Walk the parent directions back from a node to the start and
+     * write out the path
+     *
+     * @param walls the maze
+     * @param start index of the starting node
+     * @param end index of the ending node
+     * @param path filled with the directions from start to end
+     */
+    void tracePath(const WallBits& walls, long start, long end,
+            std::vector<unsigned char>& path) const;
+
+    /**
+     * @brief Visited bitset, one bit per node
+     */
+    std::vector<uint64_t> visited;
+
+    /**
+     * @brief Which search reached each node, one bit per node (set for the
+     * search from the end). Only used by solveBidirectional().
+     */
+    std::vector<uint64_t> side;
+
+    /**
+     * @brief Nodes that have been given a g-score, one bit per node. Only
+     * used by solveAStar(), which uses visited for its closed set.
+     */
+    std::vector<uint64_t> opened;
+
+    /**
+     * @brief Best known distance from the start of each opened node. Only
+     * used by solveAStar().
+     */
+    std::vector<int> gScore;
+
+    /**
+     * @brief Edge each vertex was reached by, or -1-k for the k-th place
+     * the search started from. Only used by solveJunctions().
+     */
+    std::vector<long> parentEdges;
+
+    /**
+     * @brief Ring of buckets of vertices, indexed by f-score modulo the ring
+     * size. Only used by solveJunctions().
+     */
+    std::vector<std::vector<long> > vertexBuckets;
+
+    /**
+     * @brief Ring of buckets of node indices, indexed by f-score modulo
+     * the ring size. Only used by solveAStar().
+     */
+    std::vector<long> buckets[4];
+
+    /**
+     * @brief Parent direction of each node, 2 bits per node
+     */
+    std::vector<uint8_t> parents;
+
+    /**
+     * @brief Queue of node indices
+     *
+     * solveBidirectional() runs the search from the start off the front and
+     * the search from the end off the back; together they never hold more
+     * than one entry per node.
+     */
+    std::vector<long> queue;
+
+    /**
+     * @brief Nodes expanded by the last query
+     */
+    long numExpanded;
+};
+
+/**
+ * @brief Step from a node index in a direction
+ *
+ * @param i index of the node (row * cols + column)
+ * @param dir the direction (RIGHT, UP, LEFT, DOWN)
+ * @param cols number of columns in the maze
+ * @return index of the neighboring node
+ */
+inline long stepIndex(long i, int dir, int cols) {
+    switch (dir) {
+    case RIGHT: return i + 1;
+    case UP:    return i - cols;
+    case LEFT:  return i - 1;
+    default:    return i + cols;
+    }
+}
+
+#endif /* MAZESOLVER_H_ */
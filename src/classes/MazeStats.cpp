@@ -0,0 +1,231 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeStats.cpp
+ * @brief Contains the methods of the MazeStats class.
+ */
+
+#ifndef MAZESTATS_CPP_
+#define MAZESTATS_CPP_
+
+#include <mutex>
+#include "MazeStats.h"
+#include "MazeSolver.h"
+#include "ParallelBands.h"
+
+MazeStats::MazeStats() {
+    rows = 0;
+    cols = 0;
+    deadEnds = 0;
+    straights = 0;
+    turns = 0;
+    threeWayJunctions = 0;
+    fourWayJunctions = 0;
+    solutionLength = -1;
+    diameter = 0;
+}
+
+/*
+ * Follow a corridor from a node through nodes with two openings (the bits
+ * set in middle), setting their bits in seen, and return the number of steps
+ * to its other end, or back to the node it started from if it's a ring.
+ */
+static int walkCorridor(const WallBits& walls, const std::vector<uint64_t>& middle,
+        std::vector<uint64_t>& seen, int r, int c, int dir) {
+    int words = walls.wordsPerRow();
+    int start_r = r, start_c = c;
+    int length = 0;
+    while (true) {
+        switch (dir) {
+        case RIGHT: c++; break;
+        case UP:    r--; break;
+        case LEFT:  c--; break;
+        case DOWN:  r++; break;
+        }
+        length++;
+        size_t word = (size_t)r * words + c / 64;
+        uint64_t bit = (uint64_t)1 << (c % 64);
+        if (!(middle[word] & bit) || (r == start_r && c == start_c)) return length;
+        // Corridors walked on other threads can share the word
+        if (!(seen[word] & bit)) __atomic_fetch_or(&seen[word], bit, __ATOMIC_RELAXED);
+
+        int back = flip(dir);
+        for (int next=RIGHT; next <= DOWN; next++) {
+            if (next != back && !walls.wall(r, c, next)) {
+                dir = next;
+                break;
+            }
+        }
+    }
+}
+
+void MazeStats::compute(const WallBits& walls) {
+    rows = walls.numRows();
+    cols = walls.numCols();
+    deadEnds = 0;
+    straights = 0;
+    turns = 0;
+    threeWayJunctions = 0;
+    fourWayJunctions = 0;
+    corridorLengths.clear();
+    solutionLength = -1;
+    diameter = 0;
+    if (rows == 0 || cols == 0) return;
+
+    int words = walls.wordsPerRow();
+    std::mutex lock;
+
+    // Nodes with exactly two openings, one bit per node, for the second pass,
+    // and those of them the corridor walks have passed
+    std::vector<uint64_t> middle((size_t)rows * words);
+    std::vector<uint64_t> seen((size_t)rows * words, 0);
+
+    // Count the nodes by their openings, 64 nodes at a time
+    forEachRowBand(rows, [&](int first, int last) {
+        long ones = 0, straight = 0, turn = 0, threes = 0, fours = 0;
+
+        for (int r=first; r < last; r++) {
+            const uint64_t *rightWalls = walls.rightRow(r);
+            const uint64_t *downWalls = walls.downRow(r);
+            const uint64_t *upWalls = r > 0 ? walls.downRow(r-1) : NULL;
+
+            for (int w=0; w < words; w++) {
+                uint64_t valid = walls.validMask(w);
+                uint64_t a = ~rightWalls[w] & valid;
+                uint64_t b = ~((rightWalls[w] << 1) | (w > 0 ? rightWalls[w-1] >> 63 : 1)) & valid;
+                uint64_t c = upWalls ? ~upWalls[w] & valid : 0;
+                uint64_t d = ~downWalls[w] & valid;
+
+                // Add up the four open bits of each node into s2 s1 s0
+                uint64_t x1 = a ^ b, c1 = a & b;
+                uint64_t x2 = c ^ d, c2 = c & d;
+                uint64_t s0 = x1 ^ x2;
+                uint64_t s1 = c1 ^ c2 ^ (x1 & x2);
+                uint64_t s2 = c1 & c2;
+
+                uint64_t two = ~s0 & s1 & ~s2;
+                middle[(size_t)r * words + w] = two;
+                uint64_t across = two & (c1 | c2);
+                ones += __builtin_popcountll(s0 & ~s1);
+                straight += __builtin_popcountll(across);
+                turn += __builtin_popcountll(two & ~across);
+                threes += __builtin_popcountll(s0 & s1);
+                fours += __builtin_popcountll(s2);
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        deadEnds += ones;
+        straights += straight;
+        turns += turn;
+        threeWayJunctions += threes;
+        fourWayJunctions += fours;
+    });
+
+    // Walk every corridor out of every node that isn't in the middle of one.
+    // Each corridor gets walked once from each end, loops from a node back to
+    // itself included, so the counts are halved at the end.
+    forEachRowBand(rows, [&](int first, int last) {
+        std::map<int, long> lengths;
+
+        for (int r=first; r < last; r++) {
+            for (int w=0; w < words; w++) {
+                uint64_t ends = ~middle[(size_t)r * words + w] & walls.validMask(w);
+                while (ends) {
+                    int c = w * 64 + __builtin_ctzll(ends);
+                    ends &= ends - 1;
+
+                    for (int dir=RIGHT; dir <= DOWN; dir++) {
+                        if (!walls.wall(r, c, dir)) {
+                            lengths[walkCorridor(walls, middle, seen, r, c, dir)]++;
+                        }
+                    }
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        for (std::map<int, long>::iterator it = lengths.begin(); it != lengths.end(); ++it) {
+            corridorLengths[it->first] += it->second;
+        }
+    });
+    for (std::map<int, long>::iterator it = corridorLengths.begin(); it != corridorLengths.end(); ++it) {
+        it->second /= 2;
+    }
+
+    // Nodes with two openings that no walk reached are on rings without
+    // ends; walk each ring once, from the first of its nodes found
+    for (int r=0; r < rows; r++) {
+        for (int w=0; w < words; w++) {
+            size_t word = (size_t)r * words + w;
+            while (uint64_t left = middle[word] & ~seen[word]) {
+                int c = w * 64 + __builtin_ctzll(left);
+                seen[word] |= left & -left;
+                int dir = RIGHT;
+                while (walls.wall(r, c, dir)) dir++;
+                corridorLengths[walkCorridor(walls, middle, seen, r, c, dir)]++;
+            }
+        }
+    }
+
+    MazeSolver solver;
+    std::vector<unsigned char> path;
+    solutionLength = solver.solve(walls, 0, 0, rows-1, cols-1, path);
+
+    int far_r, far_c;
+    solver.farthestFrom(walls, 0, 0, far_r, far_c);
+    diameter = solver.farthestFrom(walls, far_r, far_c, far_r, far_c);
+}
+
+void MazeStats::writeJson(std::ostream& out) const {
+    long cells = (long) rows * cols;
+    long corridors = 0, corridorSteps = 0;
+    int longest = 0;
+    for (std::map<int, long>::const_iterator it = corridorLengths.begin(); it != corridorLengths.end(); ++it) {
+        corridors += it->second;
+        corridorSteps += (long) it->first * it->second;
+        longest = it->first;
+    }
+    long twoWay = straights + turns;
+
+    out << "{";
+    out << "\"rows\": " << rows << ", \"cols\": " << cols << ", ";
+    out << "\"cells\": " << cells << ", ";
+    out << "\"dead_ends\": " << deadEnds << ", ";
+    out << "\"dead_end_density\": " << (cells ? (double) deadEnds / cells : 0) << ", ";
+    out << "\"three_way_junctions\": " << threeWayJunctions << ", ";
+    out << "\"four_way_junctions\": " << fourWayJunctions << ", ";
+    out << "\"straights\": " << straights << ", \"turns\": " << turns << ", ";
+    out << "\"straightness\": " << (twoWay ? (double) straights / twoWay : 0) << ", ";
+    out << "\"corridors\": " << corridors << ", ";
+    out << "\"mean_corridor_length\": " << (corridors ? (double) corridorSteps / corridors : 0) << ", ";
+    out << "\"longest_corridor\": " << longest << ", ";
+    out << "\"corridor_lengths\": {";
+    for (std::map<int, long>::const_iterator it = corridorLengths.begin(); it != corridorLengths.end(); ++it) {
+        if (it != corridorLengths.begin()) out << ", ";
+        out << "\"" << it->first << "\": " << it->second;
+    }
+    out << "}, ";
+    out << "\"solution_length\": " << solutionLength << ", ";
+    out << "\"diameter\": " << diameter;
+    out << "}" << std::endl;
+}
+
+#endif /* MAZESTATS_CPP_ */
@@ -0,0 +1,124 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeStats.h
+ * @brief Contains the declaration of the MazeStats class.
+ */
+
+#ifndef MAZESTATS_H_
+#define MAZESTATS_H_
+
+#include <iostream>
+#include <map>
+#include "WallBits.h"
+
+/**
+ * @brief Statistics used to grade a maze.
+ *
+ * compute() makes two passes over the wall bitmap, each split into bands of
+ * rows that run in parallel. The first counts the nodes by their number of
+ * openings, 64 at a time. The second walks every corridor (chain of nodes
+ * with exactly two openings) from both of its ends, marking the nodes it
+ * passes; any unmarked ones left are on rings with no ends, which are walked
+ * once each on their own. After that, one search
+ * finds the solution length and two more find the diameter.
+ */
+class MazeStats {
+
+public:
+    MazeStats();
+
+    /**
+     * @brief Compute the statistics of a maze
+     *
+     * @param walls the maze
+     */
+    void compute(const WallBits& walls);
+
+    /**
+     * @brief Write the statistics as a JSON object
+     *
+     * @param out the stream to write to
+     */
+    void writeJson(std::ostream& out) const;
+
+    /**
+     * @brief Number of rows
+     */
+    int rows;
+
+    /**
+     * @brief Number of columns
+     */
+    int cols;
+
+    /**
+     * @brief Nodes with one opening
+     */
+    long deadEnds;
+
+    /**
+     * @brief Nodes with two openings across from each other
+     */
+    long straights;
+
+    /**
+     * @brief Nodes with two openings at right angles
+     */
+    long turns;
+
+    /**
+     * @brief Nodes with three openings
+     */
+    long threeWayJunctions;
+
+    /**
+     * @brief Nodes with four openings
+     */
+    long fourWayJunctions;
+
+    /**
+     * @brief Number of corridors of each length
+     *
+     * A corridor runs between two nodes that don't have exactly two
+     * openings (dead ends and junctions), and its length is the number of
+     * steps along it. A ring made only of nodes with two openings (like an
+     * open 2x2 block) has no ends; it counts as one corridor as long as the
+     * number of nodes in it.
+     */
+    std::map<int, long> corridorLengths;
+
+    /**
+     * @brief Length of the path from the entrance (0,0) to the exit
+     * (rows-1, cols-1), or -1 if there isn't one
+     */
+    int solutionLength;
+
+    /**
+     * @brief Length of the longest shortest path in the maze
+     *
+     * Found with a search from the entrance and a second search from the
+     * farthest node found by the first. That is exact for perfect mazes and
+     * a lower bound for mazes with loops.
+     */
+    int diameter;
+};
+
+#endif /* MAZESTATS_H_ */
@@ -0,0 +1,486 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeTextReader.cpp
+ * @brief Contains the methods of the MazeTextReader class.
+ */
+
+#ifndef MAZETEXTREADER_CPP_
+#define MAZETEXTREADER_CPP_
+
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "MazeTextReader.h"
+#include "ParallelBands.h"
+
+/*
+ * Rows are decoded in chunks of about this much text
+ */
+static const size_t BLOCKBYTES = 1 << 20;
+
+/*
+ * Load eight characters as a word, character k in byte k (counting from the
+ * low end) whatever the byte order of the machine
+ */
+static inline uint64_t load8(const char *p) {
+    uint64_t x;
+    memcpy(&x, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+    return x;
+}
+
+/*
+ * Pack the low bits of the bytes of a word (each 0 or 1) into bits 0-7
+ */
+static inline unsigned packBytes(uint64_t ones) {
+    return (unsigned) ((ones * 0x0102040810204080ULL) >> 56);
+}
+
+static const uint64_t LOWBITS = 0x0101010101010101ULL;
+
+/*
+ * Words of eight characters, and a table turning the packed wall bits of
+ * four nodes of a small row ("_" then "|" for each) into their right walls
+ * (bits 0-3) and down walls (bits 4-7), as MazeRenderer's tables index them
+ */
+struct TextTables {
+    uint64_t spaces, smallWalls, bigWalls, bigMarks, bars, sameAsNext, marks;
+    unsigned char split[256];
+
+    TextTables() {
+        spaces = load8("        ");
+        smallWalls = load8("_|_|_|_|");
+        bigWalls = load8("___|___|");
+        bigMarks = load8(" *   *  ");
+        bars = load8("\0\0\0\xff\0\0\0\xff");
+        sameAsNext = load8("\1\1\0\0\1\1\0\0");
+        marks = load8("\0\1\0\0\0\1\0\0");
+        for (int i=0; i < 256; i++) {
+            unsigned right = 0, down = 0;
+            for (int k=0; k < 4; k++) {
+                down |= ((i >> (2*k)) & 1) << k;
+                right |= ((i >> (2*k+1)) & 1) << k;
+            }
+            split[i] = (unsigned char) (right | down << 4);
+        }
+    }
+};
+
+static const TextTables& textTables() {
+    static const TextTables tables;
+    return tables;
+}
+
+/*
+ * Check one node of a row drawn small, and get its walls
+ */
+static inline bool smallNode(const char *p, bool& right, bool& down) {
+    down = p[0] == '_';
+    right = p[1] == '|';
+    return (down || p[0] == ' ') && (right || p[1] == ' ');
+}
+
+/*
+ * Check one node of a row drawn big, from the top and bottom lines of the
+ * row, and get its walls
+ */
+static inline bool bigNode(const char *top, const char *bottom, bool& right, bool& down) {
+    down = bottom[0] == '_';
+    right = bottom[3] == '|';
+    char wall = down ? '_' : ' ', bar = right ? '|' : ' ';
+    return (down || bottom[0] == ' ') && bottom[1] == wall && bottom[2] == wall &&
+            (right || bottom[3] == ' ') && top[0] == ' ' &&
+            (top[1] == ' ' || top[1] == '*') && top[2] == ' ' && top[3] == bar;
+}
+
+bool MazeTextReader::isText(const std::string& path) {
+    std::string::size_type dot = path.rfind('.');
+    if (dot == std::string::npos) return false;
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == "txt";
+}
+
+MazeTextReader::MazeTextReader() {
+    big = false;
+    perfect = false;
+}
+
+bool MazeTextReader::load(const std::string& path, WallBits& walls) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "can't open the file";
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        error = "there's no maze in the file";
+        return false;
+    }
+    size_t length = (size_t) info.st_size;
+    void *base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        error = "can't map the file";
+        return false;
+    }
+    bool ok = parse((const char *) base, length, walls);
+    munmap(base, length);
+    return ok;
+}
+
+bool MazeTextReader::parse(const char *text, size_t length, WallBits& walls) {
+    const char *end = text + length;
+
+    // The maze starts at the first line beginning with a wall
+    const char *top = NULL, *body = text;
+    long line = 1;
+    while (body < end && *body != '|') {
+        const char *newline = (const char *) memchr(body, '\n', end - body);
+        if (!newline) break;
+        top = body;
+        body = newline + 1;
+        line++;
+    }
+    if (body >= end || *body != '|' || !top) {
+        error = "there's no maze in the file";
+        return false;
+    }
+
+    // Every line of the maze is as long as the first, and the top line is
+    // one shorter, so the lines are a fixed stride apart
+    const char *newline = (const char *) memchr(body, '\n', end - body);
+    size_t stride = (newline ? newline - body : end - body) + 1;
+    size_t lineLength = stride - 1;
+    if (lineLength > 1 && body[lineLength-1] == '\r') lineLength--;
+    size_t topLength = body - top - (stride - lineLength);
+    big = lineLength % 4 == 1 && topLength >= 4 && top[3] == ' ';
+    size_t nodeWidth = big ? 4 : 2;
+    if (lineLength < 1 + nodeWidth || (lineLength - 1) % nodeWidth != 0 ||
+            topLength != lineLength - 1 || (lineLength - 1) / nodeWidth > 0x7fffffff) {
+        error = "line " + std::to_string(line) + " isn't the first row of a maze";
+        return false;
+    }
+    int cols = (int) ((lineLength - 1) / nodeWidth);
+    std::string expectedTop(big ? "    " : "  ");
+    for (int c=1; c < cols; c++) expectedTop += big ? " ___" : " _";
+    if (memcmp(top, expectedTop.data(), topLength) != 0) {
+        error = "line " + std::to_string(line - 1) + " isn't the top of a maze";
+        return false;
+    }
+
+    // Count the lines of the maze, checking their lengths
+    long lines = 0;
+    for (const char *p=body; p < end && *p == '|'; ) {
+        newline = (const char *) memchr(p, '\n', end - p);
+        size_t bytes = newline ? newline - p + 1 : end - p;
+        if (newline ? bytes != stride : bytes < lineLength || bytes > stride - 1) {
+            error = "line " + std::to_string(line + lines) +
+                    " isn't as long as the rest of the maze";
+            return false;
+        }
+        lines++;
+        p += bytes;
+    }
+    if (big && lines % 2 != 0) {
+        error = "the last row of the maze is cut short";
+        return false;
+    }
+    if (lines / (big ? 2 : 1) > 0x7fffffff) {
+        error = "the maze has too many rows";
+        return false;
+    }
+    int rows = (int) (lines / (big ? 2 : 1));
+    size_t rowStride = big ? 2 * stride : stride;
+
+    // Decode the rows in parallel, keeping the first bad one
+    WallBits decoded(rows, cols);
+    int threads = numWorkerThreads();
+    std::vector<uint64_t> passages(threads, 0);
+    std::vector<int> firstBad(threads, rows);
+    long chunk = std::max(1L, (long) (BLOCKBYTES / rowStride));
+    forEachChunk(rows, chunk, [&](int thread, long first, long last) {
+        if (firstBad[thread] < rows) return;
+        int bad = decodeRows(body, rowStride, (int) first, (int) last, decoded, passages[thread]);
+        if (bad < last) firstBad[thread] = bad;
+    });
+    int bad = *std::min_element(firstBad.begin(), firstBad.end());
+    if (bad < rows) {
+        error = "line " + std::to_string(line + (long) bad * (big ? 2 : 1)) +
+                " isn't a row of a maze";
+        return false;
+    }
+
+    // A perfect maze is a tree: one fewer passages than nodes, and no loops
+    uint64_t total = 0;
+    for (int t=0; t < threads; t++) total += passages[t];
+    perfect = total == (uint64_t) rows * cols - 1 && !hasLoop(decoded);
+    walls = std::move(decoded);
+    error.clear();
+    return true;
+}
+
+int MazeTextReader::decodeRows(const char *body, size_t stride, int first, int last,
+        WallBits& walls, uint64_t& open) const {
+    const TextTables& tables = textTables();
+    int rows = walls.numRows(), cols = walls.numCols();
+    int words = walls.wordsPerRow();
+    size_t half = stride / 2;
+
+    for (int r=first; r < last; r++) {
+        const char *line = body + (size_t) r * stride;
+        uint64_t *right = walls.rightRow(r);
+        uint64_t *down = walls.downRow(r);
+        std::fill(right, right + words, 0);
+        std::fill(down, down + words, 0);
+        bool ok = true;
+        int c = 0;
+
+        if (!big) {
+            // Four nodes to a word: bit 6 of "_" and "|" is set, that of " "
+            // isn't, and the word has to be just those characters
+            const char *p = line + 1;
+            for (; c + 4 <= cols; c += 4, p += 8) {
+                uint64_t x = load8(p);
+                uint64_t wall = (x >> 6) & LOWBITS;
+                ok &= x == (tables.spaces ^ ((wall * 0xff) & (tables.smallWalls ^ tables.spaces)));
+                unsigned nodes = tables.split[packBytes(wall)];
+                right[c / 64] |= (uint64_t) (nodes & 15) << (c % 64);
+                down[c / 64] |= (uint64_t) (nodes >> 4) << (c % 64);
+            }
+            for (; c < cols; c++, p += 2) {
+                bool isRight, isDown;
+                ok &= smallNode(p, isRight, isDown);
+                right[c / 64] |= (uint64_t) isRight << (c % 64);
+                down[c / 64] |= (uint64_t) isDown << (c % 64);
+            }
+        } else {
+            // Two nodes to a word, from the bottom line of the row; the top
+            // line has to have the same right walls, and spaces or solution
+            // marks in between
+            const char *p = line + 1, *q = line + half + 1;
+            ok &= line[half] == '|';
+            for (; c + 2 <= cols; c += 2, p += 8, q += 8) {
+                uint64_t x = load8(q), y = load8(p);
+                uint64_t wall = (x >> 6) & LOWBITS;
+                uint64_t full = wall * 0xff;
+                ok &= x == (tables.spaces ^ (full & (tables.bigWalls ^ tables.spaces)));
+                ok &= (((wall >> 8) ^ wall) & tables.sameAsNext) == 0;
+                uint64_t marks = y ^ tables.spaces;
+                ok &= (((marks >> 1) ^ (marks >> 3)) & tables.marks) == 0;
+                ok &= (y | (tables.marks * 0x0a)) ==
+                        (tables.bigMarks ^ (full & tables.bars & (tables.bigWalls ^ tables.spaces)));
+                unsigned packed = packBytes(wall);
+                right[c / 64] |= (uint64_t) ((packed >> 3 & 1) | (packed >> 6 & 2)) << (c % 64);
+                down[c / 64] |= (uint64_t) ((packed & 1) | (packed >> 3 & 2)) << (c % 64);
+            }
+            for (; c < cols; c++, p += 4, q += 4) {
+                bool isRight, isDown;
+                ok &= bigNode(p, q, isRight, isDown);
+                right[c / 64] |= (uint64_t) isRight << (c % 64);
+                down[c / 64] |= (uint64_t) isDown << (c % 64);
+            }
+        }
+
+        // The boundary has to be walled, but for the exit
+        uint64_t lastBit = (uint64_t) 1 << ((cols-1) % 64);
+        ok &= (right[words-1] & lastBit) != 0;
+        if (r == rows-1) {
+            for (int w=0; w < words; w++) {
+                uint64_t wanted = walls.validMask(w) & (w == words-1 ? ~lastBit : ~(uint64_t) 0);
+                ok &= down[w] == wanted;
+            }
+            down[words-1] |= lastBit;
+        }
+        if (!ok) return r;
+
+        for (int w=0; w < words; w++) {
+            open += __builtin_popcountll(~right[w] & walls.validMask(w));
+            open += __builtin_popcountll(~down[w] & walls.validMask(w));
+            right[w] |= ~walls.validMask(w);
+            down[w] |= ~walls.validMask(w);
+        }
+    }
+    return last;
+}
+
+/*
+ * Find the set of a node, halving the path as it goes
+ */
+static inline int findSet(std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+/*
+ * Number the runs of nodes joined across a row (each ends at a right wall),
+ * setting first[w] to the number of runs before word w; returns how many
+ * runs there are
+ */
+static int numberRuns(const WallBits& walls, int r, std::vector<int>& first) {
+    int runs = 0;
+    for (int w=0; w < walls.wordsPerRow(); w++) {
+        first[w] = runs;
+        runs += __builtin_popcountll(walls.rightRow(r)[w] & walls.validMask(w));
+    }
+    return runs;
+}
+
+/*
+ * The run of a node, given the runs before its word
+ */
+static inline int runOf(const uint64_t *right, const std::vector<int>& first, int w, int b) {
+    return first[w] + __builtin_popcountll(right[w] & (((uint64_t) 1 << b) - 1));
+}
+
+/*
+ * What a band of rows leaves for joining it to the others: the sets of the
+ * band (numbered 0..sets-1) that the runs of its top and bottom rows are in
+ */
+struct LoopBand {
+    int first, last;
+    std::vector<int> top, bottom;
+    int sets;
+    bool loop;
+};
+
+/*
+ * Follow the sets of joined nodes down a band of rows. A passage down joins
+ * a set of the row above to a run of the row below (the nodes of a run are
+ * joined without loops), and one between a set and a run already joined
+ * makes a loop.
+ */
+static void followBand(const WallBits& walls, LoopBand& band) {
+    int cols = walls.numCols(), words = walls.wordsPerRow();
+    band.loop = false;
+
+    // Sets of the row above are labelled 0..aboveRuns-1, and each label is
+    // in a set of the band, kept in a second union-find
+    std::vector<int> parent(2 * cols), label(2 * cols), stamp(2 * cols, -1);
+    std::vector<int> above(cols), below(cols), aboveSet(cols), belowSet(cols);
+    std::vector<int> aboveFirst(words), belowFirst(words), sets;
+    int aboveRuns = numberRuns(walls, band.first, aboveFirst);
+    for (int k=0; k < aboveRuns; k++) {
+        above[k] = k;
+        aboveSet[k] = k;
+        sets.push_back(k);
+    }
+
+    for (int r=band.first + 1; r < band.last; r++) {
+        int runs = numberRuns(walls, r, belowFirst);
+        for (int i=0; i < aboveRuns + runs; i++) parent[i] = i;
+        const uint64_t *aboveRight = walls.rightRow(r-1), *right = walls.rightRow(r);
+        for (int w=0; w < words; w++) {
+            for (uint64_t open = ~walls.downRow(r-1)[w]; open; open &= open - 1) {
+                int b = __builtin_ctzll(open);
+                int a = findSet(parent, above[runOf(aboveRight, aboveFirst, w, b)]);
+                int c = findSet(parent, aboveRuns + runOf(right, belowFirst, w, b));
+                if (a == c) {
+                    band.loop = true;
+                    return;
+                }
+                parent[c] = a;
+                if (c < aboveRuns) sets[findSet(sets, aboveSet[c])] = findSet(sets, aboveSet[a]);
+            }
+        }
+
+        // Label the sets of this row's runs for the next row; a run joined
+        // to nothing above starts a new set of the band
+        int labels = 0;
+        for (int k=0; k < runs; k++) {
+            int root = findSet(parent, aboveRuns + k);
+            if (stamp[root] != r) {
+                stamp[root] = r;
+                label[root] = labels;
+                if (root < aboveRuns) {
+                    belowSet[labels] = aboveSet[root];
+                } else {
+                    belowSet[labels] = (int) sets.size();
+                    sets.push_back((int) sets.size());
+                }
+                labels++;
+            }
+            below[k] = label[root];
+        }
+        above.swap(below);
+        aboveSet.swap(belowSet);
+        aboveFirst.swap(belowFirst);
+        aboveRuns = runs;
+    }
+
+    band.top.resize(numberRuns(walls, band.first, belowFirst));
+    for (size_t k=0; k < band.top.size(); k++) band.top[k] = findSet(sets, (int) k);
+    band.bottom.resize(aboveRuns);
+    for (int k=0; k < aboveRuns; k++) band.bottom[k] = findSet(sets, aboveSet[above[k]]);
+    band.sets = (int) sets.size();
+}
+
+bool MazeTextReader::hasLoop(const WallBits& walls) {
+    int rows = walls.numRows(), words = walls.wordsPerRow();
+
+    // Follow the sets down bands of rows on one thread per core, then join
+    // the bands through the passages down between them
+    int bandRows = std::max(64, (rows + numWorkerThreads() - 1) / numWorkerThreads());
+    std::vector<LoopBand> bands((rows + bandRows - 1) / bandRows);
+    forEachChunk((long) bands.size(), 1, [&](int, long i, long) {
+        bands[i].first = (int) i * bandRows;
+        bands[i].last = std::min(rows, bands[i].first + bandRows);
+        followBand(walls, bands[i]);
+    });
+
+    std::vector<int> sets, aboveFirst(words), belowFirst(words);
+    int offset = 0;
+    for (size_t i=0; i < bands.size(); i++) {
+        if (bands[i].loop) return true;
+        for (int k=0; k < bands[i].sets; k++) sets.push_back(offset + k);
+        if (i > 0) {
+            int r = bands[i].first;
+            int aboveOffset = offset - bands[i-1].sets;
+            numberRuns(walls, r-1, aboveFirst);
+            numberRuns(walls, r, belowFirst);
+            for (int w=0; w < words; w++) {
+                for (uint64_t open = ~walls.downRow(r-1)[w]; open; open &= open - 1) {
+                    int b = __builtin_ctzll(open);
+                    int a = findSet(sets, aboveOffset +
+                            bands[i-1].bottom[runOf(walls.rightRow(r-1), aboveFirst, w, b)]);
+                    int c = findSet(sets, offset +
+                            bands[i].top[runOf(walls.rightRow(r), belowFirst, w, b)]);
+                    if (a == c) return true;
+                    sets[c] = a;
+                }
+            }
+        }
+        offset += bands[i].sets;
+    }
+    return false;
+}
+
+#endif /* MAZETEXTREADER_CPP_ */
@@ -0,0 +1,123 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeTextReader.h
+ * @brief Contains the declaration of the MazeTextReader class.
+ */
+
+#ifndef MAZETEXTREADER_H_
+#define MAZETEXTREADER_H_
+
+#include <string>
+#include <stdint.h>
+#include "WallBits.h"
+
+/**
+ * @brief Reads a maze back from the text drawn by Maze2d::draw() or
+ * drawBig() in the ASCII style.
+ *
+ * The maze starts at the first line beginning with "|", and the line above
+ * it is the top of the maze; lines before (like the debugging output in the
+ * files made by "make examples") and after are skipped. The length of the
+ * first row's line gives the number of columns, and the top line tells
+ * whether the maze was drawn big. Solution marks ("*") are ignored.
+ *
+ * The text is mapped into memory and the line ends are found with memchr(),
+ * which checks that every line of the maze is as long as the first. The
+ * rows are then decoded on one thread per core, eight characters at a time:
+ * bit 6 of each character tells a wall ("_" or "|") from a space, so
+ * checking the characters and packing them into wall bits takes a few
+ * operations on a 64-bit word, and a table splits the packed bits into
+ * right and down walls, the opposite of the tables MazeRenderer draws with.
+ *
+ * Whether the maze is perfect is worked out from the walls afterwards: it
+ * has to have one fewer passages than nodes, counted while decoding, and no
+ * loops, found by following the sets of joined nodes down bands of rows on
+ * one thread per core and then joining the bands.
+ */
+class MazeTextReader {
+
+public:
+    /**
+     * @brief Tell whether a file name is that of a text maze
+     *
+     * @param path name of the file
+     * @return true if it ends in .txt, in any case
+     */
+    static bool isText(const std::string& path);
+
+    MazeTextReader();
+
+    /**
+     * @brief Read a maze from a text file
+     *
+     * @param path name of the file
+     * @param walls set to the maze
+     * @return true if success; otherwise error says why
+     */
+    bool load(const std::string& path, WallBits& walls);
+
+    /**
+     * @brief Read a maze from text in memory
+     *
+     * @param text the text
+     * @param length number of bytes of text
+     * @param walls set to the maze
+     * @return true if success; otherwise error says why
+     */
+    bool parse(const char *text, size_t length, WallBits& walls);
+
+    /**
+     * @brief Whether the last maze read was drawn big
+     */
+    bool big;
+
+    /**
+     * @brief Whether the last maze read is perfect (has no loops, and every
+     * node can be reached)
+     */
+    bool perfect;
+
+    /**
+     * @brief Why the last load() or parse() failed
+     */
+    std::string error;
+
+private:
+
+    /**
+     * @brief Decode the rows first..last-1 of the maze
+     *
+     * @param body the first character of the first row
+     * @param stride bytes from one row to the next
+     * @param walls rows are written to this
+     * @param open incremented by the number of walls that are down
+     * @return the first row that is malformed, or last if none is
+     */
+    int decodeRows(const char *body, size_t stride, int first, int last,
+            WallBits& walls, uint64_t& open) const;
+
+    /**
+     * @brief Tell whether a maze has a loop
+     */
+    static bool hasLoop(const WallBits& walls);
+};
+
+#endif /* MAZETEXTREADER_H_ */
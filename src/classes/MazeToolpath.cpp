@@ -0,0 +1,382 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeToolpath.cpp
+ * @brief Contains the methods of the MazeToolpath class.
+ */
+
+#ifndef MAZETOOLPATH_CPP_
+#define MAZETOOLPATH_CPP_
+
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include "MazeToolpath.h"
+#include "MazeVector.h"
+#include "ParallelBands.h"
+
+/*
+ * Rows of corners in a band
+ */
+static const int BANDROWS = 32;
+
+/*
+ * Corners along the side of a bucket of the nearest-stroke grid
+ */
+static const int BUCKETSIZE = 8;
+
+/*
+ * Longest stretch of strokes 2-opt tries reversing, and most passes it makes
+ */
+static const int TWOOPTWINDOW = 64;
+static const int TWOOPTPASSES = 3;
+
+/*
+ * Cutting feed (mm/min) and power for G-code, and HPGL units per mm
+ */
+static const int FEEDRATE = 1000;
+static const int POWER = 1000;
+static const int HPGLPERMM = 40;
+
+/*
+ * Walls at a corner: bit 0 up, bit 1 right, bit 2 down, bit 3 left (as in
+ * MazeRenderer), and the way each one goes
+ */
+static const int STEPX[4] = {0, 1, 0, -1};
+static const int STEPY[4] = {-1, 0, 1, 0};
+
+static inline double distance(int x0, int y0, int x1, int y1) {
+    double dx = x1 - x0, dy = y1 - y0;
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+bool MazeToolpath::formatOf(const std::string& path, Format& f) {
+    std::string::size_type dot = path.rfind('.');
+    if (dot == std::string::npos) return false;
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == "dxf") f = DXF;
+    else if (extension == "nc" || extension == "ngc" || extension == "gcode") f = GCODE;
+    else if (extension == "plt" || extension == "hpgl") f = HPGL;
+    else return false;
+    return true;
+}
+
+MazeToolpath::MazeToolpath(double mm) {
+    cellMm = mm > 0 ? mm : 5;
+    rows = cols = 0;
+    cut = travel = unorderedTravel = 0;
+}
+
+size_t MazeToolpath::numStrokes() const {
+    return order.size();
+}
+
+double MazeToolpath::cutLength() const {
+    return cut * cellMm;
+}
+
+double MazeToolpath::travelLength() const {
+    return travel * cellMm;
+}
+
+double MazeToolpath::unorderedTravelLength() const {
+    return unorderedTravel * cellMm;
+}
+
+MazeToolpath::Corner MazeToolpath::strokeStart(int s) const {
+    return reversed[s] ? corners[firstCorner[s+1] - 1] : corners[firstCorner[s]];
+}
+
+MazeToolpath::Corner MazeToolpath::strokeEnd(int s) const {
+    return reversed[s] ? corners[firstCorner[s]] : corners[firstCorner[s+1] - 1];
+}
+
+void MazeToolpath::buildStrokes(const WallBits& walls) {
+    int width = cols + 1;
+    corners.clear();
+    firstCorner.assign(1, 0);
+    cut = 0;
+
+    // The walls left to cut at each corner
+    std::vector<unsigned char> left((size_t) (rows + 1) * width, 0);
+    MazeVector::forEachRun(walls, [&](bool horizontal, int x, int y, int length) {
+        for (int k=0; k < length; k++) {
+            if (horizontal) {
+                left[(size_t) y * width + x + k] |= 2;
+                left[(size_t) y * width + x + k + 1] |= 8;
+            } else {
+                left[(size_t) (y + k) * width + x] |= 4;
+                left[(size_t) (y + k + 1) * width + x] |= 1;
+            }
+        }
+        cut += length;
+    });
+
+    // Follow walls from (x, y) until there are none left, going straight
+    // on where possible, and keep the corners where the stroke turns
+    auto walk = [&](int x, int y) {
+        corners.push_back(Corner{x, y});
+        int direction = -1;
+        size_t v = (size_t) y * width + x;
+        while (left[v]) {
+            int k = direction >= 0 && ((left[v] >> direction) & 1) ? direction
+                    : __builtin_ctz(left[v]);
+            if (direction >= 0 && k != direction) corners.push_back(Corner{x, y});
+            left[v] &= ~(1 << k);
+            x += STEPX[k];
+            y += STEPY[k];
+            v = (size_t) y * width + x;
+            left[v] &= ~(1 << ((k + 2) % 4));
+            direction = k;
+        }
+        corners.push_back(Corner{x, y});
+        firstCorner.push_back(corners.size());
+    };
+
+    // A walk from a corner with an odd number of walls ends at another one,
+    // so starting from those first leaves only closed loops
+    for (size_t v=0; v < left.size(); v++) {
+        while (__builtin_popcount(left[v]) & 1) walk((int) (v % width), (int) (v / width));
+    }
+    for (size_t v=0; v < left.size(); v++) {
+        while (left[v]) walk((int) (v % width), (int) (v / width));
+    }
+}
+
+void MazeToolpath::orderBand(const std::vector<int>& strokes, Corner entry,
+        std::vector<char>& done, std::vector<int>& tour) {
+    tour.clear();
+    if (strokes.empty()) return;
+
+    // Buckets of strokes by the corners they can start from
+    int minX = entry.x, maxX = entry.x, minY = entry.y, maxY = entry.y;
+    for (size_t i=0; i < strokes.size(); i++) {
+        int s = strokes[i];
+        const Corner& a = corners[firstCorner[s]];
+        const Corner& b = corners[firstCorner[s+1] - 1];
+        minX = std::min(minX, std::min(a.x, b.x));
+        maxX = std::max(maxX, std::max(a.x, b.x));
+        minY = std::min(minY, std::min(a.y, b.y));
+        maxY = std::max(maxY, std::max(a.y, b.y));
+    }
+    int gridW = (maxX - minX) / BUCKETSIZE + 1, gridH = (maxY - minY) / BUCKETSIZE + 1;
+    std::vector<std::vector<int> > buckets((size_t) gridW * gridH);
+    for (size_t i=0; i < strokes.size(); i++) {
+        int s = strokes[i];
+        const Corner& a = corners[firstCorner[s]];
+        const Corner& b = corners[firstCorner[s+1] - 1];
+        size_t ka = (size_t) ((a.y - minY) / BUCKETSIZE) * gridW + (a.x - minX) / BUCKETSIZE;
+        size_t kb = (size_t) ((b.y - minY) / BUCKETSIZE) * gridW + (b.x - minX) / BUCKETSIZE;
+        buckets[ka].push_back(s);
+        if (kb != ka) buckets[kb].push_back(s);
+    }
+
+    // Go to the nearest end of a stroke not yet cut, looking in rings of
+    // buckets around the tool until no closer one can be left
+    Corner at = entry;
+    for (size_t n=0; n < strokes.size(); n++) {
+        int cx = (at.x - minX) / BUCKETSIZE, cy = (at.y - minY) / BUCKETSIZE;
+        int best = -1;
+        bool bestReversed = false;
+        double bestDistance = 0;
+        for (int ring=0; ring <= std::max(gridW, gridH); ring++) {
+            for (int by=cy-ring; by <= cy+ring; by++) {
+                if (by < 0 || by >= gridH) continue;
+                int step = (by == cy-ring || by == cy+ring) ? 1 : 2 * ring;
+                for (int bx=cx-ring; bx <= cx+ring; bx += step > 0 ? step : 1) {
+                    if (bx < 0 || bx >= gridW) continue;
+                    std::vector<int>& bucket = buckets[(size_t) by * gridW + bx];
+                    for (size_t i=0; i < bucket.size(); i++) {
+                        int s = bucket[i];
+                        if (done[s]) {
+                            bucket[i--] = bucket.back();
+                            bucket.pop_back();
+                            continue;
+                        }
+                        const Corner& a = corners[firstCorner[s]];
+                        const Corner& b = corners[firstCorner[s+1] - 1];
+                        double da = distance(at.x, at.y, a.x, a.y);
+                        double db = distance(at.x, at.y, b.x, b.y);
+                        if (best < 0 || std::min(da, db) < bestDistance) {
+                            best = s;
+                            bestReversed = db < da;
+                            bestDistance = std::min(da, db);
+                        }
+                    }
+                }
+            }
+            // Anything in the next ring is at least this far away
+            if (best >= 0 && bestDistance <= (double) ring * BUCKETSIZE) break;
+        }
+        done[best] = 1;
+        reversed[best] = bestReversed;
+        tour.push_back(best);
+        at = strokeEnd(best);
+    }
+
+    improve(tour, entry);
+}
+
+void MazeToolpath::improve(std::vector<int>& tour, Corner entry) {
+    int n = (int) tour.size();
+    if (n < 2) return;
+
+    // The ends of the strokes in order, and the travel after each one
+    std::vector<Corner> head(n), tail(n);
+    std::vector<double> link(n, 0);
+    for (int k=0; k < n; k++) {
+        head[k] = strokeStart(tour[k]);
+        tail[k] = strokeEnd(tour[k]);
+    }
+    auto relink = [&](int k) {
+        if (k >= 0 && k+1 < n) link[k] = distance(tail[k].x, tail[k].y, head[k+1].x, head[k+1].y);
+    };
+    for (int k=0; k < n; k++) relink(k);
+
+    for (int pass=0; pass < TWOOPTPASSES; pass++) {
+        bool better = false;
+        for (int i=-1; i < n-1; i++) {
+            // Reversing strokes i+1..j, and each of their directions, joins
+            // the end of stroke i to the end of stroke j, and the start of
+            // stroke i+1 to the start of stroke j+1
+            Corner from = i < 0 ? entry : tail[i];
+            double before = i < 0 ? distance(from.x, from.y, head[0].x, head[0].y) : link[i];
+            for (int j=i+1; j < n && j <= i + TWOOPTWINDOW; j++) {
+                double now = distance(from.x, from.y, tail[j].x, tail[j].y);
+                if (j+1 < n) now += distance(head[i+1].x, head[i+1].y, head[j+1].x, head[j+1].y);
+                if (now >= before + link[j] - 1e-9) continue;
+
+                std::reverse(tour.begin() + i + 1, tour.begin() + j + 1);
+                std::reverse(head.begin() + i + 1, head.begin() + j + 1);
+                std::reverse(tail.begin() + i + 1, tail.begin() + j + 1);
+                for (int k=i+1; k <= j; k++) {
+                    reversed[tour[k]] ^= 1;
+                    std::swap(head[k], tail[k]);
+                }
+                for (int k=i; k <= j; k++) relink(k);
+                before = i < 0 ? distance(from.x, from.y, head[0].x, head[0].y) : link[i];
+                better = true;
+            }
+        }
+        if (!better) break;
+    }
+}
+
+double MazeToolpath::travelThrough(const std::vector<int>& tour,
+        const std::vector<char>& directions) const {
+    double length = 0;
+    Corner at = Corner{0, rows};
+    for (size_t i=0; i < tour.size(); i++) {
+        int s = tour[i];
+        const Corner& a = corners[directions[s] ? firstCorner[s+1] - 1 : firstCorner[s]];
+        const Corner& b = corners[directions[s] ? firstCorner[s] : firstCorner[s+1] - 1];
+        length += distance(at.x, at.y, a.x, a.y);
+        at = b;
+    }
+    return length;
+}
+
+void MazeToolpath::plan(const WallBits& walls) {
+    rows = walls.numRows();
+    cols = walls.numCols();
+    order.clear();
+    reversed.clear();
+    cut = travel = unorderedTravel = 0;
+    if (rows < 1 || cols < 1) return;
+
+    buildStrokes(walls);
+    int strokes = (int) firstCorner.size() - 1;
+    reversed.assign(strokes, 0);
+    order.resize(strokes);
+    for (int s=0; s < strokes; s++) order[s] = s;
+    unorderedTravel = travelThrough(order, reversed);
+
+    // Bands from the bottom up, each holding the strokes that start in it
+    int bands = rows / BANDROWS + 1;
+    std::vector<std::vector<int> > members(bands), tours(bands);
+    std::vector<char> done(strokes, 0);
+    for (int s=0; s < strokes; s++) {
+        members[(rows - corners[firstCorner[s]].y) / BANDROWS].push_back(s);
+    }
+    forEachChunk(bands, 1, [&](int, long first, long last) {
+        for (long b=first; b < last; b++) {
+            Corner entry = Corner{b % 2 == 0 ? 0 : cols, std::max(0, rows - (int) b * BANDROWS)};
+            orderBand(members[b], entry, done, tours[b]);
+        }
+    });
+
+    order.clear();
+    for (int b=0; b < bands; b++) order.insert(order.end(), tours[b].begin(), tours[b].end());
+    travel = travelThrough(order, reversed);
+}
+
+bool MazeToolpath::save(const std::string& path, Format f) {
+    FILE *out = fopen(path.c_str(), "w");
+    if (!out) {
+        error = "can't open the file for writing";
+        return false;
+    }
+
+    if (f == GCODE) {
+        fprintf(out, "(mazecut: %lu strokes, %.1f mm cutting, %.1f mm travel)\n",
+                (unsigned long) numStrokes(), cutLength(), travelLength());
+        fprintf(out, "G21\nG90\nM5\n");
+    } else if (f == HPGL) {
+        fprintf(out, "IN;SP1;\n");
+    } else {
+        fprintf(out, "0\nSECTION\n2\nENTITIES\n");
+    }
+
+    for (size_t i=0; i < order.size(); i++) {
+        int s = order[i];
+        size_t count = firstCorner[s+1] - firstCorner[s];
+        for (size_t k=0; k < count; k++) {
+            const Corner& c = corners[reversed[s] ? firstCorner[s+1] - 1 - k : firstCorner[s] + k];
+            double x = c.x * cellMm, y = (rows - c.y) * cellMm;
+            if (f == GCODE) {
+                if (k == 0) fprintf(out, "G0 X%.3f Y%.3f\nM3 S%d\n", x, y, POWER);
+                else if (k == 1) fprintf(out, "G1 X%.3f Y%.3f F%d\n", x, y, FEEDRATE);
+                else fprintf(out, "G1 X%.3f Y%.3f\n", x, y);
+            } else if (f == HPGL) {
+                long px = std::lround(x * HPGLPERMM), py = std::lround(y * HPGLPERMM);
+                if (k == 0) fprintf(out, "PU%ld,%ld;PD", px, py);
+                else fprintf(out, "%s%ld,%ld", k > 1 ? "," : "", px, py);
+            } else {
+                if (k == 0) fprintf(out, "0\nPOLYLINE\n8\nWALLS\n66\n1\n10\n0.0\n20\n0.0\n30\n0.0\n");
+                fprintf(out, "0\nVERTEX\n8\nWALLS\n10\n%.3f\n20\n%.3f\n30\n0.0\n", x, y);
+            }
+        }
+        if (f == GCODE) fprintf(out, "M5\n");
+        else if (f == HPGL) fprintf(out, ";\n");
+        else fprintf(out, "0\nSEQEND\n8\nWALLS\n");
+    }
+
+    if (f == GCODE) fprintf(out, "G0 X0 Y0\nM2\n");
+    else if (f == HPGL) fprintf(out, "PU0,0;SP0;\n");
+    else fprintf(out, "0\nENDSEC\n0\nEOF\n");
+
+    bool ok = !ferror(out);
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) error = "can't write the file";
+    return ok;
+}
+
+#endif /* MAZETOOLPATH_CPP_ */
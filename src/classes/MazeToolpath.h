@@ -0,0 +1,205 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeToolpath.h
+ * @brief Contains the declaration of the MazeToolpath class.
+ */
+
+#ifndef MAZETOOLPATH_H_
+#define MAZETOOLPATH_H_
+
+#include <string>
+#include <vector>
+#include "WallBits.h"
+
+/**
+ * @brief Plans the cuts for making a maze on a laser cutter or plotter, and
+ * writes them as DXF, G-code or HPGL.
+ *
+ * The walls are cut in strokes: the tool goes down, follows walls from
+ * corner to corner without lifting, and comes back up. plan() makes strokes
+ * as long as it can by walking the graph of walls (the corners between
+ * nodes, joined by the walls between them) from corners where an odd number
+ * of walls meet, since every stroke but closed loops has to start and end at
+ * one of those, and by going straight on through a corner when it can, so
+ * a stroke turns as little as possible. Runs of walls in a line are one
+ * move.
+ *
+ * The strokes are then put in an order, and each given a direction, that
+ * keeps the travel between them short. The maze is split into bands of rows
+ * which are cut bottom to top, each band going the opposite way across from
+ * the one before. In each band (on one thread per core), the strokes are
+ * put in order by going to the nearest end of a stroke not yet cut, found in
+ * a grid of buckets, and the order is then improved with 2-opt: reversing a
+ * stretch of the order whenever that shortens the travel, trying stretches
+ * of up to 64 strokes.
+ *
+ * Lengths are in millimetres, with the bottom left corner of the maze at
+ * the origin, which is where the tool starts.
+ */
+class MazeToolpath {
+
+public:
+    /**
+     * @brief Toolpath formats
+     */
+    enum Format {DXF, GCODE, HPGL};
+
+    /**
+     * @brief Work out the format of a toolpath from the end of its file name
+     *
+     * @param path name of the file (.dxf; .nc, .ngc or .gcode; .plt or
+     * .hpgl; in any case)
+     * @param format set to the format
+     * @return false if the name isn't that of a toolpath
+     */
+    static bool formatOf(const std::string& path, Format& format);
+
+    /**
+     * @brief Create a toolpath planner
+     *
+     * @param cellMm millimetres along the side of a node
+     */
+    MazeToolpath(double cellMm = 5);
+
+    /**
+     * @brief Plan the strokes for cutting a maze and their order
+     *
+     * @param walls the maze
+     */
+    void plan(const WallBits& walls);
+
+    /**
+     * @brief Write the planned toolpath to a file
+     *
+     * @param path name of the file
+     * @param f the format
+     * @return true if success; otherwise error says why
+     */
+    bool save(const std::string& path, Format f);
+
+    /**
+     * @brief Number of strokes planned
+     */
+    size_t numStrokes() const;
+
+    /**
+     * @brief Length of the cuts, in millimetres
+     */
+    double cutLength() const;
+
+    /**
+     * @brief Length of the travel between cuts, in millimetres
+     */
+    double travelLength() const;
+
+    /**
+     * @brief Length the travel would be if the strokes were cut in the
+     * order they were found, in millimetres
+     */
+    double unorderedTravelLength() const;
+
+    /**
+     * @brief Why the last save() failed
+     */
+    std::string error;
+
+private:
+
+    /**
+     * @brief A corner between nodes: column x and row y of the corners
+     */
+    struct Corner {
+        int x, y;
+    };
+
+    /**
+     * @brief Find the strokes
+     */
+    void buildStrokes(const WallBits& walls);
+
+    /**
+     * @brief Order the strokes of one band, starting from entry, and give
+     * them their directions
+     *
+     * @param strokes the strokes of the band
+     * @param entry where the tool comes into the band
+     * @param done whether each stroke is in an order yet (only those of the
+     * band are looked at or set)
+     * @param tour set to the strokes in order
+     */
+    void orderBand(const std::vector<int>& strokes, Corner entry,
+            std::vector<char>& done, std::vector<int>& tour);
+
+    /**
+     * @brief Improve an order of strokes with 2-opt
+     */
+    void improve(std::vector<int>& tour, Corner entry);
+
+    /**
+     * @brief Where a stroke starts or ends, taking its direction into account
+     */
+    Corner strokeStart(int s) const;
+    Corner strokeEnd(int s) const;
+
+    /**
+     * @brief Travel through strokes in order from the origin, in nodes
+     */
+    double travelThrough(const std::vector<int>& tour, const std::vector<char>& reversed) const;
+
+    /**
+     * @brief Millimetres along the side of a node
+     */
+    double cellMm;
+
+    /**
+     * @brief Rows and columns of the maze
+     */
+    int rows, cols;
+
+    /**
+     * @brief The corners of the strokes, one stroke after another, with
+     * only the ends of each straight line in a stroke
+     */
+    std::vector<Corner> corners;
+
+    /**
+     * @brief Where each stroke starts in corners (and where the next one
+     * does, for the last)
+     */
+    std::vector<size_t> firstCorner;
+
+    /**
+     * @brief The strokes in the order they are cut
+     */
+    std::vector<int> order;
+
+    /**
+     * @brief Whether each stroke is cut from its last corner to its first
+     */
+    std::vector<char> reversed;
+
+    /**
+     * @brief Lengths, in nodes
+     */
+    double cut, travel, unorderedTravel;
+};
+
+#endif /* MAZETOOLPATH_H_ */
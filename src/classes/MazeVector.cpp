@@ -0,0 +1,377 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeVector.cpp
+ * @brief Contains the methods of the MazeVector class.
+ */
+
+#ifndef MAZEVECTOR_CPP_
+#define MAZEVECTOR_CPP_
+
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <zlib.h>
+#include "MazeVector.h"
+
+/*
+ * Text is written out in blocks of about this many bytes
+ */
+static const size_t BLOCKBYTES = 1 << 20;
+
+/*
+ * Width of the lines, in nodes
+ */
+static const char LINEWIDTH[] = "0.1";
+
+/*
+ * Find the first bit at or after from that is set (or clear, if !set) in the
+ * first n bits of a row of words; n if there is none
+ */
+static inline int nextBit(const uint64_t *bits, int from, int n, bool set) {
+    int w = from / 64;
+    uint64_t word = set ? bits[w] : ~bits[w];
+    word &= ~(uint64_t)0 << (from % 64);
+    while (!word) {
+        if (++w * 64 >= n) return n;
+        word = set ? bits[w] : ~bits[w];
+    }
+    return std::min(n, w * 64 + __builtin_ctzll(word));
+}
+
+/*
+ * Call run(start, end) for each run of set bits in the first n bits of a row
+ * of words
+ */
+template <class F>
+static void forEachSetRun(const uint64_t *bits, int n, F run) {
+    int c = nextBit(bits, 0, n, true);
+    while (c < n) {
+        int end = nextBit(bits, c, n, false);
+        run(c, end);
+        if (end >= n) break;
+        c = nextBit(bits, end, n, true);
+    }
+}
+
+/*
+ * Buffered text going to a file, deflated on the way if asked
+ */
+class DrawingSink {
+public:
+    DrawingSink(FILE *f, bool deflated) : out(f), zipped(deflated), ok(true), bytesOut(0) {
+        memset(&stream, 0, sizeof(stream));
+        // The fastest level: drawings are mostly digits, and the default level
+        // takes about four times as long for a fifth less
+        if (zipped) deflateInit(&stream, Z_BEST_SPEED);
+        text.reserve(BLOCKBYTES + 64);
+    }
+
+    ~DrawingSink() {
+        if (zipped) deflateEnd(&stream);
+    }
+
+    void put(const char *s, size_t n) {
+        text.append(s, n);
+        if (text.size() >= BLOCKBYTES) flush(false);
+    }
+
+    void put(const char *s) {
+        put(s, strlen(s));
+    }
+
+    void put(int value) {
+        char digits[12];
+        char *p = digits + sizeof(digits);
+        unsigned magnitude = value < 0 ? 0u - (unsigned) value : (unsigned) value;
+        do {
+            *--p = (char) ('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude);
+        if (value < 0) *--p = '-';
+        put(p, digits + sizeof(digits) - p);
+    }
+
+    /*
+     * Write out what's buffered; if last, end the deflated stream
+     */
+    void flush(bool last) {
+        if (!zipped) {
+            if (ok && !text.empty()) ok = fwrite(text.data(), 1, text.size(), out) == text.size();
+            bytesOut += text.size();
+            text.clear();
+            return;
+        }
+        unsigned char block[1 << 16];
+        stream.next_in = (Bytef *) text.data();
+        stream.avail_in = (uInt) text.size();
+        int status;
+        do {
+            stream.next_out = block;
+            stream.avail_out = sizeof(block);
+            status = deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+            size_t n = sizeof(block) - stream.avail_out;
+            if (ok && n > 0) ok = fwrite(block, 1, n, out) == n;
+            bytesOut += n;
+        } while (stream.avail_out == 0 || (last && status != Z_STREAM_END && status != Z_STREAM_ERROR));
+        text.clear();
+    }
+
+    FILE *out;
+    bool zipped;
+    bool ok;
+
+    /*
+     * Bytes written to the file so far
+     */
+    size_t bytesOut;
+
+    /*
+     * Where the next byte put will be in the file (only if not deflated)
+     */
+    size_t position() const {
+        return bytesOut + text.size();
+    }
+
+private:
+    std::string text;
+    z_stream stream;
+};
+
+bool MazeVector::formatOf(const std::string& path, Format& f) {
+    std::string::size_type dot = path.rfind('.');
+    if (dot == std::string::npos) return false;
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == "svg") f = SVG;
+    else if (extension == "pdf") f = PDF;
+    else return false;
+    return true;
+}
+
+MazeVector::MazeVector(Format f, int px) {
+    format = f;
+    cellPx = px < 1 ? 1 : px;
+}
+
+void MazeVector::forEachRun(const WallBits& walls,
+        const std::function<void(bool, int, int, int)>& run) {
+    int rows = walls.numRows(), cols = walls.numCols();
+    int words = walls.wordsPerRow();
+
+    // The corner lines: bit j of lines is whether the wall on the left of
+    // column j (the right of column j-1) is up in the row being looked at
+    int lineWords = cols / 64 + 1;
+    std::vector<uint64_t> lines(lineWords, 0), previous(lineWords, 0);
+    std::vector<int> start(cols + 1, 0);
+    uint64_t lastMask = ~(uint64_t)0 >> (63 - cols % 64);
+
+    // The top and bottom walls, with the entrance and exit open
+    std::vector<uint64_t> top(words, ~(uint64_t)0), bottom(walls.downRow(rows-1),
+            walls.downRow(rows-1) + words);
+    top[0] &= ~(uint64_t)1;
+    bottom[(cols-1) / 64] &= ~((uint64_t)1 << ((cols-1) % 64));
+
+    for (int r=0; r <= rows; r++) {
+        // Horizontal runs along the top of row r
+        const uint64_t *across = r == 0 ? &top[0] : r == rows ? &bottom[0] : walls.downRow(r-1);
+        forEachSetRun(across, cols, [&](int first, int end) {
+            run(true, first, r, end - first);
+        });
+
+        // Vertical runs start where a wall goes up in row r and end where one
+        // comes down, which is only where the lines differ from the row above
+        if (r < rows) {
+            const uint64_t *right = walls.rightRow(r);
+            for (int w=0; w < lineWords; w++) {
+                uint64_t below = w < words ? right[w] << 1 : 0;
+                lines[w] = below | (w == 0 ? 1 : right[w-1] >> 63);
+            }
+            lines[lineWords-1] &= lastMask;
+        } else {
+            std::fill(lines.begin(), lines.end(), 0);
+        }
+        for (int w=0; w < lineWords; w++) {
+            uint64_t changed = lines[w] ^ previous[w];
+            while (changed) {
+                int bit = __builtin_ctzll(changed);
+                changed &= changed - 1;
+                int j = w * 64 + bit;
+                if ((lines[w] >> bit) & 1) start[j] = r;
+                else run(false, j, start[j], r - start[j]);
+            }
+        }
+        lines.swap(previous);
+    }
+}
+
+/*
+ * Writes runs as SVG path data, each a relative move from the end of the
+ * last one and a relative line
+ */
+class SvgPath {
+public:
+    SvgPath(DrawingSink& s) : sink(s), x(0), y(0), first(true) {}
+
+    void add(bool horizontal, int x0, int y0, int length) {
+        sink.put(first ? "M" : "m", 1);
+        sink.put(first ? x0 : x0 - x);
+        sink.put(" ", 1);
+        sink.put(first ? y0 : y0 - y);
+        sink.put(horizontal ? "h" : "v", 1);
+        sink.put(length);
+        x = horizontal ? x0 + length : x0;
+        y = horizontal ? y0 : y0 + length;
+        first = false;
+    }
+
+private:
+    DrawingSink& sink;
+    int x, y;
+    bool first;
+};
+
+bool MazeVector::saveSvg(FILE *out, const WallBits& walls) {
+    int rows = walls.numRows(), cols = walls.numCols();
+
+    // The vertical runs go in a scratch file until the horizontal path is done
+    FILE *scratch = tmpfile();
+    if (!scratch) {
+        error = "can't create a scratch file";
+        return false;
+    }
+
+    DrawingSink sink(out, false), verticalSink(scratch, false);
+    sink.put("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    sink.put("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"");
+    sink.put((cols + 1) * cellPx);
+    sink.put("\" height=\"");
+    sink.put((rows + 1) * cellPx);
+    sink.put("\" viewBox=\"-0.5 -0.5 ");
+    sink.put(cols + 1);
+    sink.put(" ");
+    sink.put(rows + 1);
+    sink.put("\">\n<rect x=\"-0.5\" y=\"-0.5\" width=\"100%\" height=\"100%\" fill=\"white\"/>\n");
+    sink.put("<g fill=\"none\" stroke=\"black\" stroke-width=\"");
+    sink.put(LINEWIDTH);
+    sink.put("\" stroke-linecap=\"square\">\n<path d=\"");
+
+    SvgPath horizontal(sink), vertical(verticalSink);
+    forEachRun(walls, [&](bool across, int x, int y, int length) {
+        if (across) horizontal.add(true, x, y, length);
+        else vertical.add(false, x, y, length);
+    });
+    verticalSink.flush(false);
+
+    sink.put("\"/>\n<path d=\"");
+    sink.flush(false);
+    bool ok = sink.ok && verticalSink.ok && fflush(scratch) == 0;
+    rewind(scratch);
+    char block[1 << 16];
+    size_t n;
+    while (ok && (n = fread(block, 1, sizeof(block), scratch)) > 0) {
+        ok = fwrite(block, 1, n, out) == n;
+    }
+    fclose(scratch);
+    sink.put("\"/>\n</g>\n</svg>\n");
+    sink.flush(false);
+    return ok && sink.ok;
+}
+
+bool MazeVector::savePdf(FILE *out, const WallBits& walls) {
+    int rows = walls.numRows(), cols = walls.numCols();
+    long width = (long) (cols + 1) * cellPx, height = (long) (rows + 1) * cellPx;
+    std::vector<size_t> offsets;
+    DrawingSink sink(out, false);
+
+    // Every object but the content's length, which is only known once the
+    // content is written
+    sink.put("%PDF-1.4\n");
+    offsets.push_back(sink.position());
+    sink.put("1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+    offsets.push_back(sink.position());
+    sink.put("2 0 obj\n<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n");
+    offsets.push_back(sink.position());
+    char text[256];
+    snprintf(text, sizeof(text), "3 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 %ld %ld]"
+            " /Resources << >> /Contents 4 0 R >>\nendobj\n", width, height);
+    sink.put(text);
+    offsets.push_back(sink.position());
+    sink.put("4 0 obj\n<< /Length 5 0 R /Filter /FlateDecode >>\nstream\n");
+    sink.flush(false);
+
+    // The content: scale nodes to cellPx points, with y going down from the
+    // top left corner, and stroke all the runs as one path
+    DrawingSink content(out, true);
+    snprintf(text, sizeof(text), "%d 0 0 %d %g %g cm\n%s w 2 J\n",
+            cellPx, -cellPx, cellPx / 2.0, height - cellPx / 2.0, LINEWIDTH);
+    content.put(text);
+    forEachRun(walls, [&](bool horizontal, int x, int y, int length) {
+        content.put(x);
+        content.put(" ", 1);
+        content.put(y);
+        content.put(" m ", 3);
+        content.put(horizontal ? x + length : x);
+        content.put(" ", 1);
+        content.put(horizontal ? y : y + length);
+        content.put(" l\n", 3);
+    });
+    content.put("S\n");
+    content.flush(true);
+    size_t streamLength = content.bytesOut;
+
+    sink.bytesOut += streamLength;
+    sink.put("\nendstream\nendobj\n");
+    offsets.push_back(sink.position());
+    snprintf(text, sizeof(text), "5 0 obj\n%lu\nendobj\n", (unsigned long) streamLength);
+    sink.put(text);
+
+    long xref = (long) sink.position();
+    sink.put("xref\n0 6\n0000000000 65535 f \n");
+    for (size_t k=0; k < offsets.size(); k++) {
+        snprintf(text, sizeof(text), "%010lu 00000 n \n", (unsigned long) offsets[k]);
+        sink.put(text);
+    }
+    snprintf(text, sizeof(text), "trailer\n<< /Size 6 /Root 1 0 R >>\nstartxref\n%ld\n%%%%EOF\n", xref);
+    sink.put(text);
+    sink.flush(false);
+    return sink.ok && content.ok;
+}
+
+bool MazeVector::save(const std::string& path, const WallBits& walls) {
+    if (walls.numRows() < 1 || walls.numCols() < 1) {
+        error = "the maze is empty";
+        return false;
+    }
+
+    FILE *out = fopen(path.c_str(), "wb");
+    if (!out) {
+        error = "can't open the file for writing";
+        return false;
+    }
+
+    error.clear();
+    bool ok = format == SVG ? saveSvg(out, walls) : savePdf(out, walls);
+    ok = (fclose(out) == 0) && ok;
+    if (!ok && error.empty()) error = "can't write the file";
+    return ok;
+}
+
+#endif /* MAZEVECTOR_CPP_ */
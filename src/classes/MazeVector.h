@@ -0,0 +1,127 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file MazeVector.h
+ * @brief Contains the declaration of the MazeVector class.
+ */
+
+#ifndef MAZEVECTOR_H_
+#define MAZEVECTOR_H_
+
+#include <cstdio>
+#include <string>
+#include <functional>
+#include "WallBits.h"
+
+/**
+ * @brief Writes a maze as an SVG or PDF drawing made of as few lines as
+ * possible.
+ *
+ * Instead of a line for every wall, each straight run of walls becomes one
+ * line. A single pass over the rows finds both kinds: the horizontal runs
+ * of a row's down walls are found a word at a time by looking for the ends
+ * of runs of set bits, and the vertical runs are kept open from row to row,
+ * starting or ending only in the columns where the right walls change from
+ * one row to the next.
+ *
+ * In an SVG the horizontal and vertical runs are each one path element,
+ * written with relative moves so most numbers are a digit or two. In a PDF
+ * they are one deflated content stream. Coordinates are in nodes, scaled to
+ * cellPx pixels (or points) per node. As in the text drawings, the entrance
+ * and exit are left open.
+ */
+class MazeVector {
+
+public:
+    /**
+     * @brief Drawing formats
+     */
+    enum Format {SVG, PDF};
+
+    /**
+     * @brief Work out the format of a drawing from the end of its file name
+     *
+     * @param path name of the file (.svg or .pdf, in any case)
+     * @param format set to the format
+     * @return false if the name isn't that of a drawing
+     */
+    static bool formatOf(const std::string& path, Format& format);
+
+    /**
+     * @brief Create a drawing writer
+     *
+     * @param f the format
+     * @param cellPx pixels (or points) along the side of a node
+     */
+    MazeVector(Format f, int cellPx = 10);
+
+    /**
+     * @brief Write a maze to a drawing file
+     *
+     * @param path name of the file
+     * @param walls the maze
+     * @return true if success; otherwise error says why
+     */
+    bool save(const std::string& path, const WallBits& walls);
+
+    /**
+     * @brief Find the straight runs of walls of a maze
+     *
+     * Horizontal runs come out in order, top to bottom and left to right.
+     * Each vertical run comes out as soon as the row it ends above is
+     * reached.
+     *
+     * @param walls the maze
+     * @param run called as run(horizontal, x, y, length) for a run starting
+     * at corner (x, y) (column x, row y of the corners between nodes) and
+     * going length nodes right or down
+     */
+    static void forEachRun(const WallBits& walls,
+            const std::function<void(bool, int, int, int)>& run);
+
+    /**
+     * @brief Why the last save() failed
+     */
+    std::string error;
+
+private:
+
+    /**
+     * @brief Write the SVG drawing
+     */
+    bool saveSvg(FILE *out, const WallBits& walls);
+
+    /**
+     * @brief Write the PDF drawing
+     */
+    bool savePdf(FILE *out, const WallBits& walls);
+
+    /**
+     * @brief The format
+     */
+    Format format;
+
+    /**
+     * @brief Pixels (or points) along the side of a node
+     */
+    int cellPx;
+};
+
+#endif /* MAZEVECTOR_H_ */
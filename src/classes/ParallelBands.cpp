@@ -0,0 +1,162 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ParallelBands.cpp
+ * @brief Contains the implementations of the functions declared in
+ * ParallelBands.h.
+ */
+
+#ifndef PARALLELBANDS_CPP_
+#define PARALLELBANDS_CPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ParallelBands.h"
+
+int numWorkerThreads() {
+    int n = (int) std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+void forEachRowBand(int rows, const std::function<void(int, int)>& body,
+        int minRowsPerBand) {
+    int bands = numWorkerThreads();
+    if (minRowsPerBand < 1) minRowsPerBand = 1;
+    if (bands > rows / minRowsPerBand) bands = rows / minRowsPerBand;
+
+    if (bands <= 1) {
+        body(0, rows);
+        return;
+    }
+
+    // The calling thread takes the first band itself
+    std::vector<std::thread> threads;
+    threads.reserve(bands - 1);
+    for (int b=1; b < bands; b++) {
+        int first = (int) ((long long) rows * b / bands);
+        int last = (int) ((long long) rows * (b+1) / bands);
+        threads.push_back(std::thread(body, first, last));
+    }
+    body(0, (int) ((long long) rows / bands));
+
+    for (unsigned int t=0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+}
+
+void forEachChunk(long count, long chunk,
+        const std::function<void(int, long, long)>& body) {
+    if (chunk < 1) chunk = 1;
+    long chunks = (count + chunk - 1) / chunk;
+    int workers = numWorkerThreads();
+    if (workers > chunks) workers = (int) chunks;
+
+    std::atomic<long> nextChunk(0);
+    std::function<void(int)> work = [&](int thread) {
+        for (long k = nextChunk++; k < chunks; k = nextChunk++) {
+            long first = k * chunk;
+            long last = first + chunk < count ? first + chunk : count;
+            body(thread, first, last);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t=1; t < workers; t++) {
+        threads.push_back(std::thread(work, t));
+    }
+    work(0);
+
+    for (unsigned int t=0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+}
+
+void forEachChunkInOrder(long count, long chunk,
+        const std::function<void(long, long, std::vector<char>&)>& format,
+        const std::function<void(const std::vector<char>&)>& write,
+        int depth) {
+    if (chunk < 1) chunk = 1;
+    long chunks = (count + chunk - 1) / chunk;
+    if (chunks <= 1) {
+        std::vector<char> bytes;
+        if (chunks == 1) {
+            format(0, count, bytes);
+            write(bytes);
+        }
+        return;
+    }
+    int workers = numWorkerThreads();
+    if (workers > chunks) workers = (int) chunks;
+    if (depth < 1) depth = 2 * workers;
+
+    /*
+     * Chunk k is formatted into slot k % depth, once chunk k - depth has
+     * been written out of it
+     */
+    std::vector<std::vector<char> > slots(depth);
+    std::vector<long> ready(depth, -1);
+    long written = 0;
+    std::mutex lock;
+    std::condition_variable changed;
+
+    std::atomic<long> nextChunk(0);
+    std::function<void()> work = [&]() {
+        for (long k = nextChunk++; k < chunks; k = nextChunk++) {
+            int slot = (int) (k % depth);
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                while (k >= written + depth) changed.wait(guard);
+            }
+            long first = k * chunk;
+            long last = first + chunk < count ? first + chunk : count;
+            format(first, last, slots[slot]);
+            std::lock_guard<std::mutex> guard(lock);
+            ready[slot] = k;
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t=0; t < workers; t++) {
+        threads.push_back(std::thread(work));
+    }
+
+    // The calling thread writes
+    for (long k=0; k < chunks; k++) {
+        int slot = (int) (k % depth);
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while (ready[slot] != k) changed.wait(guard);
+        }
+        write(slots[slot]);
+        std::lock_guard<std::mutex> guard(lock);
+        written = k + 1;
+        changed.notify_all();
+    }
+
+    for (unsigned int t=0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+}
+
+#endif /* PARALLELBANDS_CPP_ */
@@ -0,0 +1,92 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ParallelBands.h
+ * @brief Contains the declarations of the helpers for splitting work on a
+ * maze into bands of rows and running the bands on several threads.
+ */
+
+#ifndef PARALLELBANDS_H_
+#define PARALLELBANDS_H_
+
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Number of threads to use for parallel work
+ *
+ * @return the number of hardware threads, at least 1
+ */
+int numWorkerThreads();
+
+/**
+ * @brief Split rows 0..rows-1 into contiguous bands and call body on each
+ * band, one band per thread.
+ *
+ * Returns once every band is done. Mazes that are too small to be worth it
+ * are done in a single band on the calling thread.
+ *
+ * @param rows number of rows to split
+ * @param body called as body(first, last) for rows first..last-1
+ * @param minRowsPerBand don't make bands smaller than this
+ */
+void forEachRowBand(int rows, const std::function<void(int, int)>& body,
+        int minRowsPerBand = 64);
+
+/**
+ * @brief Split items 0..count-1 into chunks and hand them out to one thread
+ * per core as the threads become free.
+ *
+ * Unlike forEachRowBand(), the chunks are handed out in order but on
+ * demand, so uneven work (like path queries of different lengths) stays
+ * balanced. Returns once every chunk is done.
+ *
+ * @param count number of items
+ * @param chunk number of items in a chunk
+ * @param body called as body(thread, first, last) for items first..last-1,
+ * where thread is 0..numWorkerThreads()-1 and no two calls with the same
+ * thread number run at once
+ */
+void forEachChunk(long count, long chunk,
+        const std::function<void(int, long, long)>& body);
+
+/**
+ * @brief Split items 0..count-1 into chunks, turn each chunk into bytes on
+ * worker threads, and hand the bytes to a writer in order.
+ *
+ * One thread per core formats chunks as they become free, while the calling
+ * thread writes the finished ones in order. At most depth chunks are
+ * formatted or waiting at once, so a slow writer (a full pipe or a slow
+ * disk) holds the formatters back instead of letting them fill memory.
+ * Returns once every chunk is written.
+ *
+ * @param count number of items
+ * @param chunk number of items in a chunk
+ * @param format called as format(first, last, bytes) to replace bytes with
+ * the output for items first..last-1
+ * @param write called with the bytes of each chunk, in order
+ * @param depth chunks in flight at once (0 for twice the number of threads)
+ */
+void forEachChunkInOrder(long count, long chunk,
+        const std::function<void(long, long, std::vector<char>&)>& format,
+        const std::function<void(const std::vector<char>&)>& write,
+        int depth = 0);
+
+#endif /* PARALLELBANDS_H_ */
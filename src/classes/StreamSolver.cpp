@@ -0,0 +1,339 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file StreamSolver.cpp
+ * @brief Contains the methods of the StreamSolver class.
+ */
+
+#ifndef STREAMSOLVER_CPP_
+#define STREAMSOLVER_CPP_
+
+#include <sys/mman.h>
+#include "StreamSolver.h"
+#include "MazeSolver.h"
+
+/*
+ * Records kept in memory before they are written out (16 bytes each)
+ */
+static const long SPILLRECORDS = 1 << 16;
+
+StreamSolver::StreamSolver() {
+    cols = 0;
+    words = 0;
+    rows = 0;
+    startCol = 0;
+    startVertex = -1;
+    startLabel = -1;
+    numLabels = 0;
+    numRecords = 0;
+    numSpilled = 0;
+    spillFile = NULL;
+}
+
+StreamSolver::~StreamSolver() {
+    if (spillFile) fclose(spillFile);
+}
+
+void StreamSolver::begin(int c, int start_c) {
+    cols = c;
+    words = (c + 63) / 64;
+    rows = 0;
+    startCol = start_c;
+    startVertex = -1;
+    startLabel = -1;
+    numLabels = 0;
+
+    vertices.clear();
+    freeVertices.clear();
+    rowVertices.assign(cols, -1);
+    oldVertices.assign(cols, -1);
+    labels.assign(cols, 0);
+    lastDown.assign(words, ~(uint64_t)0);
+    sets.resize(2 * cols + 1);
+    relabel.resize(2 * cols + 1);
+
+    records.clear();
+    numRecords = 0;
+    numSpilled = 0;
+    if (spillFile) {
+        fclose(spillFile);
+        spillFile = NULL;
+    }
+}
+
+int StreamSolver::newVertex(long node) {
+    int v;
+    if (freeVertices.empty()) {
+        v = (int) vertices.size();
+        vertices.push_back(Vertex());
+    } else {
+        v = freeVertices.back();
+        freeVertices.pop_back();
+    }
+    vertices[v].node = node;
+    vertices[v].degree = 0;
+    return v;
+}
+
+void StreamSolver::addEdge(int u, int v, uint64_t piece) {
+    Vertex& a = vertices[u];
+    a.next[a.degree] = v;
+    a.piece[a.degree++] = piece;
+    Vertex& b = vertices[v];
+    b.next[b.degree] = u;
+    b.piece[b.degree++] = piece ^ 1;
+}
+
+int StreamSolver::slotOf(int u, int v) const {
+    int slot = 0;
+    while (vertices[u].next[slot] != v) slot++;
+    return slot;
+}
+
+void StreamSolver::addRow(const uint64_t *right, const uint64_t *down) {
+    long base = (long) rows * cols;
+    oldVertices.swap(rowVertices);
+    for (int c=0; c < cols; c++) {
+        rowVertices[c] = newVertex(base + c);
+    }
+
+    // Nodes of the new row are sets 0..cols-1, labels of the old row follow
+    for (int i=0; i < cols + numLabels; i++) sets[i] = i;
+
+    // Down from the row before (nothing comes down into the first row)
+    for (int w=0; w < words; w++) {
+        uint64_t open = ~lastDown[w];
+        while (open) {
+            int c = w * 64 + __builtin_ctzll(open);
+            open &= open - 1;
+            int a = findSet(cols + labels[c]), b = findSet(c);
+            if (a == b) continue;
+            sets[a] = b;
+            addEdge(oldVertices[c], rowVertices[c], stepPiece(DOWN));
+        }
+    }
+
+    // Along the new row
+    for (int w=0; w < words; w++) {
+        uint64_t open = ~right[w];
+        while (open) {
+            int c = w * 64 + __builtin_ctzll(open);
+            open &= open - 1;
+            int a = findSet(c), b = findSet(c + 1);
+            if (a == b) continue;
+            sets[a] = b;
+            addEdge(rowVertices[c], rowVertices[c+1], stepPiece(RIGHT));
+        }
+    }
+
+    // Label the new row's sets 0, 1, 2... from the left, with the start's
+    // set after them if it didn't reach the new row
+    for (int i=0; i < cols + numLabels; i++) relabel[i] = -1;
+    int count = 0;
+    for (int c=0; c < cols; c++) {
+        int root = findSet(c);
+        if (relabel[root] < 0) relabel[root] = count++;
+        labels[c] = relabel[root];
+    }
+    if (rows == 0) {
+        startLabel = labels[startCol];
+        startVertex = rowVertices[startCol];
+    } else {
+        int root = findSet(cols + startLabel);
+        if (relabel[root] < 0) relabel[root] = count++;
+        startLabel = relabel[root];
+    }
+    numLabels = count;
+    lastDown.assign(down, down + words);
+    rows++;
+
+    if (rows > 1) trim();
+}
+
+void StreamSolver::trim() {
+    // A vertex can be queued twice, so freed ones are marked with node -1
+    pending.assign(oldVertices.begin(), oldVertices.end());
+    long rowStart = (long) (rows - 1) * cols;
+    while (!pending.empty()) {
+        int v = pending.back();
+        pending.pop_back();
+        Vertex& x = vertices[v];
+        if (v == startVertex || x.node < 0) continue;
+        if (x.degree == 0) {
+            x.node = -1;
+            freeVertices.push_back(v);
+        } else if (x.degree == 1) {
+            // A branch that leads nowhere
+            int u = x.next[0];
+            Vertex& y = vertices[u];
+            int slot = slotOf(u, v);
+            --y.degree;
+            y.next[slot] = y.next[y.degree];
+            y.piece[slot] = y.piece[y.degree];
+            if (y.degree <= 2 && y.node < rowStart) pending.push_back(u);
+            x.node = -1;
+            freeVertices.push_back(v);
+        } else if (x.degree == 2) {
+            // Splice v out, joining u - v - w into u - w
+            int u = x.next[0], w = x.next[1];
+            uint64_t piece = joinPieces(x.piece[0] ^ 1, x.piece[1]);
+            int slot = slotOf(u, v);
+            vertices[u].next[slot] = w;
+            vertices[u].piece[slot] = piece;
+            slot = slotOf(w, v);
+            vertices[w].next[slot] = u;
+            vertices[w].piece[slot] = piece ^ 1;
+            x.node = -1;
+            freeVertices.push_back(v);
+        }
+    }
+}
+
+/*
+ * Turn a piece holding its steps that is walked backwards into one walked
+ * forwards
+ */
+static uint64_t forwards(uint64_t piece) {
+    if ((piece & 3) != 3) return piece;
+    int length = (int) ((piece >> 2) & 31);
+    uint64_t steps = piece >> 7, reversed = 0;
+    for (int i=0; i < length; i++) {
+        reversed = (reversed << 2) | (uint64_t) flip((int) (steps & 3));
+        steps >>= 2;
+    }
+    return (reversed << 7) | ((uint64_t) length << 2) | 2;
+}
+
+uint64_t StreamSolver::joinPieces(uint64_t first, uint64_t second) {
+    first = forwards(first);
+    second = forwards(second);
+    if ((first & second & 2) &&
+            ((first >> 2) & 31) + ((second >> 2) & 31) <= (uint64_t) MAXSTEPS) {
+        int length = (int) ((first >> 2) & 31);
+        return first + (second & ~(uint64_t)127) * ((uint64_t)1 << (2 * length))
+                + (second & 124);
+    }
+
+    records.push_back(first);
+    records.push_back(second);
+    if ((long) records.size() >= 2 * SPILLRECORDS) spill();
+    return (uint64_t) numRecords++ << 2;
+}
+
+void StreamSolver::spill() {
+    if (records.empty()) return;
+    if (!spillFile) spillFile = tmpfile();
+    if (!spillFile) {
+        // No temporary file to be had; keep the records in memory instead
+        return;
+    }
+    fwrite(&records[0], sizeof(uint64_t), records.size(), spillFile);
+    numSpilled += (long) records.size() / 2;
+    records.clear();
+}
+
+long StreamSolver::finish(int end_c,
+        const std::function<void(const RowSegment&)>& emit) {
+    if (rows == 0 || labels[end_c] != startLabel) return -1;
+    int endVertex = rowVertices[end_c];
+
+    // Find the route from the start to the end in the forest
+    std::vector<int> parentSlots(vertices.size(), -1);
+    std::vector<int> stack(1, endVertex);
+    parentSlots[endVertex] = 4;
+    while (!stack.empty()) {
+        int v = stack.back();
+        stack.pop_back();
+        if (v == startVertex) break;
+        for (int slot=0; slot < vertices[v].degree; slot++) {
+            int u = vertices[v].next[slot];
+            if (parentSlots[u] >= 0) continue;
+            parentSlots[u] = slotOf(u, v);
+            stack.push_back(u);
+        }
+    }
+
+    // Find the records, in memory or mapped back in from the file
+    const uint64_t *table = records.empty() ? NULL : &records[0];
+    void *mapped = MAP_FAILED;
+    size_t mappedBytes = 0;
+    if (numSpilled > 0) {
+        spill();
+        fflush(spillFile);
+        mappedBytes = (size_t) numRecords * 2 * sizeof(uint64_t);
+        mapped = mmap(NULL, mappedBytes, PROT_READ, MAP_PRIVATE, fileno(spillFile), 0);
+        if (mapped == MAP_FAILED) return -1;
+        table = (const uint64_t *) mapped;
+    }
+
+    // Unfold the pieces from the start to the end, last one on the bottom
+    // of the stack
+    std::vector<uint64_t> pieces;
+    std::vector<uint64_t> route;
+    for (int v = startVertex; v != endVertex; ) {
+        int slot = parentSlots[v];
+        route.push_back(vertices[v].piece[slot]);
+        v = vertices[v].next[slot];
+    }
+    pieces.assign(route.rbegin(), route.rend());
+
+    RowSegment segment;
+    segment.row = 0;
+    segment.from = segment.to = startCol;
+    long length = 0;
+    while (!pieces.empty()) {
+        uint64_t piece = pieces.back();
+        pieces.pop_back();
+        bool backwards = piece & 1;
+        if (!(piece & 2)) {
+            const uint64_t *record = &table[2 * (piece >> 2)];
+            if (backwards) {
+                pieces.push_back(record[0] ^ 1);
+                pieces.push_back(record[1] ^ 1);
+            } else {
+                pieces.push_back(record[1]);
+                pieces.push_back(record[0]);
+            }
+            continue;
+        }
+
+        piece = forwards(piece);
+        int steps = (int) ((piece >> 2) & 31);
+        length += steps;
+        for (piece >>= 7; steps > 0; steps--, piece >>= 2) {
+            int dir = (int) (piece & 3);
+            if (dir == RIGHT) {
+                segment.to++;
+            } else if (dir == LEFT) {
+                segment.to--;
+            } else {
+                emit(segment);
+                segment.row += dir == DOWN ? 1 : -1;
+                segment.from = segment.to;
+            }
+        }
+    }
+    emit(segment);
+
+    if (mapped != MAP_FAILED) munmap(mapped, mappedBytes);
+    return length;
+}
+
+#endif /* STREAMSOLVER_CPP_ */
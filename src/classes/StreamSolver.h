@@ -0,0 +1,330 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file StreamSolver.h
+ * @brief Contains the declaration of the StreamSolver class.
+ */
+
+#ifndef STREAMSOLVER_H_
+#define STREAMSOLVER_H_
+
+#include <vector>
+#include <functional>
+#include <cstdio>
+#include <stdint.h>
+#include "constants.h"
+
+/**
+ * @brief A stretch of a path that stays in one row.
+ *
+ * The path walks along row <code>row</code> from column <code>from</code> to
+ * column <code>to</code> (either way, and possibly not at all), then steps up
+ * or down into the next segment's row at column <code>to</code>.
+ */
+struct RowSegment {
+    int row;
+    int from;
+    int to;
+};
+
+/**
+ * @brief Solves a maze that is handed to it one row at a time, top to
+ * bottom, without ever holding more than a couple of rows.
+ *
+ * Like Eller's algorithm, the solver labels the nodes of the latest row by
+ * which set they are connected to through the rows so far. Alongside the
+ * labels it keeps a compressed forest of how those nodes connect: its
+ * vertices are the nodes of the latest row, the start node, and the nodes
+ * where branches meet, and each edge stands for a path through the rows
+ * already seen. When a row arrives, its nodes join the forest, the nodes of
+ * the row before stop being needed, and the forest is trimmed: branches that
+ * lead nowhere are dropped, and vertices with two edges are spliced out by
+ * joining their edges into one. The forest never has more than a few
+ * vertices per column.
+ *
+ * Joined edges are recorded as pairs of older edges, and those records are
+ * the only thing that grows with the maze. They are written out to a
+ * temporary file once there are more than fit in a small buffer, so memory
+ * use depends only on the width. finish() looks up the route between the
+ * start and the end in the forest and unfolds its records (mapping the file
+ * back in) into the path, which comes out as a list of row segments.
+ *
+ * In a perfect maze that is the solution. Walls that would close a loop are
+ * treated as up, so in a maze with loops the path is one that exists but not
+ * always the shortest.
+ *
+ * The rows use the layout of WallBits (bit set meaning the wall is up,
+ * column c in bit c%64 of word c/64, and the boundary walled).
+ */
+class StreamSolver {
+
+public:
+    StreamSolver();
+    ~StreamSolver();
+
+    /**
+     * @brief Start solving a new maze
+     *
+     * @param c number of columns
+     * @param start_c the column of the starting node, in the first row
+     */
+    void begin(int c, int start_c = 0);
+
+    /**
+     * @brief Hand the solver the next row of the maze
+     *
+     * @param right the right walls of the row, (c+63)/64 words
+     * @param down the down walls of the row, (c+63)/64 words (ignored for
+     * the last row)
+     */
+    void addRow(const uint64_t *right, const uint64_t *down);
+
+    /**
+     * @brief Find the path from the start to a node of the last row added
+     *
+     * The segments are handed to emit in order from the start, the first
+     * one starting at the start node and the last one ending at the end
+     * node. The solver can be started again with begin() afterwards.
+     *
+     * @param end_c the column of the ending node, in the last row
+     * @param emit called with each segment of the path
+     * @return length of the path, or -1 if there isn't one
+     */
+    long finish(int end_c, const std::function<void(const RowSegment&)>& emit);
+
+    /**
+     * @brief get the number of rows added since begin()
+     *
+     * @return rows added
+     */
+    int numRows() const { return rows; }
+
+    /**
+     * @brief get the number of bytes written to the temporary file
+     *
+     * @return bytes spilled
+     */
+    long spilledBytes() const { return numSpilled * 2 * sizeof(uint64_t); }
+
+private:
+
+    /**
+     * @brief A vertex of the compressed forest
+     *
+     * Its edges are in slots 0..degree-1. Each slot holds the vertex at the
+     * other end and a piece of path leading there from this vertex. A node
+     * has at most four neighbors in the maze, so no vertex ever needs more
+     * than four slots.
+     */
+    struct Vertex {
+        long node;
+        int degree;
+        int next[4];
+        uint64_t piece[4];
+    };
+
+    /*
+     * A piece is a path between two nodes. Bit 0 set means the path is
+     * walked backwards. Bit 1 set means the steps are in the piece itself:
+     * bits 2-6 hold the number of steps (up to MAXSTEPS) and the steps
+     * follow, two bits each, first step lowest. Otherwise the rest is the
+     * number of a record of two pieces, walked one after the other.
+     */
+
+    /**
+     * @brief Most steps a piece can hold in itself
+     */
+    static const int MAXSTEPS = 28;
+
+    /**
+     * @brief Get the piece for a single step
+     *
+     * @param dir direction of the step
+     * @return the piece
+     */
+    static uint64_t stepPiece(int dir) {
+        return ((uint64_t) dir << 7) | (1 << 2) | 2;
+    }
+
+    /**
+     * @brief Make a vertex for a node
+     *
+     * @param node index of the node
+     * @return the vertex
+     */
+    int newVertex(long node);
+
+    /**
+     * @brief Join two vertices with an edge
+     *
+     * @param u one vertex
+     * @param v the other vertex
+     * @param piece the path from u to v
+     */
+    void addEdge(int u, int v, uint64_t piece);
+
+    /**
+     * @brief Find the slot of a vertex that leads to another one
+     *
+     * @param u the vertex
+     * @param v the vertex at the other end
+     * @return the slot
+     */
+    int slotOf(int u, int v) const;
+
+    /**
+     * @brief Drop or splice out the vertices of the row before, where they
+     * are no longer needed
+     */
+    void trim();
+
+    /**
+     * @brief Make a piece of two pieces, one after the other
+     *
+     * Short pieces are joined in place, and only longer ones make a record.
+     *
+     * @param first the first piece
+     * @param second the second piece
+     * @return the piece
+     */
+    uint64_t joinPieces(uint64_t first, uint64_t second);
+
+    /**
+     * @brief Write the buffered records out to the temporary file
+     */
+    void spill();
+
+    /**
+     * @brief Find a set in the union-find forest, halving paths on the way
+     *
+     * @param x an element
+     * @return the root of its set
+     */
+    int findSet(int x) {
+        while (sets[x] != x) {
+            sets[x] = sets[sets[x]];
+            x = sets[x];
+        }
+        return x;
+    }
+
+    /**
+     * @brief Number of columns
+     */
+    int cols;
+
+    /**
+     * @brief Number of 64-bit words in a row
+     */
+    int words;
+
+    /**
+     * @brief Number of rows added
+     */
+    int rows;
+
+    /**
+     * @brief Column of the start node
+     */
+    int startCol;
+
+    /**
+     * @brief Vertex of the start node
+     */
+    int startVertex;
+
+    /**
+     * @brief Label of the start node's set
+     */
+    int startLabel;
+
+    /**
+     * @brief Number of labels in use
+     */
+    int numLabels;
+
+    /**
+     * @brief The vertices of the forest, some of them free (node -1)
+     */
+    std::vector<Vertex> vertices;
+
+    /**
+     * @brief Free vertices
+     */
+    std::vector<int> freeVertices;
+
+    /**
+     * @brief Vertex of each node of the latest row
+     */
+    std::vector<int> rowVertices;
+
+    /**
+     * @brief Vertex of each node of the row before
+     */
+    std::vector<int> oldVertices;
+
+    /**
+     * @brief Label of each node of the latest row
+     */
+    std::vector<int> labels;
+
+    /**
+     * @brief Down walls of the latest row
+     */
+    std::vector<uint64_t> lastDown;
+
+    /**
+     * @brief Union-find forest: the nodes of the new row, then the labels of
+     * the row before
+     */
+    std::vector<int> sets;
+
+    /**
+     * @brief Workspace: the new label of each union-find root
+     */
+    std::vector<int> relabel;
+
+    /**
+     * @brief Workspace: vertices waiting to be trimmed
+     */
+    std::vector<int> pending;
+
+    /**
+     * @brief Records not yet written out, two pieces each
+     */
+    std::vector<uint64_t> records;
+
+    /**
+     * @brief Number of records made
+     */
+    long numRecords;
+
+    /**
+     * @brief Number of records written to the temporary file
+     */
+    long numSpilled;
+
+    /**
+     * @brief The temporary file, or NULL before the first spill
+     */
+    FILE *spillFile;
+};
+
+#endif /* STREAMSOLVER_H_ */
@@ -0,0 +1,292 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file TiledMaze.cpp
+ * @brief Contains the methods of the TiledMaze class.
+ */
+
+#ifndef TILEDMAZE_CPP_
+#define TILEDMAZE_CPP_
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include "TiledMaze.h"
+
+const int TiledMaze::TILESIZE;
+
+/*
+ * The byte of a node: its right and down walls (set when up), whether a
+ * generator has visited it, and the direction it came from or went to
+ */
+static const unsigned char RIGHTWALL = 1;
+static const unsigned char DOWNWALL = 2;
+static const unsigned char VISITED = 4;
+static const int DIRSHIFT = 3;
+static const unsigned char DIRMASK = 3 << DIRSHIFT;
+
+static const long TILEBYTES = (long) TiledMaze::TILESIZE * TiledMaze::TILESIZE;
+
+/*
+ * Move a node one step in a direction
+ */
+static inline void step(int& r, int& c, int dir) {
+    switch (dir) {
+    case RIGHT: c++; break;
+    case UP:    r--; break;
+    case LEFT:  c--; break;
+    case DOWN:  r++; break;
+    }
+}
+
+TiledMaze::TiledMaze(int r, int c, long cacheBytes, const std::string& scratchPath) {
+    rows = r;
+    cols = c;
+    tileCols = (c + TILESIZE - 1) / TILESIZE;
+    long tileRows = (r + TILESIZE - 1) / TILESIZE;
+
+    long slots = std::max(cacheBytes / TILEBYTES, 2L);
+    cache.assign(slots * TILEBYTES, 0);
+    slotTile.assign(slots, -1);
+    dirty.assign(slots, false);
+    newer.assign(slots, -1);
+    older.assign(slots, -1);
+    newest = oldest = -1;
+    tileSlot.reserve(slots);
+    stored.assign(tileRows * tileCols, false);
+    lastTile = -1;
+    lastSlot = -1;
+    lastData = NULL;
+    memset(&stats, 0, sizeof(stats));
+
+    if (scratchPath.empty()) {
+        FILE *temp = tmpfile();
+        fd = temp ? dup(fileno(temp)) : -1;
+        if (temp) fclose(temp);
+    } else {
+        fd = open(scratchPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd >= 0) unlink(scratchPath.c_str());
+    }
+    ioError = fd < 0;
+}
+
+TiledMaze::~TiledMaze() {
+    if (fd >= 0) close(fd);
+}
+
+void TiledMaze::page(long t) {
+    stats.tileLookups++;
+    int s;
+    std::unordered_map<long, int>::iterator it = tileSlot.find(t);
+    if (it != tileSlot.end()) {
+        stats.hits++;
+        s = it->second;
+        // Take it out of the recently-used list
+        if (newer[s] >= 0) older[newer[s]] = older[s];
+        else newest = older[s];
+        if (older[s] >= 0) newer[older[s]] = newer[s];
+        else oldest = newer[s];
+    } else {
+        stats.pageIns++;
+        if (tileSlot.size() < slotTile.size()) {
+            s = (int) tileSlot.size();
+        } else {
+            // Make room by dropping the least recently used tile
+            s = oldest;
+            oldest = newer[s];
+            older[oldest] = -1;
+            long old = slotTile[s];
+            if (dirty[s]) {
+                if (pwrite(fd, &cache[s * TILEBYTES], TILEBYTES, (off_t) (old * TILEBYTES)) != TILEBYTES) {
+                    ioError = true;
+                }
+                stored[old] = true;
+                stats.writeBacks++;
+            }
+            tileSlot.erase(old);
+        }
+
+        unsigned char *data = &cache[s * TILEBYTES];
+        if (!stored[t]) {
+            memset(data, RIGHTWALL | DOWNWALL, TILEBYTES);
+        } else if (pread(fd, data, TILEBYTES, (off_t) (t * TILEBYTES)) != TILEBYTES) {
+            ioError = true;
+            memset(data, RIGHTWALL | DOWNWALL, TILEBYTES);
+        }
+        slotTile[s] = t;
+        dirty[s] = false;
+        tileSlot[t] = s;
+    }
+
+    // It's now the most recently used
+    older[s] = newest;
+    newer[s] = -1;
+    if (newest >= 0) newer[newest] = s;
+    else oldest = s;
+    newest = s;
+
+    lastTile = t;
+    lastSlot = s;
+    lastData = &cache[s * TILEBYTES];
+}
+
+void TiledMaze::prefetch(int r, int c, int dir) {
+    int nr = r, nc = c;
+    step(nr, nc, dir);
+    if (nr < 0 || nc < 0 || nr >= rows || nc >= cols) return;
+    long t = tileOf(nr, nc);
+    if (t == tileOf(r, c) || !stored[t] || tileSlot.count(t)) return;
+#ifdef POSIX_FADV_WILLNEED
+    posix_fadvise(fd, (off_t) (t * TILEBYTES), TILEBYTES, POSIX_FADV_WILLNEED);
+#endif
+    stats.prefetches++;
+}
+
+void TiledMaze::knockDown(int r, int c, int dir) {
+    switch (dir) {
+    case RIGHT: set(r, c, get(r, c) & ~RIGHTWALL); break;
+    case UP:    set(r-1, c, get(r-1, c) & ~DOWNWALL); break;
+    case LEFT:  set(r, c-1, get(r, c-1) & ~RIGHTWALL); break;
+    case DOWN:  set(r, c, get(r, c) & ~DOWNWALL); break;
+    }
+}
+
+int TiledMaze::randomDirection(int r, int c, bool unvisitedOnly) {
+    int options[4];
+    int count = 0;
+    for (int dir=RIGHT; dir <= DOWN; dir++) {
+        int nr = r, nc = c;
+        step(nr, nc, dir);
+        if (nr < 0 || nc < 0 || nr >= rows || nc >= cols) continue;
+        if (unvisitedOnly && (get(nr, nc) & VISITED)) continue;
+        options[count++] = dir;
+    }
+    return count > 0 ? options[rand() % count] : -1;
+}
+
+bool TiledMaze::wall(int r, int c, int dir) {
+    switch (dir) {
+    case RIGHT: return (get(r, c) & RIGHTWALL) != 0;
+    case UP:    return r == 0 || (get(r-1, c) & DOWNWALL) != 0;
+    case LEFT:  return c == 0 || (get(r, c-1) & RIGHTWALL) != 0;
+    case DOWN:  return (get(r, c) & DOWNWALL) != 0;
+    }
+    return true;
+}
+
+void TiledMaze::rb() {
+    int start_r = rand() % rows, start_c = rand() % cols;
+    int r = start_r, c = start_c;
+    set(r, c, get(r, c) | VISITED);
+
+    while (true) {
+        int dir = randomDirection(r, c, true);
+        if (dir < 0) {
+            // Backtrack, unless we're back at the start
+            if (r == start_r && c == start_c) break;
+            step(r, c, (get(r, c) & DIRMASK) >> DIRSHIFT);
+            continue;
+        }
+        knockDown(r, c, dir);
+        step(r, c, dir);
+        prefetch(r, c, dir);
+        set(r, c, (get(r, c) & ~DIRMASK) | VISITED | (flip(dir) << DIRSHIFT));
+    }
+}
+
+void TiledMaze::wilsons() {
+    int r = rand() % rows, c = rand() % cols;
+    set(r, c, get(r, c) | VISITED);
+
+    /*
+     * Wilson's algorithm gives every spanning tree the same chance whatever
+     * order the walks start in, so they start from the nodes tile by tile
+     * instead of in a shuffled order, which would need a list of every node.
+     */
+    for (int top=0; top < rows; top += TILESIZE) {
+        for (int left=0; left < cols; left += TILESIZE) {
+            int bottom = std::min(top + TILESIZE, rows), right = std::min(left + TILESIZE, cols);
+            for (int start_r=top; start_r < bottom; start_r++) {
+                for (int start_c=left; start_c < right; start_c++) {
+                    if (get(start_r, start_c) & VISITED) continue;
+
+                    // Walk until we hit the maze, remembering the last way
+                    // out of each node, which erases the loops
+                    r = start_r;
+                    c = start_c;
+                    while (!(get(r, c) & VISITED)) {
+                        int dir = randomDirection(r, c, false);
+                        set(r, c, (get(r, c) & ~DIRMASK) | (dir << DIRSHIFT));
+                        step(r, c, dir);
+                        prefetch(r, c, dir);
+                    }
+
+                    // Add the walk to the maze
+                    r = start_r;
+                    c = start_c;
+                    while (!(get(r, c) & VISITED)) {
+                        int dir = (get(r, c) & DIRMASK) >> DIRSHIFT;
+                        knockDown(r, c, dir);
+                        set(r, c, get(r, c) | VISITED);
+                        step(r, c, dir);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void TiledMaze::forEachRow(const std::function<void(const uint64_t *right, const uint64_t *down)>& emit) {
+    int words = (cols + 63) / 64;
+    std::vector<uint64_t> right((size_t) TILESIZE * words), down((size_t) TILESIZE * words);
+
+    for (int top=0; top < rows; top += TILESIZE) {
+        int bandRows = std::min(TILESIZE, rows - top);
+        std::fill(right.begin(), right.end(), ~(uint64_t)0);
+        std::fill(down.begin(), down.end(), ~(uint64_t)0);
+
+        for (int left=0; left < cols; left += TILESIZE) {
+            long t = tileOf(top, left);
+            if (t != lastTile) page(t);
+            prefetch(top, left + TILESIZE - 1, RIGHT);
+            int width = std::min(TILESIZE, cols - left);
+            for (int i=0; i < bandRows; i++) {
+                const unsigned char *node = lastData + i * TILESIZE;
+                uint64_t *rightWords = &right[(size_t) i * words];
+                uint64_t *downWords = &down[(size_t) i * words];
+                for (int j=0; j < width; j++) {
+                    int col = left + j;
+                    uint64_t bit = (uint64_t)1 << (col % 64);
+                    if (!(node[j] & RIGHTWALL)) rightWords[col / 64] &= ~bit;
+                    if (!(node[j] & DOWNWALL)) downWords[col / 64] &= ~bit;
+                }
+            }
+        }
+
+        for (int i=0; i < bandRows; i++) {
+            emit(&right[(size_t) i * words], &down[(size_t) i * words]);
+        }
+    }
+}
+
+#endif /* TILEDMAZE_CPP_ */
@@ -0,0 +1,307 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file TiledMaze.h
+ * @brief Contains the declaration of the TiledMaze class.
+ */
+
+#ifndef TILEDMAZE_H_
+#define TILEDMAZE_H_
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <stdint.h>
+#include "constants.h"
+
+/**
+ * @brief Counters kept by the tile cache of a TiledMaze
+ */
+struct TileCacheStats {
+    /**
+     * @brief Nodes read or written
+     */
+    long cellAccesses;
+
+    /**
+     * @brief Times a node was in a different tile than the one before it
+     */
+    long tileLookups;
+
+    /**
+     * @brief Tile lookups that found the tile in memory
+     */
+    long hits;
+
+    /**
+     * @brief Tiles read from the file (or started fresh) into memory
+     */
+    long pageIns;
+
+    /**
+     * @brief Changed tiles written to the file to make room
+     */
+    long writeBacks;
+
+    /**
+     * @brief Hints given to the system to read a tile ahead of time
+     */
+    long prefetches;
+
+    /**
+     * @brief Fraction of tile lookups that found the tile in memory
+     */
+    double hitRatio() const {
+        return tileLookups > 0 ? (double) hits / tileLookups : 1;
+    }
+};
+
+/**
+ * @brief A maze kept in a file a tile at a time, for generating mazes
+ * bigger than memory.
+ *
+ * The maze is cut into square tiles of TILESIZE x TILESIZE nodes, one byte
+ * per node: the right and down walls, a visited flag and a direction for the
+ * generators. Tiles live in a scratch file, and only a fixed number of them
+ * are held in memory, in a cache that drops the least recently used tile
+ * when it needs room (writing it back first if it changed). Tiles that have
+ * never been written don't take room in the file; they start out with every
+ * wall up.
+ *
+ * The generators keep all their state in the nodes, the way Maze2d keeps it
+ * in MazeNode, so nothing else grows with the maze. Recursive backtracking
+ * wanders from node to neighboring node and mostly stays within a few tiles,
+ * so a small cache serves it well. Wilson's algorithm starts its walks from
+ * the nodes in tile order, but the first walks wander the whole maze before
+ * they find it, and it pages much more. When a walk reaches the edge of a
+ * tile, the tile across the edge is hinted to the system so it can be read
+ * ahead.
+ *
+ * forEachRow() reads the finished maze out a row at a time in the layout of
+ * WallBits, ready for MazeFile::appendRow() or StreamSolver::addRow().
+ */
+class TiledMaze {
+
+public:
+    /**
+     * @brief Nodes along each side of a tile
+     */
+    static const int TILESIZE = 128;
+
+    /**
+     * @brief Create a maze with every wall up
+     *
+     * @param r number of rows
+     * @param c number of columns
+     * @param cacheBytes memory to give the tile cache (at least two tiles are
+     * kept)
+     * @param scratchPath file to keep the tiles in, which is removed right
+     * away and vanishes when the maze does; empty for a temporary file
+     */
+    TiledMaze(int r, int c, long cacheBytes, const std::string& scratchPath = "");
+    ~TiledMaze();
+
+    /**
+     * @brief Generate the maze with recursive backtracking, from a random
+     * node
+     */
+    void rb();
+
+    /**
+     * @brief Generate the maze with Wilson's algorithm
+     */
+    void wilsons();
+
+    /**
+     * @brief Tell whether a wall is up
+     *
+     * @param r row of the node
+     * @param c column of the node
+     * @param dir direction of the wall from the node (RIGHT, UP, LEFT, DOWN)
+     * @return true if the wall is up (walls on the boundary always are)
+     */
+    bool wall(int r, int c, int dir);
+
+    /**
+     * @brief Hand the maze out a row at a time, top to bottom
+     *
+     * Each call gets the right and down walls of one row, (c+63)/64 words
+     * each, laid out as WallBits::rightRow() and WallBits::downRow(). The
+     * rows of one band of tiles are put together at once, which takes
+     * 2 * TILESIZE * 8 bytes per 64 columns.
+     *
+     * @param emit called with each row
+     */
+    void forEachRow(const std::function<void(const uint64_t *right, const uint64_t *down)>& emit);
+
+    /**
+     * @brief get the number of rows
+     *
+     * @return rows
+     */
+    int numRows() const { return rows; }
+
+    /**
+     * @brief get the number of columns
+     *
+     * @return columns
+     */
+    int numCols() const { return cols; }
+
+    /**
+     * @brief get the number of tiles the cache holds
+     *
+     * @return tiles in the cache
+     */
+    int numSlots() const { return (int) slotTile.size(); }
+
+    /**
+     * @brief get the counters of the tile cache
+     *
+     * @return counters since the maze was created
+     */
+    const TileCacheStats& cacheStats() const { return stats; }
+
+    /**
+     * @brief Tell whether the scratch file has worked so far
+     *
+     * @return false if it couldn't be opened, read or written
+     */
+    bool good() const { return !ioError; }
+
+private:
+
+    /**
+     * @brief Get the byte of a node to read it
+     */
+    unsigned char get(int r, int c) {
+        stats.cellAccesses++;
+        long t = tileOf(r, c);
+        if (t != lastTile) page(t);
+        return lastData[(r % TILESIZE) * TILESIZE + c % TILESIZE];
+    }
+
+    /**
+     * @brief Change the byte of a node
+     */
+    void set(int r, int c, unsigned char value) {
+        stats.cellAccesses++;
+        long t = tileOf(r, c);
+        if (t != lastTile) page(t);
+        lastData[(r % TILESIZE) * TILESIZE + c % TILESIZE] = value;
+        dirty[lastSlot] = true;
+    }
+
+    /**
+     * @brief Get the tile a node is in
+     */
+    long tileOf(int r, int c) const {
+        return (long) (r / TILESIZE) * tileCols + c / TILESIZE;
+    }
+
+    /**
+     * @brief Make a tile the current one, reading it in if need be
+     */
+    void page(long t);
+
+    /**
+     * @brief Hint the system to read ahead the tile across the edge, if a
+     * node is on the edge of its tile in a direction
+     */
+    void prefetch(int r, int c, int dir);
+
+    /**
+     * @brief Take down the wall in a direction from a node
+     */
+    void knockDown(int r, int c, int dir);
+
+    /**
+     * @brief Pick a random direction from a node that stays in the maze,
+     * optionally only towards unvisited nodes
+     *
+     * @return the direction, or -1 if there is none
+     */
+    int randomDirection(int r, int c, bool unvisitedOnly);
+
+    /**
+     * @brief Size of the maze, and the number of tile columns
+     */
+    int rows, cols, tileCols;
+
+    /**
+     * @brief The scratch file
+     */
+    int fd;
+
+    /**
+     * @brief Whether reading or writing the scratch file has failed
+     */
+    bool ioError;
+
+    /**
+     * @brief The tiles in memory, TILESIZE * TILESIZE bytes per slot
+     */
+    std::vector<unsigned char> cache;
+
+    /**
+     * @brief The tile in each slot, or -1
+     */
+    std::vector<long> slotTile;
+
+    /**
+     * @brief Whether the tile in each slot has changed since it was read
+     */
+    std::vector<bool> dirty;
+
+    /**
+     * @brief Neighbors of each slot in the recently-used list
+     */
+    std::vector<int> newer, older;
+
+    /**
+     * @brief Most and least recently used slots
+     */
+    int newest, oldest;
+
+    /**
+     * @brief The slot of each tile in memory
+     */
+    std::unordered_map<long, int> tileSlot;
+
+    /**
+     * @brief Whether each tile has been written to the file
+     */
+    std::vector<bool> stored;
+
+    /**
+     * @brief The current tile, its slot and its bytes
+     */
+    long lastTile;
+    int lastSlot;
+    unsigned char *lastData;
+
+    /**
+     * @brief Counters of the cache
+     */
+    TileCacheStats stats;
+};
+
+#endif /* TILEDMAZE_H_ */
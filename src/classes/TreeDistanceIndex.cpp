@@ -0,0 +1,177 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file TreeDistanceIndex.cpp
+ * @brief Contains the methods of the TreeDistanceIndex class.
+ */
+
+#ifndef TREEDISTANCEINDEX_CPP_
+#define TREEDISTANCEINDEX_CPP_
+
+#include <algorithm>
+#include "TreeDistanceIndex.h"
+#include "MazeSolver.h"
+
+TreeDistanceIndex::TreeDistanceIndex() {
+    rows = 0;
+    cols = 0;
+}
+
+bool TreeDistanceIndex::build(const WallBits& walls) {
+    rows = walls.numRows();
+    cols = walls.numCols();
+    long n = (long) rows * cols;
+    if (n == 0 || n > MAXNODES) return false;
+
+    // A spanning tree has exactly n-1 edges
+    long edges = 0;
+    for (int r=0; r < rows; r++) {
+        for (int w=0; w < walls.wordsPerRow(); w++) {
+            edges += __builtin_popcountll(~walls.rightRow(r)[w] & walls.validMask(w));
+            edges += __builtin_popcountll(~walls.downRow(r)[w] & walls.validMask(w));
+        }
+    }
+    if (edges != n-1) return false;
+
+    depths.assign(n, 0);
+    parentDirs.assign(n, 0);
+    firstVisit.assign(n, -1);
+    tour.clear();
+    tour.reserve(2*n - 1);
+
+    // Depth-first walk from node 0, writing the tour as we go
+    std::vector<uint8_t> nextDir(n, RIGHT);
+    std::vector<int> stack;
+    stack.push_back(0);
+    firstVisit[0] = 0;
+    tour.push_back(0);
+
+    while (!stack.empty()) {
+        int i = stack.back();
+        int r = i / cols, c = i % cols;
+        int child = -1;
+
+        for (int dir=nextDir[i]; dir <= DOWN; dir++) {
+            if (walls.wall(r, c, dir)) continue;
+            if (i != 0 && dir == flip(parentDirs[i])) continue;
+            child = (int) stepIndex(i, dir, cols);
+            nextDir[i] = (uint8_t) (dir + 1);
+            parentDirs[child] = (uint8_t) dir;
+            break;
+        }
+
+        if (child >= 0) {
+            depths[child] = depths[i] + 1;
+            firstVisit[child] = (int) tour.size();
+            tour.push_back(child);
+            stack.push_back(child);
+        } else {
+            stack.pop_back();
+            if (!stack.empty()) tour.push_back(stack.back());
+        }
+    }
+
+    // n-1 edges and connected means it's a tree
+    if ((long) tour.size() != 2*n - 1) return false;
+
+    tourDepths.resize(tour.size());
+    for (size_t t=0; t < tour.size(); t++) {
+        tourDepths[t] = depths[tour[t]];
+    }
+
+    // Shallowest node of every block, then of every run of 2^k blocks
+    int blocks = (int) ((tour.size() + (1 << BLOCKBITS) - 1) >> BLOCKBITS);
+    sparse.assign(1, std::vector<int>(blocks));
+    for (int b=0; b < blocks; b++) {
+        int from = b << BLOCKBITS;
+        int to = std::min((int) tour.size(), from + (1 << BLOCKBITS)) - 1;
+        sparse[0][b] = scanTour(from, to);
+    }
+    for (int k=1; (1 << k) <= blocks; k++) {
+        int count = blocks - (1 << k) + 1;
+        sparse.push_back(std::vector<int>(count));
+        for (int b=0; b < count; b++) {
+            sparse[k][b] = shallower(sparse[k-1][b], sparse[k-1][b + (1 << (k-1))]);
+        }
+    }
+
+    return true;
+}
+
+int TreeDistanceIndex::scanTour(int from, int to) const {
+    int best = from;
+    for (int t=from+1; t <= to; t++) {
+        if (tourDepths[t] < tourDepths[best]) best = t;
+    }
+    return best;
+}
+
+long TreeDistanceIndex::lca(long a, long b) const {
+    int x = firstVisit[a], y = firstVisit[b];
+    if (x > y) std::swap(x, y);
+
+    int bx = x >> BLOCKBITS, by = y >> BLOCKBITS;
+    if (bx == by) return tour[scanTour(x, y)];
+
+    // The two partial blocks at the ends...
+    int best = shallower(scanTour(x, ((bx + 1) << BLOCKBITS) - 1),
+                         scanTour(by << BLOCKBITS, y));
+    // ...and the whole blocks in between, as two overlapping runs
+    int between = by - bx - 1;
+    if (between > 0) {
+        int k = 31 - __builtin_clz(between);
+        best = shallower(best, shallower(sparse[k][bx + 1], sparse[k][by - (1 << k)]));
+    }
+    return tour[best];
+}
+
+int TreeDistanceIndex::distance(int start_r, int start_c, int end_r,
+        int end_c) const {
+    long a = (long) start_r * cols + start_c;
+    long b = (long) end_r * cols + end_c;
+    return depths[a] + depths[b] - 2 * depths[lca(a, b)];
+}
+
+int TreeDistanceIndex::path(int start_r, int start_c, int end_r, int end_c,
+        std::vector<unsigned char>& path) const {
+    long a = (long) start_r * cols + start_c;
+    long b = (long) end_r * cols + end_c;
+    long ancestor = lca(a, b);
+
+    path.clear();
+    // Up from the start to the ancestor...
+    for (long i = a; i != ancestor; ) {
+        int dir = flip(parentDirs[i]);
+        path.push_back((unsigned char) dir);
+        i = stepIndex(i, dir, cols);
+    }
+    // ...then down to the end, which we find by climbing up from it
+    size_t turn = path.size();
+    for (long i = b; i != ancestor; ) {
+        int dir = parentDirs[i];
+        path.push_back((unsigned char) dir);
+        i = stepIndex(i, flip(dir), cols);
+    }
+    std::reverse(path.begin() + turn, path.end());
+
+    return (int) path.size();
+}
+
+#endif /* TREEDISTANCEINDEX_CPP_ */
@@ -0,0 +1,181 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file TreeDistanceIndex.h
+ * @brief Contains the declaration of the TreeDistanceIndex class.
+ */
+
+#ifndef TREEDISTANCEINDEX_H_
+#define TREEDISTANCEINDEX_H_
+
+#include <vector>
+#include <stdint.h>
+#include "constants.h"
+#include "WallBits.h"
+
+/**
+ * @brief Answers distance queries on a perfect maze in constant time.
+ *
+ * A perfect maze is a spanning tree of its nodes. The index roots that tree
+ * at node 0,0 and stores the depth and parent direction of every node, plus
+ * an Euler tour of the tree. The lowest common ancestor of two nodes is the
+ * shallowest node on the tour between their first visits, found with a
+ * sparse table over blocks of the tour and a scan inside at most two
+ * blocks. The distance between two nodes is then
+ * depth(a) + depth(b) - 2 * depth(lca(a, b)), and the path between them is
+ * read off the parent directions without any search.
+ *
+ * The index only reads the maze while it is built, and queries don't change
+ * it, so any number of threads can query one index at once.
+ */
+class TreeDistanceIndex {
+
+public:
+    /**
+     * @brief Most nodes a maze can have to be indexed, so that positions in
+     * the tour (2n - 1 of them) fit in an int
+     */
+    static const long MAXNODES = 1L << 30;
+
+    TreeDistanceIndex();
+
+    /**
+     * @brief Build the index for a maze
+     *
+     * @param walls the maze
+     * @return true if success, false if the maze isn't a spanning tree (it
+     * has loops, or some nodes can't be reached) or has more than MAXNODES
+     * nodes
+     */
+    bool build(const WallBits& walls);
+
+    /**
+     * @brief get the number of columns of the indexed maze
+     *
+     * @return number of columns
+     */
+    int numCols() const { return cols; }
+
+    /**
+     * @brief Get the depth of a node (its distance from node 0,0)
+     *
+     * @param r row of the node
+     * @param c column of the node
+     * @return the depth
+     */
+    int depth(int r, int c) const { return depths[(long) r * cols + c]; }
+
+    /**
+     * @brief Find the lowest common ancestor of two nodes
+     *
+     * @param a index of the first node (row * columns + column)
+     * @param b index of the second node
+     * @return index of the ancestor
+     */
+    long lca(long a, long b) const;
+
+    /**
+     * @brief Get the length of the path between two nodes
+     *
+     * @param start_r the row of the starting node
+     * @param start_c the column of the starting node
+     * @param end_r the row of the ending node
+     * @param end_c the column of the ending node
+     * @return the length of the path
+     */
+    int distance(int start_r, int start_c, int end_r, int end_c) const;
+
+    /**
+     * @brief Get the path between two nodes
+     *
+     * Takes time proportional to the length of the path.
+     *
+     * @param start_r the row of the starting node
+     * @param start_c the column of the starting node
+     * @param end_r the row of the ending node
+     * @param end_c the column of the ending node
+     * @param path filled with the directions to take from the start
+     * @return the length of the path
+     */
+    int path(int start_r, int start_c, int end_r, int end_c,
+            std::vector<unsigned char>& path) const;
+
+private:
+
+    /**
+     * @brief log2 of the number of tour entries in a block
+     */
+    static const int BLOCKBITS = 5;
+
+    /**
+     * @brief Number of rows
+     */
+    int rows;
+
+    /**
+     * @brief Number of columns
+     */
+    int cols;
+
+    /**
+     * @brief Distance of every node from node 0,0
+     */
+    std::vector<int> depths;
+
+    /**
+     * @brief Direction from each node's parent to the node (unused for the
+     * root)
+     */
+    std::vector<uint8_t> parentDirs;
+
+    /**
+     * @brief The Euler tour, as node indices
+     */
+    std::vector<int> tour;
+
+    /**
+     * @brief Depth of each node on the tour, so the scans are sequential
+     */
+    std::vector<int> tourDepths;
+
+    /**
+     * @brief Position of each node's first visit in the tour
+     */
+    std::vector<int> firstVisit;
+
+    /**
+     * @brief sparse[k][b] is the tour position of the shallowest node in
+     * tour blocks b to b + 2^k - 1
+     */
+    std::vector<std::vector<int> > sparse;
+
+    /**
+     * @brief Shallower of the nodes at two tour positions
+     */
+    int shallower(int a, int b) const { return tourDepths[a] <= tourDepths[b] ? a : b; }
+
+    /**
+     * @brief Tour position of the shallowest node in tour positions
+     * from..to, inclusive, by scanning them
+     */
+    int scanTour(int from, int to) const;
+};
+
+#endif /* TREEDISTANCEINDEX_H_ */
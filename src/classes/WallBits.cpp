@@ -0,0 +1,365 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file WallBits.cpp
+ * @brief Contains the methods of the WallBits class.
+ */
+
+#ifndef WALLBITS_CPP_
+#define WALLBITS_CPP_
+
+#include <atomic>
+#include "WallBits.h"
+#include "ParallelBands.h"
+
+WallBits::WallBits() {
+    rows = 0;
+    cols = 0;
+    words = 0;
+    lastWordMask = 0;
+    rightBits = NULL;
+    downBits = NULL;
+}
+
+WallBits::WallBits(int r, int c) {
+    rows = r;
+    cols = c;
+    words = (cols + 63) / 64;
+    lastWordMask = (cols % 64 == 0) ? ~(uint64_t)0 : (((uint64_t)1 << (cols % 64)) - 1);
+
+    // Every wall starts out up, padding included
+    right.assign((size_t)rows * words, ~(uint64_t)0);
+    down.assign((size_t)rows * words, ~(uint64_t)0);
+    rightBits = right.data();
+    downBits = down.data();
+}
+
+WallBits::WallBits(const WallBits& other) {
+    rightBits = NULL;
+    downBits = NULL;
+    *this = other;
+}
+
+WallBits::WallBits(WallBits&& other) {
+    rightBits = NULL;
+    downBits = NULL;
+    *this = std::move(other);
+}
+
+WallBits& WallBits::operator=(const WallBits& other) {
+    if (this == &other) return *this;
+    rows = other.rows;
+    cols = other.cols;
+    words = other.words;
+    lastWordMask = other.lastWordMask;
+    size_t count = (size_t)rows * words;
+    right.assign(other.rightBits, other.rightBits + count);
+    down.assign(other.downBits, other.downBits + count);
+    rightBits = right.data();
+    downBits = down.data();
+    owner.reset();
+    return *this;
+}
+
+WallBits& WallBits::operator=(WallBits&& other) {
+    if (this == &other) return *this;
+    rows = other.rows;
+    cols = other.cols;
+    words = other.words;
+    lastWordMask = other.lastWordMask;
+    // Moving a vector keeps its buffer, so the pointers stay good
+    right = std::move(other.right);
+    down = std::move(other.down);
+    rightBits = other.rightBits;
+    downBits = other.downBits;
+    owner = std::move(other.owner);
+
+    other.rows = other.cols = other.words = 0;
+    other.lastWordMask = 0;
+    other.right.clear();
+    other.down.clear();
+    other.rightBits = other.downBits = NULL;
+    return *this;
+}
+
+bool WallBits::attach(int r, int c, uint64_t *rightWords, uint64_t *downWords,
+        const std::shared_ptr<void>& newOwner) {
+    *this = WallBits();
+    if (r <= 0 || c <= 0) return false;
+    int w = (c + 63) / 64;
+    uint64_t mask = (c % 64 == 0) ? ~(uint64_t)0 : (((uint64_t)1 << (c % 64)) - 1);
+    uint64_t lastColumn = (uint64_t)1 << ((c - 1) % 64);
+
+    // Right walls of the last column and padding bits, then the bottom row
+    for (int i=0; i < r; i++) {
+        uint64_t needed = ~mask | lastColumn;
+        if ((rightWords[(size_t)i * w + w-1] & needed) != needed) return false;
+        if ((downWords[(size_t)i * w + w-1] | mask) != ~(uint64_t)0) return false;
+    }
+    for (int i=0; i < w; i++) {
+        if (downWords[(size_t)(r-1) * w + i] != ~(uint64_t)0) return false;
+    }
+
+    rows = r;
+    cols = c;
+    words = w;
+    lastWordMask = mask;
+    rightBits = rightWords;
+    downBits = downWords;
+    owner = newOwner;
+    return true;
+}
+
+bool WallBits::wall(int r, int c, int dir) const {
+    switch (dir) {
+    case RIGHT:
+        return (rightRow(r)[c / 64] >> (c % 64)) & 1;
+    case UP:
+        if (r == 0) return true;
+        return (downRow(r-1)[c / 64] >> (c % 64)) & 1;
+    case LEFT:
+        if (c == 0) return true;
+        return (rightRow(r)[(c-1) / 64] >> ((c-1) % 64)) & 1;
+    case DOWN:
+        return (downRow(r)[c / 64] >> (c % 64)) & 1;
+    default:
+        return true;
+    }
+}
+
+bool WallBits::setWall(int r, int c, int dir, bool up) {
+    // Normalize to the node that owns the wall
+    switch (dir) {
+    case RIGHT:
+        if (c >= cols-1) return false;
+        break;
+    case UP:
+        if (r == 0) return false;
+        r--;
+        dir = DOWN;
+        break;
+    case LEFT:
+        if (c == 0) return false;
+        c--;
+        dir = RIGHT;
+        break;
+    case DOWN:
+        if (r >= rows-1) return false;
+        break;
+    default:
+        return false;
+    }
+
+    uint64_t *word = dir == RIGHT ? &rightRow(r)[c / 64] : &downRow(r)[c / 64];
+    uint64_t bit = (uint64_t)1 << (c % 64);
+    if (up) *word |= bit;
+    else *word &= ~bit;
+
+    return true;
+}
+
+void WallBits::deadEnds(int r, uint64_t *out) const {
+    const uint64_t *rightWalls = rightRow(r);
+    const uint64_t *downWalls = downRow(r);
+    const uint64_t *upWalls = r > 0 ? downRow(r-1) : NULL;
+
+    for (int w=0; w < words; w++) {
+        uint64_t a = rightWalls[w];
+        uint64_t b = downWalls[w];
+        uint64_t c = upWalls ? upWalls[w] : ~(uint64_t)0;
+        // The left wall of node i is the right wall of node i-1
+        uint64_t d = (rightWalls[w] << 1) | (w > 0 ? rightWalls[w-1] >> 63 : 1);
+
+        uint64_t atLeastThree = (a & b & (c | d)) | (c & d & (a | b));
+        out[w] = atLeastThree & ~(a & b & c & d) & validMask(w);
+    }
+}
+
+void WallBits::corridors(int r, uint64_t *out) const {
+    const uint64_t *rightWalls = rightRow(r);
+    const uint64_t *downWalls = downRow(r);
+    const uint64_t *upWalls = r > 0 ? downRow(r-1) : NULL;
+
+    for (int w=0; w < words; w++) {
+        uint64_t a = rightWalls[w];
+        uint64_t b = downWalls[w];
+        uint64_t c = upWalls ? upWalls[w] : ~(uint64_t)0;
+        uint64_t d = (rightWalls[w] << 1) | (w > 0 ? rightWalls[w-1] >> 63 : 1);
+
+        // Exactly two of a, b, c, d: one in each pair, or both of one pair
+        // and neither of the other
+        uint64_t oneEach = (a ^ b) & (c ^ d);
+        uint64_t onePair = (a & b & ~(c | d)) | (c & d & ~(a | b));
+        out[w] = (oneEach | onePair) & validMask(w);
+    }
+}
+
+/*
+ * splitmix64, used to give every row its own random stream so that braiding
+ * doesn't depend on how the rows are split into bands.
+ */
+static inline uint64_t nextRandom(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+long WallBits::braid(double fraction, unsigned int seed) {
+    if (fraction <= 0 || rows == 0) return 0;
+
+    // Walls to knock down, sorted by the row that owns them
+    std::vector<uint64_t> knockRight((size_t)rows * words, 0);
+    std::vector<uint64_t> knockDown((size_t)rows * words, 0);
+    // Up walls of row r are owned by row r-1, so keep them apart until the
+    // second pass
+    std::vector<uint64_t> knockUp((size_t)rows * words, 0);
+
+    uint64_t threshold = fraction >= 1 ? ((uint64_t)1 << 32) : (uint64_t)(fraction * 4294967296.0);
+    std::atomic<long> removed(0);
+
+    forEachRowBand(rows, [&](int first, int last) {
+        std::vector<uint64_t> ends(words);
+
+        for (int r=first; r < last; r++) {
+            uint64_t state = ((uint64_t)seed << 32) ^ (uint64_t)r;
+            deadEnds(r, &ends[0]);
+
+            for (int w=0; w < words; w++) {
+                uint64_t bits = ends[w];
+                while (bits) {
+                    int c = w * 64 + __builtin_ctzll(bits);
+                    bits &= bits - 1;
+
+                    if ((nextRandom(state) >> 32) >= threshold) continue;
+
+                    // Pick one of the walls that isn't on the boundary
+                    int options[4];
+                    int num_options = 0;
+                    if (c < cols-1 && wall(r, c, RIGHT)) options[num_options++] = RIGHT;
+                    if (r > 0 && wall(r, c, UP)) options[num_options++] = UP;
+                    if (c > 0 && wall(r, c, LEFT)) options[num_options++] = LEFT;
+                    if (r < rows-1 && wall(r, c, DOWN)) options[num_options++] = DOWN;
+                    if (num_options == 0) continue;
+
+                    size_t base = (size_t)r * words;
+                    switch (options[nextRandom(state) % num_options]) {
+                    case RIGHT:
+                        knockRight[base + c / 64] |= (uint64_t)1 << (c % 64);
+                        break;
+                    case UP:
+                        knockUp[base + c / 64] |= (uint64_t)1 << (c % 64);
+                        break;
+                    case LEFT:
+                        knockRight[base + (c-1) / 64] |= (uint64_t)1 << ((c-1) % 64);
+                        break;
+                    case DOWN:
+                        knockDown[base + c / 64] |= (uint64_t)1 << (c % 64);
+                        break;
+                    }
+                }
+            }
+        }
+    });
+
+    // Two neighbouring dead ends can pick the wall between them, so count
+    // only the walls that are still up when they're knocked down
+    forEachRowBand(rows, [&](int first, int last) {
+        long bandRemoved = 0;
+        for (int r=first; r < last; r++) {
+            size_t base = (size_t)r * words;
+            uint64_t *rightWalls = rightRow(r);
+            uint64_t *downWalls = downRow(r);
+            for (int w=0; w < words; w++) {
+                uint64_t fromBelow = r < rows-1 ? knockUp[base + words + w] : 0;
+                uint64_t right = rightWalls[w] & knockRight[base + w];
+                uint64_t down = downWalls[w] & (knockDown[base + w] | fromBelow);
+                bandRemoved += __builtin_popcountll(right) + __builtin_popcountll(down);
+                rightWalls[w] &= ~right;
+                downWalls[w] &= ~down;
+            }
+        }
+        removed += bandRemoved;
+    });
+
+    return removed;
+}
+
+/*
+ * Union-find root with path halving
+ */
+static int findRoot(std::vector<int>& parent, int x) {
+    while (parent[x] != x) x = parent[x] = parent[parent[x]];
+    return x;
+}
+
+bool WallBits::isSpanningTree() const {
+    if (rows == 0 || cols == 0) return false;
+
+    /*
+     * Ids [0, cols) are the pieces of the maze above the current row, named
+     * by the labels of the row before; ids [cols, 2*cols) are the nodes of
+     * the current row. Joining two ids that already share a root closes a
+     * loop, and a piece above that doesn't reach the current row can never
+     * be joined to the rest.
+     */
+    std::vector<int> parent(2 * cols);
+    std::vector<int> label(cols, 0);
+    std::vector<int> rename(2 * cols);
+    std::vector<bool> reached(2 * cols);
+    for (int r=0; r < rows; r++) {
+        for (int i=0; i < 2 * cols; i++) parent[i] = i;
+        const uint64_t *rightWalls = rightRow(r);
+        for (int c=0; c < cols; c++) {
+            if (r > 0 && !((downRow(r-1)[c / 64] >> (c % 64)) & 1)) {
+                int a = findRoot(parent, label[c]);
+                int b = findRoot(parent, cols + c);
+                if (a == b) return false;
+                parent[a] = b;
+            }
+            if (c < cols-1 && !((rightWalls[c / 64] >> (c % 64)) & 1)) {
+                int a = findRoot(parent, cols + c);
+                int b = findRoot(parent, cols + c + 1);
+                if (a == b) return false;
+                parent[a] = b;
+            }
+        }
+
+        reached.assign(2 * cols, false);
+        for (int c=0; c < cols; c++) reached[findRoot(parent, cols + c)] = true;
+        if (r > 0) {
+            for (int c=0; c < cols; c++) {
+                if (!reached[findRoot(parent, label[c])]) return false;
+            }
+        }
+
+        int pieces = 0;
+        rename.assign(2 * cols, -1);
+        for (int c=0; c < cols; c++) {
+            int root = findRoot(parent, cols + c);
+            if (rename[root] < 0) rename[root] = pieces++;
+            label[c] = rename[root];
+        }
+        if (r == rows-1 && pieces != 1) return false;
+    }
+    return true;
+}
+
+#endif /* WALLBITS_CPP_ */
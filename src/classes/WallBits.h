@@ -0,0 +1,262 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file WallBits.h
+ * @brief Contains the declaration of the WallBits class.
+ */
+
+#ifndef WALLBITS_H_
+#define WALLBITS_H_
+
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include "constants.h"
+
+/**
+ * @brief Packed wall bitmap of a maze.
+ *
+ * Every node owns two walls: the one on its right and the one below it. Each
+ * row of the maze is stored as two arrays of 64-bit words (right walls and
+ * down walls), one bit per node, bit set meaning the wall is up. Column c of
+ * a row lives in bit c%64 of word c/64.
+ *
+ * The outer boundary is always walled: the right walls of the last column,
+ * the down walls of the last row, and the padding bits past the last column
+ * are kept set. That way the bitboard kernels never need to special-case the
+ * edges of the maze. (The entrance and exit are a drawing convention and are
+ * not stored here.)
+ *
+ * The words normally live in the bitmap itself, but attach() can point it at
+ * words held elsewhere (a mapped file, say). Copying a bitmap always gives
+ * the copy words of its own.
+ */
+class WallBits {
+
+public:
+    /**
+     * @brief Create an empty 0x0 bitmap
+     */
+    WallBits();
+
+    /**
+     * @brief Create a bitmap with r rows and c columns and every wall up
+     *
+     * @param r number of rows
+     * @param c number of columns
+     */
+    WallBits(int r, int c);
+
+    WallBits(const WallBits& other);
+    WallBits(WallBits&& other);
+    WallBits& operator=(const WallBits& other);
+    WallBits& operator=(WallBits&& other);
+
+    /**
+     * @brief Use words held somewhere else as the walls, without copying them
+     *
+     * The words must be laid out as rightRow() and downRow() return them, one
+     * row after another, and must stay valid (and writable, if the walls are
+     * going to change) as long as owner is held. The boundary walls and
+     * padding bits are checked, which reads the last word of every row.
+     *
+     * @param r number of rows
+     * @param c number of columns
+     * @param rightWords r * ((c+63)/64) words of right walls
+     * @param downWords r * ((c+63)/64) words of down walls
+     * @param owner kept alive as long as the bitmap uses the words
+     * @return true if success, false if the boundary isn't walled (the bitmap
+     * is left empty)
+     */
+    bool attach(int r, int c, uint64_t *rightWords, uint64_t *downWords,
+            const std::shared_ptr<void>& owner);
+
+    /**
+     * @brief get the number of rows
+     *
+     * @return number of rows
+     */
+    int numRows() const { return rows; }
+
+    /**
+     * @brief get the number of columns
+     *
+     * @return number of columns
+     */
+    int numCols() const { return cols; }
+
+    /**
+     * @brief get the number of 64-bit words in each row
+     *
+     * @return words per row
+     */
+    int wordsPerRow() const { return words; }
+
+    /**
+     * @brief Mask of the bits in word w of a row that are real nodes
+     *
+     * @param w word index
+     * @return mask of valid bits
+     */
+    uint64_t validMask(int w) const {
+        return w < words-1 ? ~(uint64_t)0 : lastWordMask;
+    }
+
+    /**
+     * @brief Get the right walls of a row
+     *
+     * @param r row
+     * @return pointer to wordsPerRow() words
+     */
+    uint64_t *rightRow(int r) { return rightBits + (size_t)r * words; }
+    const uint64_t *rightRow(int r) const { return rightBits + (size_t)r * words; }
+
+    /**
+     * @brief Get the down walls of a row
+     *
+     * @param r row
+     * @return pointer to wordsPerRow() words
+     */
+    uint64_t *downRow(int r) { return downBits + (size_t)r * words; }
+    const uint64_t *downRow(int r) const { return downBits + (size_t)r * words; }
+
+    /**
+     * @brief Tell whether there is a wall on one side of a node
+     *
+     * The boundary of the maze counts as a wall.
+     *
+     * @param r row of the node
+     * @param c column of the node
+     * @param dir direction of the wall (RIGHT, UP, LEFT, DOWN)
+     * @return true if the wall is up
+     */
+    bool wall(int r, int c, int dir) const;
+
+    /**
+     * @brief Raise or knock down the wall on one side of a node
+     *
+     * Walls on the boundary of the maze can't be knocked down; asking to do
+     * so does nothing and returns false.
+     *
+     * @param r row of the node
+     * @param c column of the node
+     * @param dir direction of the wall (RIGHT, UP, LEFT, DOWN)
+     * @param up true to raise the wall, false to knock it down
+     * @return true if success
+     */
+    bool setWall(int r, int c, int dir, bool up);
+
+    /**
+     * @brief Compute the dead ends of a row
+     *
+     * A dead end is a node with exactly three walls up.
+     *
+     * @param r row
+     * @param out wordsPerRow() words to write the dead-end bits into
+     */
+    void deadEnds(int r, uint64_t *out) const;
+
+    /**
+     * @brief Compute the corridor nodes of a row
+     *
+     * A corridor node is a node with exactly two walls up, so it has one way
+     * in and one way out.
+     *
+     * @param r row
+     * @param out wordsPerRow() words to write the corridor bits into
+     */
+    void corridors(int r, uint64_t *out) const;
+
+    /**
+     * @brief Knock down walls to remove a fraction of the dead ends.
+     *
+     * Each dead end is picked with probability <code>fraction</code> and one
+     * of its inside walls, chosen at random, is knocked down. The dead ends
+     * are found and the walls picked in one parallel pass over row bands, and
+     * the walls come down in a second, so the result depends only on the
+     * seed and not on the number of threads.
+     *
+     * @param fraction fraction of dead ends to remove, 0 to 1
+     * @param seed seed for the random choices
+     * @return the number of walls knocked down (two neighbouring dead ends
+     * that pick the wall between them knock down one)
+     */
+    long braid(double fraction, unsigned int seed);
+
+    /**
+     * @brief Tell whether the maze is perfect: every node can be reached and
+     * there are no loops
+     *
+     * Sweeps the rows once with a union-find over two rows of nodes, so it
+     * needs memory for a couple of rows rather than the whole maze.
+     *
+     * @return true if the open walls form a spanning tree of the nodes
+     */
+    bool isSpanningTree() const;
+
+private:
+
+    /**
+     * @brief Number of rows
+     */
+    int rows;
+
+    /**
+     * @brief Number of columns
+     */
+    int cols;
+
+    /**
+     * @brief Number of 64-bit words per row
+     */
+    int words;
+
+    /**
+     * @brief Mask of the valid bits in the last word of each row
+     */
+    uint64_t lastWordMask;
+
+    /**
+     * @brief Right walls, rows*words words in row-major order
+     */
+    uint64_t *rightBits;
+
+    /**
+     * @brief Down walls, rows*words words in row-major order
+     */
+    uint64_t *downBits;
+
+    /**
+     * @brief Storage for the right walls, unless they are attached
+     */
+    std::vector<uint64_t> right;
+
+    /**
+     * @brief Storage for the down walls, unless they are attached
+     */
+    std::vector<uint64_t> down;
+
+    /**
+     * @brief Whatever holds attached walls, or empty
+     */
+    std::shared_ptr<void> owner;
+};
+
+#endif /* WALLBITS_H_ */
@@ -0,0 +1,370 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file WallCoder.cpp
+ * @brief Contains the methods of the WallCoder class.
+ */
+
+#ifndef WALLCODER_CPP_
+#define WALLCODER_CPP_
+
+#include <cstring>
+#include <algorithm>
+#include "WallCoder.h"
+
+/*
+ * Probabilities are out of 1 << PROBBITS. Each moves 1/2 of the way towards
+ * the first bit coded with it, and by smaller steps after that, down to
+ * 1/(1 << ADAPTSHIFT) of the way, so it settles quickly and then follows
+ * the maze as it goes.
+ */
+static const int PROBBITS = 11;
+static const int ADAPTSHIFT = 5;
+static const uint32_t TOP = 1 << 24;
+
+/*
+ * The probability of a 0 bit in one context
+ */
+struct Probability {
+    uint16_t zero;
+    uint16_t seen;
+
+    Probability() : zero(1 << (PROBBITS - 1)), seen(0) {}
+
+    void update(int bit) {
+        int shift = std::min(ADAPTSHIFT, 1 + seen / 2);
+        if (!bit) zero += ((1 << PROBBITS) - zero) >> shift;
+        else zero -= zero >> shift;
+        // Never quite certain, so a surprise can still be coded
+        zero = std::max<uint16_t>(31, std::min<uint16_t>((1 << PROBBITS) - 31, zero));
+        if (seen < 2 * ADAPTSHIFT) seen++;
+    }
+};
+
+/*
+ * Contexts for each kind of wall
+ */
+static const int RIGHTCONTEXTS = 256;
+static const int DOWNCONTEXTS = 256;
+
+static inline int bitAt(const uint64_t *row, int j) {
+    return (int) ((row[j / 64] >> (j % 64)) & 1);
+}
+
+static inline void setBit(uint64_t *row, int j, int bit) {
+    if (bit) row[j / 64] |= (uint64_t)1 << (j % 64);
+}
+
+/*
+ * Binary range encoder
+ */
+class RangeEncoder {
+public:
+    RangeEncoder(std::vector<char>& b) : bytes(b), low(0), range(0xFFFFFFFF), cache(0), pending(1) {}
+
+    int bit(Probability& probability, int value) {
+        uint32_t bound = (range >> PROBBITS) * probability.zero;
+        if (!value) {
+            range = bound;
+        } else {
+            low += bound;
+            range -= bound;
+        }
+        probability.update(value);
+        while (range < TOP) {
+            range <<= 8;
+            shiftLow();
+        }
+        return value;
+    }
+
+    void finish() {
+        for (int k=0; k < 5; k++) shiftLow();
+    }
+
+private:
+    /*
+     * Move the top byte of low out, holding back runs of 0xff bytes until
+     * it's known whether a carry will ripple through them
+     */
+    void shiftLow() {
+        if ((uint32_t) low < 0xFF000000 || (low >> 32) != 0) {
+            unsigned char carry = (unsigned char) (low >> 32);
+            unsigned char held = cache;
+            do {
+                bytes.push_back((char) (held + carry));
+                held = 0xFF;
+            } while (--pending != 0);
+            cache = (unsigned char) (low >> 24);
+        }
+        pending++;
+        low = (low & 0x00FFFFFF) << 8;
+    }
+
+    std::vector<char>& bytes;
+    uint64_t low;
+    uint32_t range;
+    unsigned char cache;
+    uint64_t pending;
+};
+
+/*
+ * Binary range decoder
+ */
+class RangeDecoder {
+public:
+    RangeDecoder(const char *b, size_t length)
+            : next((const unsigned char *) b), end((const unsigned char *) b + length),
+              range(0xFFFFFFFF), code(0), overrun(false) {
+        for (int k=0; k < 5; k++) code = (code << 8) | nextByte();
+    }
+
+    int bit(Probability& probability, int) {
+        uint32_t bound = (range >> PROBBITS) * probability.zero;
+        int value;
+        if (code < bound) {
+            range = bound;
+            value = 0;
+        } else {
+            code -= bound;
+            range -= bound;
+            value = 1;
+        }
+        probability.update(value);
+        while (range < TOP) {
+            range <<= 8;
+            code = (code << 8) | nextByte();
+        }
+        return value;
+    }
+
+    bool good() const {
+        return !overrun;
+    }
+
+private:
+    uint32_t nextByte() {
+        if (next < end) return *next++;
+        overrun = true;
+        return 0;
+    }
+
+    const unsigned char *next;
+    const unsigned char *end;
+    uint32_t range;
+    uint32_t code;
+    bool overrun;
+};
+
+/*
+ * Which nodes of the row being coded are already joined, through walls that
+ * are down in the rows above it or to their left, as a union-find forest
+ * over the columns of the rectangle (like the sets of Eller's algorithm)
+ */
+class RowSets {
+public:
+    RowSets(int width) : parent(width), last(width), newRoot(width), escapes(width), downYet(width) {}
+
+    int find(int j) {
+        while (parent[j] != j) {
+            parent[j] = parent[parent[j]];
+            j = parent[j];
+        }
+        return j;
+    }
+
+    void join(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return;
+        parent[b] = a;
+        last[a] = std::max(last[a], last[b]);
+        escapes[a] |= escapes[b];
+        downYet[a] |= downYet[b];
+    }
+
+    /*
+     * Start a row: nodes with their up wall down (a 0 bit in downAbove)
+     * carry on the set of the node above, the rest start sets of their own.
+     * edge(j) tells whether a set holding node j might join up with the rest
+     * of the maze outside the rectangle.
+     */
+    template <class Edge>
+    void nextRow(const uint64_t *downAbove, int width, Edge edge) {
+        std::fill(newRoot.begin(), newRoot.end(), -1);
+        above = parent;
+        escapedAbove = escapes;
+        for (int j=0; j < width; j++) {
+            int root = j;
+            escapes[j] = edge(j);
+            if (downAbove && !((downAbove[j / 64] >> (j % 64)) & 1)) {
+                int old = above[j];
+                while (above[old] != old) old = above[old];
+                if (newRoot[old] < 0) {
+                    newRoot[old] = j;
+                    escapes[j] |= escapedAbove[old];
+                } else {
+                    root = newRoot[old];
+                    escapes[root] |= escapes[j];
+                }
+            }
+            parent[j] = root;
+            downYet[j] = 0;
+        }
+        for (int j=0; j < width; j++) last[find(j)] = j;
+    }
+
+    /*
+     * Whether node j is the last of its set in the row and its set can't
+     * get out of the rectangle, so no node to its right can join it
+     */
+    bool closing(int j) {
+        int root = find(j);
+        return last[root] == j && !escapes[root];
+    }
+
+    std::vector<int> parent;
+    std::vector<int> last;
+    std::vector<int> newRoot;
+    std::vector<int> above;
+    std::vector<char> escapes;
+    std::vector<char> escapedAbove;
+    std::vector<char> downYet;
+};
+
+/*
+ * Code the walls of a rectangle, in the same order and with the same
+ * contexts whichever way the coder goes. fill(r, right, down) puts the walls
+ * of row r in the row buffers before it's coded (the encoder's source);
+ * done(r, right, down) is handed the row once it's coded (the decoder's
+ * result).
+ *
+ * Besides the walls around a node, the contexts hold what the sets of
+ * joined nodes say: a right wall between two nodes already joined is up in
+ * a perfect maze, and a node that is the last of its set in the row, in a
+ * set that no down wall has opened yet, has to open one (or, in the last
+ * row, its right wall) or its set would be cut off. These aren't taken for
+ * granted, only learnt.
+ */
+template <class Coder, class Fill, class Done>
+static void codeRect(Coder& coder, int rows, int cols, int top, int left, int height, int width,
+        Fill fill, Done done) {
+    int words = (width + 63) / 64;
+    std::vector<uint64_t> right(words), down(words), rightAbove(words), downAbove(words);
+    std::vector<Probability> rightProbability(RIGHTCONTEXTS), downProbability(DOWNCONTEXTS);
+    RowSets sets(width);
+    bool outsideLeft = left > 0, outsideRight = left + width < cols;
+
+    for (int i=0; i < height; i++) {
+        int r = top + i;
+        std::fill(right.begin(), right.end(), 0);
+        std::fill(down.begin(), down.end(), 0);
+        fill(r, &right[0], &down[0]);
+        bool lastRow = r == rows - 1;
+        sets.nextRow(i > 0 ? &downAbove[0] : NULL, width, [&](int j) {
+            return (i == 0 && top > 0) || (j == 0 && outsideLeft) || (j == width-1 && outsideRight);
+        });
+
+        // Right walls; those outside the rectangle count as up
+        for (int j=0; j < width; j++) {
+            int rightWall = 1;
+            if (left + j != cols - 1) {
+                int joined = j+1 < width && sets.find(j) == sets.find(j+1);
+                int closing = sets.closing(j);
+                int nextLast = j+1 < width && sets.last[sets.find(j+1)] == j+1;
+                int leftWall = j > 0 ? bitAt(&right[0], j-1) : 1;
+                int upWall = i > 0 ? bitAt(&downAbove[0], j) : 1;
+                int aboveRight = i > 0 ? bitAt(&rightAbove[0], j) : 1;
+                int rightUp = i > 0 && j+1 < width ? bitAt(&downAbove[0], j+1) : 1;
+                int context = joined | closing << 1 | lastRow << 2 | leftWall << 3
+                        | upWall << 4 | aboveRight << 5 | rightUp << 6 | nextLast << 7;
+                rightWall = coder.bit(rightProbability[context], bitAt(&right[0], j));
+                setBit(&right[0], j, rightWall);
+                if (!rightWall && j+1 < width) sets.join(j, j+1);
+            }
+        }
+        if (left + width == cols) right[(width - 1) / 64] |= (uint64_t)1 << ((width - 1) % 64);
+
+        // Down walls
+        if (lastRow) {
+            for (int w=0; w < words; w++) down[w] = ~(uint64_t)0;
+        } else {
+            for (int j=0; j < width; j++) {
+                int root = sets.find(j);
+                int closing = sets.closing(j) && !sets.downYet[root];
+                int leftWall = j > 0 ? bitAt(&right[0], j-1) : 1;
+                int upWall = i > 0 ? bitAt(&downAbove[0], j) : 1;
+                int leftDown = j > 0 ? bitAt(&down[0], j-1) : 1;
+                int after = std::min(3, sets.last[root] - j);
+                int context = closing | sets.downYet[root] << 1 | bitAt(&right[0], j) << 2
+                        | leftWall << 3 | upWall << 4 | leftDown << 5 | after << 6;
+                int downWall = coder.bit(downProbability[context], bitAt(&down[0], j));
+                setBit(&down[0], j, downWall);
+                if (!downWall) sets.downYet[root] = 1;
+            }
+        }
+        done(r, &right[0], &down[0]);
+        right.swap(rightAbove);
+        down.swap(downAbove);
+    }
+}
+
+/*
+ * Copy width bits starting at bit left of a row of words
+ */
+static void extractBits(const uint64_t *row, int rowWords, int left, int width, uint64_t *out) {
+    int words = (width + 63) / 64;
+    int shift = left % 64;
+    for (int w=0; w < words; w++) {
+        int k = left / 64 + w;
+        uint64_t bits = row[k] >> shift;
+        if (shift && k + 1 < rowWords) bits |= row[k+1] << (64 - shift);
+        out[w] = bits;
+    }
+    if (width % 64) out[words-1] &= ~(uint64_t)0 >> (64 - width % 64);
+}
+
+void WallCoder::encode(const WallBits& walls, int top, int left, int height, int width,
+        std::vector<char>& bytes) {
+    bytes.clear();
+    RangeEncoder coder(bytes);
+    int rowWords = walls.wordsPerRow();
+    codeRect(coder, walls.numRows(), walls.numCols(), top, left, height, width,
+            [&](int r, uint64_t *right, uint64_t *down) {
+                extractBits(walls.rightRow(r), rowWords, left, width, right);
+                extractBits(walls.downRow(r), rowWords, left, width, down);
+            },
+            [](int, const uint64_t *, const uint64_t *) {});
+    coder.finish();
+}
+
+bool WallCoder::decode(const char *bytes, size_t length, int rows, int cols,
+        int top, int left, int height, int width,
+        const std::function<void(int, const uint64_t *, const uint64_t *)>& row) {
+    RangeDecoder coder(bytes, length);
+    codeRect(coder, rows, cols, top, left, height, width,
+            [](int, uint64_t *, uint64_t *) {},
+            [&](int r, const uint64_t *right, const uint64_t *down) {
+                row(r, right, down);
+            });
+    return coder.good();
+}
+
+#endif /* WALLCODER_CPP_ */
@@ -30,6 +30,7 @@
 #include <wx/dcbuffer.h>
 #include "MazeCutter.h"
 #include "Maze2d.h"
+#include "MazeFile.h"
 #include <iostream>
 #include <algorithm>
 
@@ -41,12 +42,14 @@ EVT_PAINT(MazeCutter::OnPaint)
 END_EVENT_TABLE()
 
 BEGIN_EVENT_TABLE(BasicDrawPane, wxPanel)
+// Editing walls and showing the solution
+EVT_LEFT_DOWN(BasicDrawPane::mouseDown)
+EVT_RIGHT_DOWN(BasicDrawPane::rightClick)
+
 // some useful events
 /*
  EVT_MOTION(BasicDrawPane::mouseMoved)
- EVT_LEFT_DOWN(BasicDrawPane::mouseDown)
  EVT_LEFT_UP(BasicDrawPane::mouseReleased)
- EVT_RIGHT_DOWN(BasicDrawPane::rightClick)
  EVT_LEAVE_WINDOW(BasicDrawPane::mouseLeftWindow)
  EVT_KEY_DOWN(BasicDrawPane::keyPressed)
  EVT_KEY_UP(BasicDrawPane::keyReleased)
@@ -108,6 +111,9 @@ MazeCutter::MazeCutter(const wxString& title)
 	Connect(wxID_NEW, wxEVT_COMMAND_MENU_SELECTED,
 			wxCommandEventHandler(MazeCutter::OnNew));
 
+	Connect(wxID_OPEN, wxEVT_COMMAND_MENU_SELECTED,
+			wxCommandEventHandler(MazeCutter::OnOpen));
+
 	Connect(ID_IMAGEEXPORT, wxEVT_COMMAND_MENU_SELECTED,
 			wxCommandEventHandler(MazeCutter::OnImageExport));
 
@@ -149,6 +155,30 @@ void MazeCutter::OnNew(wxCommandEvent& event) {
 	Refresh();
 }
 
+void MazeCutter::OnOpen(wxCommandEvent& event) {
+	wxFileDialog openDialog(this, _("Open maze"), _(""), _(""),
+				_("Maze files (*.maze)|*.maze"), wxFD_OPEN|wxFD_FILE_MUST_EXIST);
+	if (openDialog.ShowModal() == wxID_CANCEL)
+		return;
+
+	MazeFile mazeFile;
+	WallBits walls;
+	if (!mazeFile.load(std::string(openDialog.GetPath().mb_str()), walls)) {
+		wxMessageBox(wxString(mazeFile.error.c_str(), wxConvUTF8), _("Can't open the maze"),
+				wxOK | wxICON_ERROR, this);
+		return;
+	}
+	if (walls.numRows() > MAXMAZEHEIGHT || walls.numCols() > MAXMAZEWIDTH) {
+		wxMessageBox(_("The maze is too big to draw."), _("Can't open the maze"),
+				wxOK | wxICON_ERROR, this);
+		return;
+	}
+
+	maze = new Maze2d(walls, mazeFile.perfect);
+	drawPane->maze = maze;
+	Refresh();
+}
+
 void MazeCutter::OnImageExport(wxCommandEvent& event) {
     wxFileDialog exportDialog(this, _("Export maze as image"), _(""), _(""),
 				  _("BMP (*.bmp)|*.bmp|JPEG (*.jpg)|*.jpg|PNG (*.png)|*.png|TIFF (*.tif)|*.tif"), wxFD_SAVE|wxFD_OVERWRITE_PROMPT);
@@ -168,6 +198,9 @@ void MazeCutter::OnImageExport(wxCommandEvent& event) {
 BasicDrawPane::BasicDrawPane(wxFrame* parent, Maze2d *maze) :
 		wxPanel(parent)
 {
+	maze_left = maze_top = 0;
+	node_width = node_height = 0;
+	showSolution = false;
 	// SetBackgroundColour(wxColour(1,0,0));
 }
 
@@ -226,6 +259,10 @@ void BasicDrawPane::renderMaze(Maze2d *maze, wxDC &dc) {
 		int verticalMargin = (frameHeight - mazeHeight) / 2;
 		int left = horizontalMargin;
 		int top = verticalMargin;
+		maze_left = left;
+		maze_top = top;
+		node_width = nodeWidth;
+		node_height = nodeHeight;
 
 		for (int r=0; r < maze->numRows(); r++) {
 			for(int c=0; c < maze->numCols(); c++) {
@@ -234,6 +271,27 @@ void BasicDrawPane::renderMaze(Maze2d *maze, wxDC &dc) {
 				renderMazeNode(maze->getCopyOfNode(r, c), maze->numRows(), maze->numCols(), x_base, y_base, nodeWidth, nodeHeight, dc);
 			}
 		}
+
+		// The solution, through the middle of each node on it
+		std::vector<unsigned char> path;
+		if (showSolution && maze->liveSolution(path) >= 0) {
+			wxPen solutionPen(wxColor(200,0,0), wallThickness);
+			dc.SetPen(solutionPen);
+			int x = left + nodeWidth / 2;
+			int y = top + nodeHeight / 2;
+			for (unsigned int step=0; step < path.size(); step++) {
+				int next_x = x, next_y = y;
+				switch (path[step]) {
+				case RIGHT: next_x += nodeWidth; break;
+				case UP:    next_y -= nodeHeight; break;
+				case LEFT:  next_x -= nodeWidth; break;
+				case DOWN:  next_y += nodeHeight; break;
+				}
+				dc.DrawLine(x, y, next_x, next_y);
+				x = next_x;
+				y = next_y;
+			}
+		}
 	}
 
 }
@@ -273,6 +331,31 @@ void BasicDrawPane::OnResize(wxSizeEvent& sizeEvent) {
 	repaint();
 }
 
+void BasicDrawPane::mouseDown(wxMouseEvent& event) {
+	if (maze == NULL || node_width <= 1 || node_height <= 1) return;
+	int x = event.GetX() - maze_left;
+	int y = event.GetY() - maze_top;
+	if (x < 0 || y < 0) return;
+	int r = y / node_height, c = x / node_width;
+	if (r >= maze->numRows() || c >= maze->numCols()) return;
+
+	// Pick the side of the node closest to the click
+	int dx = x - c * node_width, dy = y - r * node_height;
+	int dir = LEFT, closest = dx;
+	if (node_width - dx < closest) { dir = RIGHT; closest = node_width - dx; }
+	if (dy < closest) { dir = UP; closest = dy; }
+	if (node_height - dy < closest) { dir = DOWN; }
+
+	if (maze->setWall(r, c, dir, !maze->getWalls().wall(r, c, dir))) {
+		Refresh();
+	}
+}
+
+void BasicDrawPane::rightClick(wxMouseEvent& event) {
+	showSolution = !showSolution;
+	Refresh();
+}
+
 IMPLEMENT_APP(MazeCutterApp)
 
 bool MazeCutterApp::OnInit()
@@ -64,6 +64,12 @@ class BasicDrawPane : public wxPanel
 
 	int current_width, current_height;
 
+	// Where the last render put the maze, for finding the node under the mouse
+	int maze_left, maze_top, node_width, node_height;
+
+	// Whether to draw the solution over the maze
+	bool showSolution;
+
 public:
 	Maze2d *maze;
 	BasicDrawPane(wxFrame* parent, Maze2d *maze);
@@ -78,13 +84,16 @@ public:
 
 	void OnResize(wxSizeEvent& sizeEvent);
 
+	// Left click raises or knocks down the nearest wall
+	void mouseDown(wxMouseEvent& event);
+	// Right click shows or hides the solution
+	void rightClick(wxMouseEvent& event);
+
 	// some useful events
 	/*
      void mouseMoved(wxMouseEvent& event);
-     void mouseDown(wxMouseEvent& event);
      void mouseWheelMoved(wxMouseEvent& event);
      void mouseReleased(wxMouseEvent& event);
-     void rightClick(wxMouseEvent& event);
      void mouseLeftWindow(wxMouseEvent& event);
      void keyPressed(wxKeyEvent& event);
      void keyReleased(wxKeyEvent& event);
@@ -117,6 +126,7 @@ public:
 	void OnResize(wxSizeEvent& event);
 	void OnQuit(wxCommandEvent& event);
 	void OnNew(wxCommandEvent& event);
+	void OnOpen(wxCommandEvent& event);
 	void OnImageExport(wxCommandEvent& event);
 
 	DECLARE_EVENT_TABLE()
@@ -32,11 +32,27 @@
 #define MAZECUT_CPP_
 
 #include <iostream>
+#include <iomanip>
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
+#include <cerrno>
 #include <string>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <atomic>
 #include "Maze2d.h"
+#include "MazeStats.h"
+#include "MazeFile.h"
+#include "TiledMaze.h"
+#include "MazeImage.h"
+#include "MazeVector.h"
+#include "MazeToolpath.h"
+#include "CompressedMazeFile.h"
+#include "ChunkedMazeFile.h"
+#include "MazeTextReader.h"
+#include "ParallelBands.h"
 #include "constants.h"
 
 extern bool debug, small_debug;
@@ -56,12 +72,68 @@ void showWarrantyInfo();
  */
 void showCopyingInfo();
 
+/**
+ * @brief Generate a maze in tiles paged to disk, save it and report how the
+ * tile cache did
+ */
+int generateTiled(int rows, int cols, const std::string& algorithm, unsigned int seed,
+        long megabytes, const std::string& outputFile, bool stats);
+
+/**
+ * @brief One maze of a batch
+ */
+struct BatchMaze {
+    std::string algorithm;
+    int rows, cols;
+    uint64_t seed;
+};
+
+/**
+ * @brief How the mazes of a batch are finished and written
+ */
+struct BatchOutput {
+    std::string outputFile, metadataFile;
+    bool big, solve, quiet, stats;
+    MazeRenderer::Style style;
+    double braid;
+    int cellPx;
+    double cellMm;
+};
+
+/**
+ * @brief Read the mazes of a batch from a manifest, one to a line as an
+ * algorithm, rows, columns and an optional seed (seed plus the number of the
+ * maze if it's left out); blank lines and lines starting with # are skipped
+ *
+ * @return true if success; otherwise says why on std::cerr
+ */
+bool readManifest(const std::string& path, unsigned int seed, std::vector<BatchMaze>& mazes);
+
+/**
+ * @brief Generate a batch of mazes on one thread per core, write them out in
+ * order, write a line of JSON about each to its own stream, and report mazes
+ * per second
+ */
+int generateBatch(const std::vector<BatchMaze>& mazes, const BatchOutput& output);
+
+/**
+ * @brief Save a maze to a file in the format its name ends in
+ *
+ * @param m the maze, or NULL if it's too big for a Maze2d (it's then only
+ * used through walls)
+ * @param file metadata of the maze
+ * @param report set to a line to show when saving went well, if any
+ * @return true if success; otherwise error says why
+ */
+bool saveMaze(const std::string& path, const WallBits& walls, Maze2d *m, MazeFile& file,
+        bool solve, int cellPx, double cellMm, std::string& error, std::string& report);
+
 /**
  * @brief Implements a basic CLI for generating and solving
  */
 int main (int argc, char * const argv[]) {
 
-    srand(time(0));
+    unsigned int seed = time(0);
 
     int rows=10, cols=10;
 
@@ -70,18 +142,70 @@ int main (int argc, char * const argv[]) {
     bool big = false;
     bool solve = false;
     bool quiet = false;
+    bool stats = false;
+    MazeRenderer::Style style = MazeRenderer::ASCII;
 
     int i;
     unsigned int j;
     char opt;
     std::string algorithm = "rb";
+    std::string inputFile, outputFile;
+    double braid = 0;
+    long tiledMegabytes = 0;
+    int cellPx = 4;
+    double cellMm = 5;
+    long batchCount = 0;
+    std::string manifestFile, metadataFile;
 
     for (i=1; i < argc; i++) {
         if (argv[i][0] == '-') {
-            if (strlen(argv[i]) == 2 && argv[i][1] == 'a') {
+            if (strcmp(argv[i], "--stats") == 0) {
+                stats = true;
+            }
+            else if (strlen(argv[i]) == 2 && argv[i][1] == 'a') {
                 if (i < argc-1) algorithm = argv[++i];
                 else std::cerr << "Warning: -a is not a flag, you need to specify an algorithm\n";
             }
+            else if (strlen(argv[i]) == 2 && argv[i][1] == 'b') {
+                if (i < argc-1) sscanf(argv[++i], "%lf", &braid);
+                else std::cerr << "Warning: -b is not a flag, you need to specify a fraction\n";
+            }
+            else if (strcmp(argv[i], "--cell-px") == 0) {
+                if (i < argc-1) sscanf(argv[++i], "%d", &cellPx);
+                else std::cerr << "Warning: --cell-px is not a flag, you need to specify pixels\n";
+            }
+            else if (strcmp(argv[i], "--cell-mm") == 0) {
+                if (i < argc-1) sscanf(argv[++i], "%lf", &cellMm);
+                else std::cerr << "Warning: --cell-mm is not a flag, you need to specify millimetres\n";
+            }
+            else if (strcmp(argv[i], "--tiled") == 0) {
+                if (i < argc-1) sscanf(argv[++i], "%ld", &tiledMegabytes);
+                else std::cerr << "Warning: --tiled is not a flag, you need to specify megabytes\n";
+            }
+            else if (strcmp(argv[i], "--batch") == 0) {
+                if (i < argc-1) sscanf(argv[++i], "%ld", &batchCount);
+                else std::cerr << "Warning: --batch is not a flag, you need to specify a number of mazes\n";
+            }
+            else if (strcmp(argv[i], "--manifest") == 0) {
+                if (i < argc-1) manifestFile = argv[++i];
+                else std::cerr << "Warning: --manifest is not a flag, you need to specify a file\n";
+            }
+            else if (strcmp(argv[i], "--metadata") == 0) {
+                if (i < argc-1) metadataFile = argv[++i];
+                else std::cerr << "Warning: --metadata is not a flag, you need to specify a file\n";
+            }
+            else if (strcmp(argv[i], "--seed") == 0) {
+                if (i < argc-1) sscanf(argv[++i], "%u", &seed);
+                else std::cerr << "Warning: --seed is not a flag, you need to specify a number\n";
+            }
+            else if (strlen(argv[i]) == 2 && argv[i][1] == 'i') {
+                if (i < argc-1) inputFile = argv[++i];
+                else std::cerr << "Warning: -i is not a flag, you need to specify a file\n";
+            }
+            else if (strlen(argv[i]) == 2 && argv[i][1] == 'o') {
+                if (i < argc-1) outputFile = argv[++i];
+                else std::cerr << "Warning: -o is not a flag, you need to specify a file\n";
+            }
             else {
                 for (j=1; j<strlen(argv[i]); j++) {
                     opt = argv[i][j];
@@ -112,6 +236,9 @@ int main (int argc, char * const argv[]) {
                     case 'q':
                         quiet = true;
                         break;
+                    case 'u':
+                        style = MazeRenderer::UNICODE;
+                        break;
                     default:
                         std::cout << "Warning: unknown flag '-";
                         std::cout << opt << "'\n";
@@ -123,20 +250,10 @@ int main (int argc, char * const argv[]) {
         else { // it has to be a number
             if (!rows_set) {
                 sscanf(argv[i], "%d", &rows);
-                if (rows > MAXMAZEHEIGHT) {
-                    std::cout << "Warning: max height is ";
-                    std::cout << MAXMAZEHEIGHT << ". ";
-                    std::cout << "Initializing rows to " << MAXMAZEHEIGHT << ".\n";
-                }
                 rows_set = true;
             }
             else if (!cols_set) {
                 sscanf(argv[i], "%d", &cols);
-                if (cols > MAXMAZEWIDTH) {
-                    std::cout << "Warning: max width is ";
-                    std::cout << MAXMAZEWIDTH << ". ";
-                    std::cout << "Initializing cols to " << MAXMAZEWIDTH << ".\n";
-                }
                 cols_set = true;
             }
         }
@@ -154,11 +271,424 @@ int main (int argc, char * const argv[]) {
 		}
         return 0;
     }
+    srand(seed);
+
+    // Many mazes from one run, each from its own seed
+    if (batchCount > 0 || !manifestFile.empty()) {
+        if (!inputFile.empty() || tiledMegabytes > 0) {
+            std::cerr << "Error: --batch and --manifest generate mazes; they can't be used with -i or --tiled\n";
+            return 1;
+        }
+        std::vector<BatchMaze> mazes;
+        if (!manifestFile.empty()) {
+            if (!readManifest(manifestFile, seed, mazes)) return 1;
+        }
+        else if (rows < 1 || cols < 1) {
+            std::cerr << "Error: the mazes need at least one row and one column\n";
+            return 1;
+        }
+        else if (!Maze2d::isAlgorithm(algorithm)) {
+            std::cerr << "Error: algorithm \"" << algorithm << "\" not recognized\n";
+            return 1;
+        }
+        else {
+            for (long k = 0; k < batchCount; k++) {
+                BatchMaze maze = {algorithm, rows, cols, (uint64_t) seed + k};
+                mazes.push_back(maze);
+            }
+        }
+        BatchOutput output = {outputFile, metadataFile, big, solve, quiet, stats, style, braid, cellPx, cellMm};
+        return generateBatch(mazes, output);
+    }
+
+    // Mazes kept in tiles can be any size
+    if (tiledMegabytes > 0) {
+        return generateTiled(rows, cols, algorithm, seed, tiledMegabytes, outputFile, stats);
+    }
+    if (rows > MAXMAZEHEIGHT) {
+        std::cout << "Warning: max height is ";
+        std::cout << MAXMAZEHEIGHT << ". ";
+        std::cout << "Initializing rows to " << MAXMAZEHEIGHT << ".\n";
+    }
+    if (cols > MAXMAZEWIDTH) {
+        std::cout << "Warning: max width is ";
+        std::cout << MAXMAZEWIDTH << ". ";
+        std::cout << "Initializing cols to " << MAXMAZEWIDTH << ".\n";
+    }
+
+    // Generate the maze, or map it from a file
+    MazeFile file;
+    WallBits loaded;
+    Maze2d *m = NULL;
+    if (inputFile.empty()) {
+        if (rows < 1 || cols < 1) {
+            std::cerr << "Error: the maze needs at least one row and one column\n";
+            return 1;
+        }
+        if (!Maze2d::isAlgorithm(algorithm)) {
+            std::cerr << "Error: algorithm \"" << algorithm << "\" not recognized\n";
+            return 1;
+        }
+        m = new Maze2d(rows, cols, algorithm, seed);
+        file.algorithm = algorithm;
+        file.seed = seed;
+    }
+    else {
+        if (CompressedMazeFile::isCompressed(inputFile)) {
+            CompressedMazeFile compressed;
+            if (!compressed.load(inputFile, loaded)) {
+                std::cerr << "Error: can't load " << inputFile << ": " << compressed.error << "\n";
+                return 1;
+            }
+            file.algorithm = compressed.algorithm;
+            file.seed = compressed.seed;
+            file.perfect = compressed.perfect;
+        }
+        else if (ChunkedMazeFile::isChunked(inputFile)) {
+            ChunkedMazeFile chunked;
+            if (!chunked.load(inputFile, loaded)) {
+                std::cerr << "Error: can't load " << inputFile << ": " << chunked.error << "\n";
+                return 1;
+            }
+            file.algorithm = chunked.algorithm;
+            file.seed = chunked.seed;
+            file.perfect = chunked.perfect;
+        }
+        else if (MazeTextReader::isText(inputFile)) {
+            MazeTextReader reader;
+            if (!reader.load(inputFile, loaded)) {
+                std::cerr << "Error: can't load " << inputFile << ": " << reader.error << "\n";
+                return 1;
+            }
+            file.perfect = reader.perfect;
+        }
+        else if (!file.load(inputFile, loaded)) {
+            std::cerr << "Error: can't load " << inputFile << ": " << file.error << "\n";
+            return 1;
+        }
+        // Mazes too big to draw are only used through their walls
+        if (loaded.numRows() <= MAXMAZEHEIGHT && loaded.numCols() <= MAXMAZEWIDTH) {
+            m = new Maze2d(loaded, file.perfect);
+        }
+        else if (file.perfect) {
+            file.perfect = loaded.isSpanningTree();
+        }
+    }
+
+    if (braid > 0) {
+        if (m) m->braid(braid);
+        else if (loaded.braid(braid, rand()) > 0) file.perfect = false;
+    }
+    if (m) file.perfect = m->isPerfect();
+    const WallBits& walls = m ? m->getWalls() : loaded;
+
+    if (!outputFile.empty()) {
+        std::string error, report;
+        if (!saveMaze(outputFile, walls, m, file, solve, cellPx, cellMm, error, report)) {
+            std::cerr << "Error: can't save " << outputFile << ": " << error << "\n";
+        }
+        std::cerr << report;
+    }
+    if (stats) {
+        MazeStats mazeStats;
+        mazeStats.compute(walls);
+        mazeStats.writeJson(std::cout);
+    }
+    else if (!quiet) {
+        if (m && big) m->drawBig(solve, style);
+        else if (m) m->draw(style);
+        else if (solve) std::cerr << "The maze is too big to solve; use --stats or -o\n";
+        else if (big) MazeRenderer(style).drawBig(walls);
+        else MazeRenderer(style).draw(walls);
+    }
+    delete m;
+    return 0;
+}
+
+bool saveMaze(const std::string& path, const WallBits& walls, Maze2d *m, MazeFile& file,
+        bool solve, int cellPx, double cellMm, std::string& error, std::string& report) {
+    MazeImage::Format imageFormat;
+    MazeVector::Format drawingFormat;
+    MazeToolpath::Format toolpathFormat;
+    if (MazeToolpath::formatOf(path, toolpathFormat)) {
+        MazeToolpath toolpath(cellMm);
+        toolpath.plan(walls);
+        if (!toolpath.save(path, toolpathFormat)) {
+            error = toolpath.error;
+            return false;
+        }
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(1);
+        line << "Toolpath: " << toolpath.numStrokes() << " strokes, "
+                << toolpath.cutLength() << " mm cutting, "
+                << toolpath.travelLength() << " mm travel ("
+                << toolpath.unorderedTravelLength() << " mm unordered)\n";
+        report = line.str();
+        return true;
+    }
+    if (MazeVector::formatOf(path, drawingFormat)) {
+        MazeVector drawing(drawingFormat, cellPx);
+        if (!drawing.save(path, walls)) error = drawing.error;
+        return error.empty();
+    }
+    if (MazeImage::formatOf(path, imageFormat)) {
+        // Shade the solution in images of solved mazes
+        std::vector<uint64_t> onPath;
+        if (solve && m) m->findSolution(onPath);
+        MazeImage image(imageFormat, cellPx);
+        if (!image.save(path, walls, onPath.empty() ? NULL : &onPath)) error = image.error;
+        return error.empty();
+    }
+    if (CompressedMazeFile::isCompressed(path)) {
+        CompressedMazeFile compressed;
+        compressed.algorithm = file.algorithm;
+        compressed.seed = file.seed;
+        compressed.perfect = file.perfect;
+        if (!compressed.save(path, walls)) error = compressed.error;
+        return error.empty();
+    }
+    if (ChunkedMazeFile::isChunked(path)) {
+        ChunkedMazeFile chunked;
+        chunked.algorithm = file.algorithm;
+        chunked.seed = file.seed;
+        chunked.perfect = file.perfect;
+        if (!chunked.save(path, walls)) error = chunked.error;
+        return error.empty();
+    }
+    if (!file.save(path, walls)) error = file.error;
+    return error.empty();
+}
+
+/**
+ * @brief Quote a string for JSON
+ */
+static std::string batchJsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (std::string::size_type k = 0; k < text.size(); k++) {
+        unsigned char c = text[k];
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (c < 0x20) {
+            char escape[8];
+            snprintf(escape, sizeof escape, "\\u%04x", c);
+            quoted += escape;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+bool readManifest(const std::string& path, unsigned int seed, std::vector<BatchMaze>& mazes) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+        std::cerr << "Error: can't open the manifest " << path << "\n";
+        return false;
+    }
+    std::string text;
+    for (int number = 1; std::getline(in, text); number++) {
+        std::istringstream fields(text);
+        BatchMaze maze;
+        if (!(fields >> maze.algorithm) || maze.algorithm[0] == '#') continue;
+        if (!(fields >> maze.rows >> maze.cols) || maze.rows < 1 || maze.cols < 1) {
+            std::cerr << "Error: line " << number << " of " << path
+                    << " needs an algorithm, a number of rows and a number of columns\n";
+            return false;
+        }
+        if (!Maze2d::isAlgorithm(maze.algorithm)) {
+            std::cerr << "Error: line " << number << " of " << path << ": algorithm \""
+                    << maze.algorithm << "\" not recognized\n";
+            return false;
+        }
+        unsigned long long mazeSeed;
+        if (fields >> mazeSeed) maze.seed = mazeSeed;
+        else maze.seed = (uint64_t) seed + mazes.size();
+        mazes.push_back(maze);
+    }
+    return true;
+}
 
-    Maze2d m(rows, cols, algorithm);
-    if (!quiet) {
-        if (big) m.drawBig(solve);
-        else m.draw();
+int generateBatch(const std::vector<BatchMaze>& mazes, const BatchOutput& output) {
+    // With %d in the name each maze is saved to a file of its own, named with
+    // its number, in the format the name ends in
+    std::string::size_type slot = output.outputFile.find("%d");
+    bool perFile = slot != std::string::npos;
+    if (!output.outputFile.empty() && !perFile) {
+        std::cerr << "Error: with --batch or --manifest, the -o name needs %d in it, "
+                << "so that each maze is saved to a file of its own\n";
+        return 1;
+    }
+
+    // The mazes are drawn to the screen unless they're saved; the lines of
+    // JSON go to --metadata ("-" for the screen, drawings or not), or to the
+    // screen if nothing is drawn there
+    bool draw = !perFile && !output.quiet;
+    FILE *meta = NULL;
+    if (output.metadataFile == "-" || (output.metadataFile.empty() && !draw)) {
+        meta = stdout;
+    }
+    else if (!output.metadataFile.empty()) {
+        meta = fopen(output.metadataFile.c_str(), "w");
+        if (!meta) {
+            std::cerr << "Error: can't open " << output.metadataFile << ": " << strerror(errno) << "\n";
+            return 1;
+        }
+    }
+
+    // Each maze is generated, saved and formatted on whichever thread gets
+    // it, from its own seed, and the text is written in order of the mazes.
+    // Its bytes are the length of its line of JSON, the line, and then the
+    // drawing.
+    std::atomic<long> failed(0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    forEachChunkInOrder((long) mazes.size(), 1,
+        [&](long k, long, std::vector<char>& bytes) {
+            const BatchMaze& job = mazes[k];
+            Maze2d m(job.rows, job.cols, job.algorithm, job.seed);
+            if (output.braid > 0) m.braid(output.braid);
+            const WallBits& walls = m.getWalls();
+
+            std::ostringstream line;
+            line << "{\"index\": " << k << ", \"algorithm\": " << batchJsonString(job.algorithm)
+                    << ", \"rows\": " << walls.numRows() << ", \"cols\": " << walls.numCols()
+                    << ", \"seed\": " << job.seed
+                    << ", \"perfect\": " << (m.isPerfect() ? "true" : "false");
+            if (job.rows > MAXMAZEHEIGHT || job.cols > MAXMAZEWIDTH) {
+                line << ", \"clamped\": true, \"requested_rows\": " << job.rows
+                        << ", \"requested_cols\": " << job.cols;
+            }
+            if (perFile) {
+                std::string path = output.outputFile;
+                std::ostringstream number;
+                number << k;
+                path.replace(slot, 2, number.str());
+                MazeFile file;
+                file.algorithm = job.algorithm;
+                file.seed = job.seed;
+                file.perfect = m.isPerfect();
+                std::string error, report;
+                line << ", \"file\": " << batchJsonString(path);
+                if (!saveMaze(path, walls, &m, file, output.solve, output.cellPx, output.cellMm,
+                        error, report)) {
+                    line << ", \"error\": " << batchJsonString(error);
+                    failed++;
+                }
+            }
+            if (output.stats) {
+                MazeStats mazeStats;
+                mazeStats.compute(walls);
+                std::ostringstream json;
+                mazeStats.writeJson(json);
+                std::string text = json.str();
+                while (!text.empty() && text[text.size() - 1] == '\n') text.erase(text.size() - 1);
+                line << ", \"stats\": " << text;
+            }
+            line << "}\n";
+            std::string text = line.str();
+            uint64_t length = meta ? text.size() : 0;
+            bytes.resize(sizeof length);
+            memcpy(&bytes[0], &length, sizeof length);
+            bytes.insert(bytes.end(), text.begin(), text.begin() + length);
+
+            if (draw) {
+                std::vector<uint64_t> onPath;
+                if (output.solve) m.findSolution(onPath);
+                MazeRenderer(output.style).drawInto(walls, output.big,
+                        output.solve ? &onPath : NULL, bytes);
+            }
+        },
+        [&](const std::vector<char>& bytes) {
+            uint64_t length;
+            memcpy(&length, &bytes[0], sizeof length);
+            size_t drawing = sizeof length + length;
+            if (length > 0) fwrite(&bytes[sizeof length], 1, length, meta);
+            if (bytes.size() > drawing) fwrite(&bytes[drawing], 1, bytes.size() - drawing, stdout);
+        });
+    bool written = fflush(stdout) == 0 && !ferror(stdout);
+    bool metaWritten = !meta || meta == stdout || (fflush(meta) == 0 && !ferror(meta));
+    if (meta && meta != stdout) metaWritten = fclose(meta) == 0 && metaWritten;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << "Generated " << mazes.size() << " mazes in " << std::fixed
+            << std::setprecision(3) << seconds << " s (" << std::setprecision(0)
+            << (seconds > 0 ? mazes.size() / seconds : 0) << " mazes per second)\n";
+    if (!written) {
+        std::cerr << "Error: can't write the mazes\n";
+        return 1;
+    }
+    if (!metaWritten) {
+        std::cerr << "Error: can't write " << output.metadataFile << "\n";
+        return 1;
+    }
+    if (failed > 0) {
+        std::cerr << "Error: " << failed << " of the mazes couldn't be saved\n";
+        return 1;
+    }
+    return 0;
+}
+
+int generateTiled(int rows, int cols, const std::string& algorithm, unsigned int seed,
+        long megabytes, const std::string& outputFile, bool stats) {
+    if (rows < 1 || cols < 1) {
+        std::cerr << "Error: the maze needs at least one row and one column\n";
+        return 1;
+    }
+    TiledMaze tiled(rows, cols, megabytes << 20,
+            outputFile.empty() ? std::string() : outputFile + ".tiles");
+    if (algorithm == "rb" || algorithm == "recursivebacktracking") {
+        tiled.rb();
+    } else if (algorithm == "w" || algorithm == "wilson" || algorithm == "wilsons") {
+        tiled.wilsons();
+    } else {
+        std::cerr << "Algorithm \"" << algorithm << "\" can't be used with --tiled; use rb or w.\n";
+        return 1;
+    }
+
+    MazeImage::Format imageFormat;
+    MazeVector::Format drawingFormat;
+    MazeToolpath::Format toolpathFormat;
+    if (!outputFile.empty() && (MazeImage::formatOf(outputFile, imageFormat)
+            || MazeVector::formatOf(outputFile, drawingFormat)
+            || MazeToolpath::formatOf(outputFile, toolpathFormat)
+            || CompressedMazeFile::isCompressed(outputFile)
+            || ChunkedMazeFile::isChunked(outputFile))) {
+        std::cerr << "Error: --tiled saves .maze files; load one with -i to convert it\n";
+        return 1;
+    }
+    if (!outputFile.empty()) {
+        MazeFile file;
+        file.algorithm = algorithm;
+        file.seed = seed;
+        bool ok = file.create(outputFile, rows, cols);
+        tiled.forEachRow([&](const uint64_t *right, const uint64_t *down) {
+            ok = ok && file.appendRow(right, down);
+        });
+        if (!ok || !file.finish()) {
+            std::cerr << "Error: can't save " << outputFile << ": " << file.error << "\n";
+            return 1;
+        }
+    }
+    if (!tiled.good()) {
+        std::cerr << "Error: the tile file couldn't be read or written\n";
+        return 1;
+    }
+
+    if (stats) {
+        const TileCacheStats& cache = tiled.cacheStats();
+        std::cout << "{\"rows\": " << rows << ", \"cols\": " << cols;
+        std::cout << ", \"cache_tiles\": " << tiled.numSlots();
+        std::cout << ", \"cell_accesses\": " << cache.cellAccesses;
+        std::cout << ", \"tile_lookups\": " << cache.tileLookups;
+        std::cout << ", \"hit_ratio\": " << cache.hitRatio();
+        std::cout << ", \"page_ins\": " << cache.pageIns;
+        std::cout << ", \"page_ins_per_million_accesses\": "
+                << (cache.cellAccesses > 0 ? 1e6 * cache.pageIns / cache.cellAccesses : 0);
+        std::cout << ", \"write_backs\": " << cache.writeBacks;
+        std::cout << ", \"prefetches\": " << cache.prefetches << "}\n";
+    }
+    else if (outputFile.empty()) {
+        std::cerr << "A maze generated with --tiled isn't drawn; use --stats or -o\n";
     }
     return 0;
 }
@@ -168,7 +698,7 @@ void printHelp() {
     std::cout << "| mazecut -- a c++ program that automatically generates mazes |\n";
     std::cout << "---------------------------------------------------------------\n";
     std::cout << "\n";
-    std::cout << "Usage: mazecut [FLAGS] [-a [algorithm]] <rows> <columns>\n";
+    std::cout << "Usage: mazecut [FLAGS] [-a [algorithm]] [-b [fraction]] [-i [file]] [-o [file]] [--cell-px [pixels]] [--cell-mm [mm]] [--tiled [MB]] [--stats] [--seed [seed]] [--batch [N] | --manifest [file]] [--metadata [file]] <rows> <columns>\n";
     std::cout << "\n";
     std::cout << "Available options:\n\n";
 
@@ -184,7 +714,36 @@ void printHelp() {
     std::cout << "\t-d\t\t\tShow a little debugging information\n";
     std::cout << "\t-D\t\t\tShow all debugging information (there's a lot)\n";
     std::cout << "\t-q\t\t\tQuiet mode - no output\n";
+    std::cout << "\t-u\t\t\tDraw with Unicode box-drawing characters\n";
     std::cout << "\t-a [algorithm]\t\tUse a particular algorithm to generate the maze\n";
+    std::cout << "\t-b [fraction]\t\tBraid the maze: remove this fraction (0 to 1) of the dead ends\n";
+    std::cout << "\t-i [file]\t\tLoad the maze from a .maze, .mzz or .mzc file, or a .txt file\n";
+    std::cout << "\t\t\t\tof a maze drawn by mazecut (with or without -l), instead\n";
+    std::cout << "\t\t\t\tof generating it\n";
+    std::cout << "\t-o [file]\t\tSave the maze to a .maze file, or compressed if the name ends\n";
+    std::cout << "\t\t\t\tin .mzz, or in chunks that can be read a window at a time if\n";
+    std::cout << "\t\t\t\tit ends in .mzc, or an image if it ends in .png, .pbm or .pgm\n";
+    std::cout << "\t\t\t\t(with -s, the solution is shaded), or a drawing if it ends in\n";
+    std::cout << "\t\t\t\t.svg or .pdf, or a toolpath for a cutter if it ends in .dxf,\n";
+    std::cout << "\t\t\t\t.nc, .ngc, .gcode, .plt or .hpgl\n";
+    std::cout << "\t--cell-px [pixels]\tPixels along the side of a node in images and drawings\n";
+    std::cout << "\t\t\t\t(default 4)\n";
+    std::cout << "\t--cell-mm [mm]\t\tMillimetres along the side of a node in toolpaths (default 5)\n";
+    std::cout << "\t--tiled [MB]\t\tGenerate a maze of any size in tiles on disk, caching MB\n";
+    std::cout << "\t\t\t\tmegabytes of them (rb and w only; save it with -o)\n";
+    std::cout << "\t--stats\t\t\tPrint statistics of the maze as JSON instead of drawing it\n";
+    std::cout << "\t--seed [seed]\t\tSeed the random numbers (default: the time), so the same\n";
+    std::cout << "\t\t\t\tseed gives the same maze\n";
+    std::cout << "\t--batch [N]\t\tGenerate N mazes, from seeds seed, seed+1, ..., on one\n";
+    std::cout << "\t\t\t\tthread per core, and report mazes per second. Each maze\n";
+    std::cout << "\t\t\t\tis drawn to the screen (unless -q), or saved with -o to a\n";
+    std::cout << "\t\t\t\tname with %d in it, replaced by the number of the maze\n";
+    std::cout << "\t--manifest [file]\tLike --batch, but generate the mazes listed in the file,\n";
+    std::cout << "\t\t\t\tone per line as: algorithm rows columns [seed]\n";
+    std::cout << "\t--metadata [file]\tWrite a line of JSON about each maze of a batch (with\n";
+    std::cout << "\t\t\t\t--stats, its statistics too) to the file, or to the screen\n";
+    std::cout << "\t\t\t\twith the drawings if it's -; without it the lines go to\n";
+    std::cout << "\t\t\t\tthe screen only when the mazes aren't drawn there\n";
     std::cout << "\n";
 
     std::cout << "\tAlgorithm options (use -a [algorithm])\n\n";
@@ -194,6 +753,8 @@ void printHelp() {
     std::cout << "\tab, aldousbroder, aldousbroders\t\tUse Aldous-Broder algorithm\n";
     std::cout << "\tw, wilson, wilsons\t\t\tUse Wilson's algorithm\n";
     std::cout << "\tbt, binarytree\t\t\t\tUse binary tree\n";
+    std::cout << "\tca, maze\t\t\t\tUse the Maze cellular automaton (has loops)\n";
+    std::cout << "\tmc, mazectric\t\t\t\tUse the Mazectric cellular automaton (has loops)\n";
     std::cout << "\n";
 }
 
@@ -0,0 +1,192 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file check.h
+ * @brief Contains the helpers shared by the checks run by make check.
+ *
+ * Each check is a program of its own that prints done and exits with 0 if
+ * everything held, or prints what didn't and exits with 1.
+ */
+
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "constants.h"
+#include "WallBits.h"
+#include "Maze2d.h"
+
+/**
+ * @brief Number of checks made so far
+ */
+static long checksRun = 0;
+
+/**
+ * @brief Number of checks that failed so far
+ */
+static long checksFailed = 0;
+
+/**
+ * @brief Check that a condition holds, and if it doesn't, say where and
+ * what it was about (anything that can be written to a stream)
+ */
+#define CHECK(condition, what) do { \
+        checksRun++; \
+        if (!(condition)) { \
+            if (checksFailed++ == 0) std::cout << "\n"; \
+            std::cout << __FILE__ << ":" << __LINE__ << ": " << #condition \
+                    << " failed: " << what << "\n"; \
+        } \
+    } while (0)
+
+/**
+ * @brief Say how the checks went
+ *
+ * @return the exit code for main()
+ */
+inline int checkResult() {
+    if (checksFailed > 0) {
+        std::cout << checksFailed << " of " << checksRun << " checks failed\n";
+        return 1;
+    }
+    std::cout << "done (" << checksRun << " checks)\n";
+    return 0;
+}
+
+/**
+ * @brief Sizes every check is run on: single rows and columns, and widths on
+ * either side of the 64 nodes in a word of walls
+ */
+static const int CHECKSIZES[][2] = {
+    {1, 1}, {1, 37}, {37, 1}, {2, 2}, {1, 64}, {65, 1},
+    {9, 63}, {8, 64}, {7, 65}, {20, 129}, {31, 31}
+};
+
+/**
+ * @brief Number of entries in CHECKSIZES
+ */
+static const int NUMCHECKSIZES = sizeof CHECKSIZES / sizeof CHECKSIZES[0];
+
+/**
+ * @brief Algorithms of the mazes that are checked; the last two make loops
+ */
+static const char *const CHECKALGORITHMS[] = {"rb", "e", "ab", "w", "bt", "p", "s", "ca", "mc"};
+
+/**
+ * @brief Number of entries in CHECKALGORITHMS
+ */
+static const int NUMCHECKALGORITHMS = sizeof CHECKALGORITHMS / sizeof CHECKALGORITHMS[0];
+
+/**
+ * @brief Call f with every maze that is checked
+ *
+ * Each algorithm makes a maze of each size, as it is and braided twice over,
+ * from a seed that depends only on which maze it is. f gets a name for the
+ * maze, to show if a check fails.
+ */
+template <typename F>
+void forEachCheckMaze(F f) {
+    static const double braids[] = {0, 0.5, 1};
+    unsigned int seed = 1;
+    for (int s=0; s < NUMCHECKSIZES; s++) {
+        for (int a=0; a < NUMCHECKALGORITHMS; a++) {
+            for (int b=0; b < 3; b++) {
+                srand(seed++);
+                Maze2d m(CHECKSIZES[s][0], CHECKSIZES[s][1], CHECKALGORITHMS[a]);
+                if (braids[b] > 0) m.braid(braids[b]);
+                std::ostringstream name;
+                name << CHECKALGORITHMS[a] << " " << CHECKSIZES[s][0] << "x"
+                        << CHECKSIZES[s][1] << " braided " << braids[b];
+                f(name.str(), m);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Find the distance from one node to every node with a plain
+ * breadth-first search, to check the solvers against
+ *
+ * @return rows*columns distances in row-major order, -1 for nodes that
+ * can't be reached
+ */
+inline std::vector<int> checkDistances(const WallBits& walls, int r, int c) {
+    int rows = walls.numRows(), cols = walls.numCols();
+    std::vector<int> distances((size_t) rows * cols, -1);
+    std::vector<int> queue(1, r * cols + c);
+    distances[r * cols + c] = 0;
+    for (size_t head=0; head < queue.size(); head++) {
+        int i = queue[head];
+        int nr = i / cols, nc = i % cols;
+        for (int dir=RIGHT; dir <= DOWN; dir++) {
+            if (walls.wall(nr, nc, dir)) continue;
+            // The boundary should always be up, but don't trust it
+            if ((dir == RIGHT && nc == cols-1) || (dir == DOWN && nr == rows-1)) continue;
+            int next = i + (dir == RIGHT ? 1 : dir == LEFT ? -1 : dir == DOWN ? cols : -cols);
+            if (distances[next] >= 0) continue;
+            distances[next] = distances[i] + 1;
+            queue.push_back(next);
+        }
+    }
+    return distances;
+}
+
+/**
+ * @brief Tell whether a path leads from one node to another through open
+ * walls only
+ */
+inline bool checkPath(const WallBits& walls, int r, int c, int end_r, int end_c,
+        const std::vector<unsigned char>& path) {
+    for (size_t step=0; step < path.size(); step++) {
+        if (path[step] > DOWN || walls.wall(r, c, path[step])) return false;
+        switch (path[step]) {
+        case RIGHT: c++; break;
+        case UP:    r--; break;
+        case LEFT:  c--; break;
+        case DOWN:  r++; break;
+        }
+        if (r >= walls.numRows() || c >= walls.numCols()) return false;
+    }
+    return r == end_r && c == end_c;
+}
+
+/**
+ * @brief Tell whether the open walls of a maze make a spanning tree (the
+ * maze is perfect)
+ */
+inline bool checkIsTree(const WallBits& walls) {
+    int rows = walls.numRows(), cols = walls.numCols();
+    std::vector<int> distances = checkDistances(walls, 0, 0);
+    long open = 0;
+    for (int r=0; r < rows; r++) {
+        for (int c=0; c < cols; c++) {
+            if (distances[r * cols + c] < 0) return false;
+            if (c < cols-1 && !walls.wall(r, c, RIGHT)) open++;
+            if (r < rows-1 && !walls.wall(r, c, DOWN)) open++;
+        }
+    }
+    return open == (long) rows * cols - 1;
+}
+
+#endif /* CHECK_H_ */
@@ -0,0 +1,180 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file checkFiles.cpp
+ * @brief Checks that mazes come back from every file format they are saved
+ * in with the same walls and metadata.
+ */
+
+#ifndef CHECKFILES_CPP_
+#define CHECKFILES_CPP_
+
+#include <cstdio>
+#include <unistd.h>
+#include "check.h"
+#include "MazeFile.h"
+#include "CompressedMazeFile.h"
+#include "MazeRenderer.h"
+#include "MazeTextReader.h"
+#include "ChunkedMazeFile.h"
+
+/**
+ * @brief Tell whether part of one maze has the same walls as another, except
+ * for the right and bottom edges of the part, which should be up
+ *
+ * @param whole the maze
+ * @param part the part, which should have come from whole
+ * @param top row of whole where part starts
+ * @param left column of whole where part starts
+ */
+static bool sameWalls(const WallBits& whole, const WallBits& part, int top = 0, int left = 0) {
+    int rows = part.numRows(), cols = part.numCols();
+    for (int r=0; r < rows; r++) {
+        for (int c=0; c < cols; c++) {
+            bool right = c == cols-1 || whole.wall(top + r, left + c, RIGHT);
+            bool down = r == rows-1 || whole.wall(top + r, left + c, DOWN);
+            if (part.wall(r, c, RIGHT) != right || part.wall(r, c, DOWN) != down) return false;
+            if (part.wall(r, c, UP) != (r == 0 || whole.wall(top + r, left + c, UP))) return false;
+            if (part.wall(r, c, LEFT) != (c == 0 || whole.wall(top + r, left + c, LEFT))) return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    const char *dir = getenv("TMPDIR");
+    std::ostringstream base;
+    base << (dir ? dir : "/tmp") << "/mazecut-check-" << getpid();
+    std::string path = base.str();
+    unsigned int number = 0;
+
+    forEachCheckMaze([&](const std::string& name, Maze2d& m) {
+        const WallBits& walls = m.getWalls();
+        int rows = walls.numRows(), cols = walls.numCols();
+        bool tree = checkIsTree(walls);
+        uint64_t seed = 0x123456789abcdefULL + number++;
+
+        MazeFile file;
+        file.algorithm = name;
+        file.seed = seed;
+        file.perfect = tree;
+        CHECK(file.save(path + ".maze", walls), name << ": can't save .maze: " << file.error);
+        WallBits loaded;
+        MazeFile read;
+        bool ok = read.load(path + ".maze", loaded);
+        CHECK(ok, name << ": can't load .maze: " << read.error);
+        if (ok) {
+            CHECK(loaded.numRows() == rows && loaded.numCols() == cols && sameWalls(walls, loaded),
+                    name << ": the .maze came back different");
+            CHECK(read.algorithm == name && read.seed == seed && read.perfect == tree,
+                    name << ": the .maze metadata came back different");
+            // A maze with loops that claims to be perfect isn't believed
+            Maze2d claimed(loaded, true);
+            CHECK(claimed.isPerfect() == tree, name << ": a maze that claims to be perfect is "
+                    << (tree ? "not " : "") << "taken as perfect");
+        }
+
+        CompressedMazeFile compressed;
+        compressed.algorithm = name;
+        compressed.seed = seed;
+        compressed.perfect = tree;
+        CHECK(compressed.save(path + ".mzz", walls), name << ": can't save .mzz: "
+                << compressed.error);
+        CompressedMazeFile decompressed;
+        ok = decompressed.load(path + ".mzz", loaded);
+        CHECK(ok, name << ": can't load .mzz: " << decompressed.error);
+        if (ok) {
+            CHECK(loaded.numRows() == rows && loaded.numCols() == cols && sameWalls(walls, loaded),
+                    name << ": the .mzz came back different");
+            CHECK(decompressed.algorithm == name && decompressed.seed == seed
+                    && decompressed.perfect == tree, name << ": the .mzz metadata came back different");
+        }
+        int first = rows / 3, count = rows - first > 1 ? (rows - first) / 2 + 1 : 1;
+        ok = decompressed.loadRows(path + ".mzz", first, count, loaded);
+        CHECK(ok, name << ": can't load rows of .mzz: " << decompressed.error);
+        if (ok) {
+            CHECK(loaded.numRows() == count && loaded.numCols() == cols
+                    && sameWalls(walls, loaded, first, 0),
+                    name << ": rows " << first << " to " << first + count - 1
+                    << " of the .mzz came back different");
+        }
+
+        // Drawn both sizes, and read back from the text
+        for (int big=0; big < 2; big++) {
+            FILE *text = tmpfile();
+            CHECK(text != NULL, "can't make a temporary file");
+            if (!text) break;
+            MazeRenderer renderer(MazeRenderer::ASCII, text);
+            if (big) renderer.drawBig(walls);
+            else renderer.draw(walls);
+            std::vector<char> drawn(ftell(text));
+            rewind(text);
+            ok = drawn.empty() || fread(&drawn[0], 1, drawn.size(), text) == drawn.size();
+            fclose(text);
+            CHECK(ok, name << ": can't read the drawing back");
+            MazeTextReader reader;
+            ok = ok && reader.parse(drawn.empty() ? NULL : &drawn[0], drawn.size(), loaded);
+            CHECK(ok, name << ": can't read the " << (big ? "big " : "") << "drawing: "
+                    << reader.error);
+            if (ok) {
+                CHECK(loaded.numRows() == rows && loaded.numCols() == cols
+                        && sameWalls(walls, loaded) && reader.big == (big != 0),
+                        name << ": the " << (big ? "big " : "") << "drawing came back different");
+                CHECK(reader.perfect == tree, name << ": the " << (big ? "big " : "")
+                        << "drawing was read as " << (tree ? "not " : "") << "perfect");
+            }
+        }
+
+        ChunkedMazeFile chunked;
+        chunked.algorithm = name;
+        chunked.seed = seed;
+        chunked.perfect = tree;
+        chunked.chunkSize = 16;
+        CHECK(chunked.save(path + ".mzc", walls), name << ": can't save .mzc: " << chunked.error);
+        ChunkedMazeFile window;
+        ok = window.load(path + ".mzc", loaded);
+        CHECK(ok, name << ": can't load .mzc: " << window.error);
+        if (ok) {
+            CHECK(loaded.numRows() == rows && loaded.numCols() == cols && sameWalls(walls, loaded),
+                    name << ": the .mzc came back different");
+            CHECK(window.algorithm == name && window.seed == seed && window.perfect == tree
+                    && window.chunkSize == 16, name << ": the .mzc metadata came back different");
+        }
+        ok = window.open(path + ".mzc");
+        CHECK(ok, name << ": can't open .mzc: " << window.error);
+        int top = rows / 4, left = cols / 3;
+        int height = rows - top > 1 ? (rows - top) / 2 + 1 : 1;
+        int width = cols - left > 1 ? cols - left - 1 : 1;
+        if (ok) ok = window.loadRect(top, left, height, width, loaded);
+        CHECK(ok, name << ": can't load a window of .mzc: " << window.error);
+        if (ok) {
+            CHECK(loaded.numRows() == height && loaded.numCols() == width
+                    && sameWalls(walls, loaded, top, left),
+                    name << ": the window at (" << top << "," << left << ") of the .mzc came back different");
+        }
+    });
+
+    remove((path + ".maze").c_str());
+    remove((path + ".mzz").c_str());
+    remove((path + ".mzc").c_str());
+    return checkResult();
+}
+
+#endif /* CHECKFILES_CPP_ */
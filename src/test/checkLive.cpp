@@ -0,0 +1,129 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file checkLive.cpp
+ * @brief Checks that Maze2d::liveSolution() and a ClusterGraph kept up to
+ * date with wallChanged() agree with a plain breadth-first search as walls
+ * are raised and knocked down.
+ */
+
+#ifndef CHECKLIVE_CPP_
+#define CHECKLIVE_CPP_
+
+#include "check.h"
+#include "ClusterGraph.h"
+
+/**
+ * @brief Check the live solution and the cluster graph against the reference
+ * after an edit
+ */
+static void checkEdit(const std::string& name, Maze2d& m, ClusterGraph& clusters,
+        const char *edit) {
+    const WallBits& walls = m.getWalls();
+    int rows = walls.numRows(), cols = walls.numCols();
+    int expected = checkDistances(walls, 0, 0)[rows * cols - 1];
+    std::vector<unsigned char> path;
+
+    // With loops the live solution is a path, but not always the shortest
+    int length = m.liveSolution(path);
+    if (expected < 0 || checkIsTree(walls)) {
+        CHECK(length == expected, name << ": after " << edit << " the live solution is "
+                << length << " long, not " << expected);
+    } else {
+        CHECK(length >= expected, name << ": after " << edit << " the live solution is "
+                << length << " long, shorter than " << expected);
+    }
+    if (length >= 0) {
+        CHECK((int) path.size() == length && checkPath(walls, 0, 0, rows-1, cols-1, path),
+                name << ": after " << edit << " the live solution isn't a path to the exit");
+    }
+
+    length = clusters.distance(0, 0, rows-1, cols-1);
+    CHECK(length == expected, name << ": after " << edit << " the cluster graph gave "
+            << length << ", not " << expected);
+}
+
+/**
+ * @brief Find the walls on the path between the two sides of a raised wall,
+ * as (row, column, direction) of the node each step leaves
+ */
+static std::vector<int> loopThrough(const WallBits& walls, int r, int c, int dir) {
+    int cols = walls.numCols();
+    int end_r = dir == DOWN ? r+1 : r, end_c = dir == RIGHT ? c+1 : c;
+    std::vector<int> distances = checkDistances(walls, end_r, end_c);
+    std::vector<int> steps;
+    // Walk downhill from (r,c) to the other side
+    while (distances[r * cols + c] > 0) {
+        for (int d=RIGHT; d <= DOWN; d++) {
+            if (walls.wall(r, c, d)) continue;
+            int nr = r + (d == DOWN) - (d == UP), nc = c + (d == RIGHT) - (d == LEFT);
+            if (distances[nr * cols + nc] != distances[r * cols + c] - 1) continue;
+            steps.push_back(r);
+            steps.push_back(c);
+            steps.push_back(d);
+            r = nr;
+            c = nc;
+            break;
+        }
+    }
+    return steps;
+}
+
+int main() {
+    ClusterGraph clusters;
+
+    forEachCheckMaze([&](const std::string& name, Maze2d& m) {
+        const WallBits& walls = m.getWalls();
+        int rows = walls.numRows(), cols = walls.numCols();
+        if (rows * cols < 2) return;
+        clusters.build(walls, 8);
+        checkEdit(name, m, clusters, "nothing");
+
+        // Knocking down a wall and raising another on the loop it makes
+        // keeps a perfect maze perfect
+        if (checkIsTree(walls)) {
+            for (int edit=0; edit < 30; edit++) {
+                int r = rand() % rows, c = rand() % cols, dir = rand() % 2 ? RIGHT : DOWN;
+                if (!walls.wall(r, c, dir) || (dir == RIGHT && c == cols-1)
+                        || (dir == DOWN && r == rows-1)) continue;
+                std::vector<int> loop = loopThrough(walls, r, c, dir);
+                int k = rand() % (loop.size() / 3);
+                m.setWall(r, c, dir, false);
+                clusters.wallChanged(r, c, dir);
+                m.setWall(loop[3*k], loop[3*k + 1], loop[3*k + 2], true);
+                clusters.wallChanged(loop[3*k], loop[3*k + 1], loop[3*k + 2]);
+                checkEdit(name, m, clusters, "swapping two walls");
+            }
+        }
+
+        // Then any edits at all
+        for (int edit=0; edit < 30; edit++) {
+            int r = rand() % rows, c = rand() % cols, dir = rand() % 4;
+            bool up = rand() % 2;
+            if (!m.setWall(r, c, dir, up)) continue;
+            clusters.wallChanged(r, c, dir);
+            checkEdit(name, m, clusters, up ? "raising a wall" : "knocking down a wall");
+        }
+    });
+
+    return checkResult();
+}
+
+#endif /* CHECKLIVE_CPP_ */
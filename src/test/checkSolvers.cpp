@@ -0,0 +1,224 @@
+/*
+ *  Copyright 2010 Ben Selfridge
+ *
+ *  This file is part of mazecut.
+ *
+ *  mazecut is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  mazecut is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with mazecut.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file checkSolvers.cpp
+ * @brief Checks that every solver finds the same distances as a plain
+ * breadth-first search, on perfect mazes and mazes with loops.
+ */
+
+#ifndef CHECKSOLVERS_CPP_
+#define CHECKSOLVERS_CPP_
+
+#include "check.h"
+#include "MazeSolver.h"
+#include "TreeDistanceIndex.h"
+#include "BatchQuery.h"
+#include "JunctionGraph.h"
+#include "ClusterGraph.h"
+#include "DistanceField.h"
+#include "StreamSolver.h"
+
+/**
+ * @brief A start and end to check, with the distance between them
+ */
+struct CheckQuery {
+    int start_r, start_c, end_r, end_c;
+    int distance;
+};
+
+/**
+ * @brief Pick the queries to check on a maze: from the corners, the middle
+ * and a random node, to the corners, the middle and a few random nodes
+ */
+static std::vector<CheckQuery> pickQueries(const WallBits& walls) {
+    int rows = walls.numRows(), cols = walls.numCols();
+    int places[][2] = {
+        {0, 0}, {rows-1, cols-1}, {rows/2, cols/2}, {rand() % rows, rand() % cols},
+        {0, cols-1}, {rows-1, 0}, {rand() % rows, rand() % cols}, {rand() % rows, rand() % cols}
+    };
+    std::vector<CheckQuery> queries;
+    for (int s=0; s < 4; s++) {
+        std::vector<int> distances = checkDistances(walls, places[s][0], places[s][1]);
+        for (int e=0; e < 8; e++) {
+            CheckQuery query = {places[s][0], places[s][1], places[e][0], places[e][1],
+                    distances[places[e][0] * cols + places[e][1]]};
+            queries.push_back(query);
+        }
+    }
+    return queries;
+}
+
+/**
+ * @brief Check a length and path found by a solver against the reference
+ */
+#define CHECK_ANSWER(solver, walls, query, length, path, name) do { \
+        CHECK((length) == (query).distance, name << ": " << solver << " from (" \
+                << (query).start_r << "," << (query).start_c << ") to (" << (query).end_r \
+                << "," << (query).end_c << ") gave " << (length) << ", not " \
+                << (query).distance); \
+        if ((length) >= 0) { \
+            CHECK((int) (path).size() == (length) && checkPath(walls, (query).start_r, \
+                    (query).start_c, (query).end_r, (query).end_c, path), \
+                    name << ": " << solver << " path from (" << (query).start_r << "," \
+                    << (query).start_c << ") isn't a path to (" << (query).end_r << "," \
+                    << (query).end_c << ")"); \
+        } \
+    } while (0)
+
+int main() {
+    MazeSolver solver;
+    ClusterGraph clusters;
+    DistanceField field;
+    StreamSolver stream;
+
+    forEachCheckMaze([&](const std::string& name, Maze2d& m) {
+        const WallBits& walls = m.getWalls();
+        int rows = walls.numRows(), cols = walls.numCols();
+        std::vector<CheckQuery> queries = pickQueries(walls);
+        std::vector<unsigned char> path;
+        std::vector<uint64_t> solution;
+        bool tree = checkIsTree(walls);
+        TreeDistanceIndex index;
+        bool indexed = index.build(walls);
+        CHECK(indexed == tree, name << ": the index was " << (indexed ? "" : "not ")
+                << "built");
+        JunctionGraph graph;
+        graph.build(walls);
+        clusters.build(walls, 8);
+
+        for (size_t q=0; q < queries.size(); q++) {
+            const CheckQuery& query = queries[q];
+            int length = solver.solve(walls, query.start_r, query.start_c,
+                    query.end_r, query.end_c, path);
+            CHECK_ANSWER("solve()", walls, query, length, path, name);
+            length = m.findPath(query.start_r, query.start_c, query.end_r, query.end_c, path);
+            CHECK_ANSWER("findPath()", walls, query, length, path, name);
+            length = solver.solveBidirectional(walls, query.start_r, query.start_c,
+                    query.end_r, query.end_c, path);
+            CHECK_ANSWER("solveBidirectional()", walls, query, length, path, name);
+            length = solver.solveAStar(walls, query.start_r, query.start_c,
+                    query.end_r, query.end_c, path);
+            CHECK_ANSWER("solveAStar()", walls, query, length, path, name);
+            // On a perfect maze only the path is left unfilled; loops it
+            // could take are left too
+            if (query.distance >= 0) {
+                long unfilled = solver.fillDeadEnds(walls, query.start_r, query.start_c,
+                        query.end_r, query.end_c, solution);
+                if (tree) {
+                    CHECK(unfilled == query.distance + 1, name << ": fillDeadEnds() left "
+                            << unfilled << " nodes, not " << query.distance + 1);
+                } else {
+                    CHECK(unfilled >= query.distance + 1, name << ": fillDeadEnds() left "
+                            << unfilled << " nodes, fewer than the path");
+                }
+            }
+            if (indexed) {
+                length = index.distance(query.start_r, query.start_c, query.end_r, query.end_c);
+                CHECK(length == query.distance, name << ": the index gave " << length
+                        << ", not " << query.distance);
+                length = index.path(query.start_r, query.start_c, query.end_r, query.end_c, path);
+                CHECK_ANSWER("the index", walls, query, length, path, name);
+            }
+            length = solver.solveJunctions(graph, query.start_r, query.start_c,
+                    query.end_r, query.end_c, path);
+            CHECK_ANSWER("solveJunctions()", walls, query, length, path, name);
+            length = clusters.distance(query.start_r, query.start_c, query.end_r, query.end_c);
+            CHECK(length == query.distance, name << ": the cluster graph gave " << length
+                    << ", not " << query.distance);
+            length = clusters.path(query.start_r, query.start_c, query.end_r, query.end_c, path);
+            CHECK_ANSWER("the cluster graph", walls, query, length, path, name);
+        }
+
+        // The whole lot again as one batch, plus queries off the maze
+        std::vector<PathQuery> batch;
+        for (size_t q=0; q < queries.size(); q++) {
+            PathQuery query = {queries[q].start_r, queries[q].start_c,
+                    queries[q].end_r, queries[q].end_c};
+            batch.push_back(query);
+        }
+        PathQuery outside[] = {{-1, 0, 0, 0}, {0, 0, rows, 0}, {0, cols, 0, 0}, {0, 0, 0, -1}};
+        batch.insert(batch.end(), outside, outside + 4);
+        std::vector<int> distances(batch.size());
+        std::vector<std::vector<unsigned char> > paths(batch.size());
+        BatchQuery batchQuery(walls);
+        batchQuery.run(&batch[0], (long) batch.size(), &distances[0], &paths[0]);
+        for (size_t q=0; q < queries.size(); q++) {
+            CHECK_ANSWER("BatchQuery", walls, queries[q], distances[q], paths[q], name);
+        }
+        for (size_t q=queries.size(); q < batch.size(); q++) {
+            CHECK(distances[q] == -1, name << ": BatchQuery answered a query off the maze");
+        }
+        m.batchQuery(&batch[0], (long) queries.size(), &distances[0], NULL);
+        for (size_t q=0; q < queries.size(); q++) {
+            CHECK(distances[q] == queries[q].distance, name << ": batchQuery() gave "
+                    << distances[q] << ", not " << queries[q].distance);
+        }
+
+        // Every distance from the first two starts
+        std::vector<uint32_t> field_distances((size_t) rows * cols);
+        for (int s=0; s < 2; s++) {
+            int start_r = s ? rows-1 : 0, start_c = s ? cols-1 : 0;
+            std::vector<int> expected = checkDistances(walls, start_r, start_c);
+            field.compute(walls, start_r, start_c, &field_distances[0]);
+            int wrong = 0;
+            for (size_t i=0; i < expected.size(); i++) {
+                uint32_t want = expected[i] < 0 ? DistanceField::UNREACHABLE : expected[i];
+                if (field_distances[i] != want) wrong++;
+            }
+            CHECK(wrong == 0, name << ": the distance field from (" << start_r << ","
+                    << start_c << ") got " << wrong << " distances wrong");
+        }
+
+        // The streaming solver only goes from the first row to the last, and
+        // with loops doesn't always find the shortest path
+        std::vector<int> fromStart = checkDistances(walls, 0, 0);
+        for (int end_c=0; end_c < cols; end_c += cols > 2 ? cols / 2 : 1) {
+            stream.begin(cols, 0);
+            for (int r=0; r < rows; r++) stream.addRow(walls.rightRow(r), walls.downRow(r));
+            // Turn the segments back into steps
+            path.clear();
+            int last_r = 0;
+            long length = stream.finish(end_c, [&](const RowSegment& segment) {
+                if (segment.row != last_r) path.push_back(segment.row > last_r ? DOWN : UP);
+                last_r = segment.row;
+                for (int c=segment.from; c != segment.to; c += segment.to > c ? 1 : -1) {
+                    path.push_back(segment.to > c ? RIGHT : LEFT);
+                }
+            });
+            int expected = fromStart[(rows-1) * cols + end_c];
+            if (expected < 0 || tree) {
+                CHECK(length == expected, name << ": the streaming solver gave " << length
+                        << " to column " << end_c << ", not " << expected);
+            } else {
+                CHECK(length >= expected, name << ": the streaming solver gave " << length
+                        << " to column " << end_c << ", shorter than " << expected);
+            }
+            if (length >= 0) {
+                CHECK((long) path.size() == length && checkPath(walls, 0, 0, rows-1, end_c, path),
+                        name << ": the streaming solver's segments don't make a path to column "
+                        << end_c);
+            }
+        }
+    });
+
+    return checkResult();
+}
+
+#endif /* CHECKSOLVERS_CPP_ */